@@ -0,0 +1,130 @@
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+std::atomic<bool> CpuProfiler::s_enabled(false);
+std::mutex CpuProfiler::s_ringsMutex;
+std::vector<std::unique_ptr<CpuProfiler::ThreadRing>> CpuProfiler::s_rings;
+
+/* --------------------------------- Public methods --------------------------------- */
+
+void CpuProfiler::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool CpuProfiler::isEnabled()
+{
+    return s_enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t CpuProfiler::now()
+{
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void CpuProfiler::record(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadRing& ring = threadRing();
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    ring.events[head & (ringSize - 1)] = { name, start, end };
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void CpuProfiler::setThreadName(const std::string& name)
+{
+    ThreadRing& ring = threadRing();
+    // only read by the export, under the same lock
+    std::lock_guard<std::mutex> lock(s_ringsMutex);
+    ring.name = name;
+}
+
+/*
+    Chrome trace event format, complete events ("ph": "X") with microsecond timestamps,
+    the file opens in chrome://tracing or ui.perfetto.dev
+*/
+bool CpuProfiler::exportChromeTrace(const std::string& path)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        std::cout << "failed to write cpu trace " << path << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(s_ringsMutex);
+    file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    bool first = true;
+    for (auto& ring : s_rings) {
+        file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->threadId
+            << ",\"args\":{\"name\":\"" << ring->name << "\"}}";
+        first = false;
+
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t begin = head > ringSize ? head - ringSize : 0;
+        std::vector<Event> events;
+        events.reserve(head - begin);
+        for (uint64_t i = begin; i < head; i++) {
+            events.push_back(ring->events[i & (ringSize - 1)]);
+        }
+
+        // the owner kept recording during the copy, drop the slots it overwrote
+        uint64_t newHead = ring->head.load(std::memory_order_acquire);
+        uint64_t overwritten = newHead > ringSize ? newHead - ringSize : 0;
+        for (uint64_t i = std::max(begin, overwritten); i < head; i++) {
+            const Event& event = events[i - begin];
+            file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->threadId
+                << ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+        }
+    }
+    file << "\n]}" << std::endl;
+
+    std::cout << "cpu trace written to " << path << std::endl;
+    return true;
+}
+
+/* --------------------------------- Private methods --------------------------------- */
+
+/*
+    Rings are owned by the profiler, not by the threads, so the events of a finished
+    worker thread are still exported
+*/
+CpuProfiler::ThreadRing& CpuProfiler::threadRing()
+{
+    thread_local ThreadRing* ring = nullptr;
+    if (ring == nullptr) {
+        auto newRing = std::make_unique<ThreadRing>();
+        newRing->events.resize(ringSize);
+        newRing->head.store(0, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(s_ringsMutex);
+        newRing->threadId = static_cast<uint32_t>(s_rings.size());
+        newRing->name = "Thread " + std::to_string(newRing->threadId);
+        ring = newRing.get();
+        s_rings.push_back(std::move(newRing));
+    }
+    return *ring;
+}
+
+/* --------------------------------- CpuZone --------------------------------- */
+
+CpuZone::CpuZone(const char* name):
+    m_name(nullptr),
+    m_start(0)
+{
+    if (CpuProfiler::isEnabled()) {
+        m_name = name;
+        m_start = CpuProfiler::now();
+    }
+}
+
+CpuZone::~CpuZone()
+{
+    if (m_name) {
+        CpuProfiler::record(m_name, m_start, CpuProfiler::now());
+    }
+}
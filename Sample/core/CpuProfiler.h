@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+    Scoped CPU zones recorded in one ring buffer per thread. The owning thread is the only
+    writer of its ring so recording is lock free, the export only reads the published events.
+    A disabled profiler costs one relaxed atomic load per zone, defining DISABLE_CPU_PROFILER
+    compiles the zones out entirely.
+*/
+class CpuProfiler
+{
+public:
+    struct Event {
+        // string literal, never freed
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    static constexpr uint32_t ringSize = 1 << 16;
+
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+    // nanoseconds since the first call
+    static uint64_t now();
+    static void record(const char* name, uint64_t start, uint64_t end);
+    // Name the calling thread in the trace viewer
+    static void setThreadName(const std::string& name);
+
+    static bool exportChromeTrace(const std::string& path);
+
+private:
+    // Single producer ring, head is published after the event is written
+    struct ThreadRing {
+        std::string name;
+        uint32_t threadId;
+        std::vector<Event> events;
+        std::atomic<uint64_t> head;
+    };
+
+    static ThreadRing& threadRing();
+
+private:
+    static std::atomic<bool> s_enabled;
+    static std::mutex s_ringsMutex;
+    static std::vector<std::unique_ptr<ThreadRing>> s_rings;
+};
+
+// Record the lifetime of the object as a zone, the name must outlive the profiler
+class CpuZone
+{
+public:
+    CpuZone(const char* name);
+    ~CpuZone();
+
+private:
+    const char* m_name;
+    uint64_t m_start;
+};
+
+#ifdef DISABLE_CPU_PROFILER
+#define CPU_ZONE(name)
+#else
+#define CPU_ZONE_CONCAT_IMPL(a, b) a##b
+#define CPU_ZONE_CONCAT(a, b) CPU_ZONE_CONCAT_IMPL(a, b)
+#define CPU_ZONE(name) CpuZone CPU_ZONE_CONCAT(cpuZone, __LINE__)(name)
+#endif
@@ -2,73 +2,49 @@
 #include <utils/MatrixBuffer.h>
 
 #include <iostream>
-
-/* --------------------------------- FrameDescriptor --------------------------------- */
-
-void FrameDescriptor::initialize(const std::vector<Material*>& materials)
-{
-    for (const auto& material : materials)
-    {
-        m_descriptors[material->materialId()] = DescriptorEntry();
-    }
-}
-
-void FrameDescriptor::cleanUp(RenderContext& renderContext)
-{
-    for (auto descriptorIt : m_descriptors) {
-        DescriptorEntry& entry = descriptorIt.second;
-        vkDestroyBuffer(renderContext.device(), entry.buffer, nullptr);
-        vkFreeMemory(renderContext.device(), entry.memory, nullptr);
-    }
-    vkDestroyBuffer(renderContext.device(), m_globalDescriptorEntry.buffer, nullptr);
-    vkFreeMemory(renderContext.device(), m_globalDescriptorEntry.memory, nullptr);
-}
-
-DescriptorEntry& FrameDescriptor::getDescriptorEntry(MaterialID materialId)
-{
-    return m_descriptors.at(materialId);
-}
-
-DescriptorEntry& FrameDescriptor::getGlobalDescriptorEntry()
-{
-    return m_globalDescriptorEntry;
-}
+#include <array>
 
 /* --------------------------------- DescriptorTable --------------------------------- */
 
 DescriptorTable::DescriptorTable(RenderContext& renderContext):
-    m_renderContext(renderContext)
+    m_renderContext(renderContext),
+    m_descriptorPool(VK_NULL_HANDLE),
+    m_globalUniformDescriptorLayout(VK_NULL_HANDLE),
+    m_resourceDescriptorLayout(VK_NULL_HANDLE),
+    m_pipelineLayout(VK_NULL_HANDLE),
+    m_globalDescriptor({ VK_NULL_HANDLE, 0 }),
+    m_resourceDescriptorSet(VK_NULL_HANDLE),
+    m_uniformArena(nullptr),
+    m_reservedUniformSize(0),
+    m_texture2DCount(0),
+    m_texture3DCount(0),
+    m_samplerCount(0),
+    m_storageBufferCount(0),
+    m_storageImageCount(0)
 {
 
 }
 
+/*
+    Sized for the whole arrays, adding a material later only writes new slots
+*/
 void DescriptorTable::createDescriptorPool()
 {
-    uint32_t swapChainImageSize = m_renderContext.swapChain().size();
-    std::vector<VkDescriptorPoolSize> descriptorPoolSizes;
-
-    VkDescriptorPoolSize globalDescriptor;
-    globalDescriptor.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    globalDescriptor.descriptorCount = static_cast<uint32_t>(swapChainImageSize);
-    descriptorPoolSizes.push_back(globalDescriptor);
-    
-    for (auto& material : m_materials) {
-        std::vector<VkDescriptorSetLayoutBinding>& descriptorBindings = material->descriptorBindings();
-
-        for (auto& binding : descriptorBindings) {
-            VkDescriptorPoolSize descriptor;
-            descriptor.type = binding.descriptorType;
-            descriptor.descriptorCount = static_cast<uint32_t>(swapChainImageSize);
-            descriptorPoolSizes.push_back(descriptor);
-        }
-    }
+    std::vector<VkDescriptorPoolSize> descriptorPoolSizes = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 + maxStorageBuffers },
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, maxTextures2D + maxTextures3D },
+        { VK_DESCRIPTOR_TYPE_SAMPLER, maxSamplers },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, maxStorageImages }
+    };
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
     poolInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());
     poolInfo.pPoolSizes = descriptorPoolSizes.data();
-    // (nb materials + globalDescriptor) * nbSwapChainImages
-    poolInfo.maxSets = static_cast<uint32_t>((m_materials.size() + 1) * swapChainImageSize);
+    // frame set + resource set
+    poolInfo.maxSets = 2;
 
     if (vkCreateDescriptorPool(m_renderContext.device(), &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor pool!");
@@ -77,133 +53,258 @@ void DescriptorTable::createDescriptorPool()
 
 void DescriptorTable::createDescriptorLayouts()
 {
+    /* ------------------------- Frame data ------------------------- */
     VkDescriptorSetLayoutBinding globalBufferBinding = MatrixBuffer::descriptorBinding();
-    std::array<VkDescriptorSetLayoutBinding, 1> globalLayoutBindings = { globalBufferBinding };
+
+    VkDescriptorSetLayoutBinding objectBufferBinding{};
+    objectBufferBinding.binding = objectDataBinding;
+    objectBufferBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    objectBufferBinding.descriptorCount = 1;
+    objectBufferBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    objectBufferBinding.pImmutableSamplers = nullptr;
+
+    std::array<VkDescriptorSetLayoutBinding, 2> globalLayoutBindings = { globalBufferBinding, objectBufferBinding };
     VkDescriptorSetLayoutCreateInfo globalLayoutInfo{};
     globalLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    globalLayoutInfo.bindingCount = 1;
+    globalLayoutInfo.bindingCount = static_cast<uint32_t>(globalLayoutBindings.size());
     globalLayoutInfo.pBindings = globalLayoutBindings.data();
 
     if (vkCreateDescriptorSetLayout(m_renderContext.device(), &globalLayoutInfo, nullptr, &m_globalUniformDescriptorLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create global descriptor set layout!");
     }
 
-    for (auto& material : m_materials)
-    {
-        material->createDescriptorLayouts(m_renderContext);
+    /* ------------------------- Bindless resources ------------------------- */
+    VkShaderStageFlags resourceStages = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    std::array<VkDescriptorSetLayoutBinding, 5> resourceBindings{};
+    resourceBindings[0] = { texture2DBinding, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, maxTextures2D, resourceStages, nullptr };
+    resourceBindings[1] = { texture3DBinding, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, maxTextures3D, resourceStages, nullptr };
+    resourceBindings[2] = { samplerBinding, VK_DESCRIPTOR_TYPE_SAMPLER, maxSamplers, resourceStages, nullptr };
+    resourceBindings[3] = { storageBufferBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxStorageBuffers, VK_SHADER_STAGE_VERTEX_BIT | resourceStages, nullptr };
+    resourceBindings[4] = { storageImageBinding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, maxStorageImages, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+
+    // unused slots are never accessed, new slots can be written while the set is bound
+    VkDescriptorBindingFlags bindlessFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+    std::array<VkDescriptorBindingFlags, 5> bindingFlags = { bindlessFlags, bindlessFlags, bindlessFlags, bindlessFlags, bindlessFlags };
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo resourceLayoutInfo{};
+    resourceLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    resourceLayoutInfo.pNext = &bindingFlagsInfo;
+    resourceLayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    resourceLayoutInfo.bindingCount = static_cast<uint32_t>(resourceBindings.size());
+    resourceLayoutInfo.pBindings = resourceBindings.data();
+
+    if (vkCreateDescriptorSetLayout(m_renderContext.device(), &resourceLayoutInfo, nullptr, &m_resourceDescriptorLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create bindless descriptor set layout!");
+    }
+
+    /* ------------------------- Shared pipeline layout ------------------------- */
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(DrawConstants);
+
+    VkDescriptorSetLayout descriptors[2] = { m_globalUniformDescriptorLayout, m_resourceDescriptorLayout };
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 2;
+    pipelineLayoutInfo.pSetLayouts = descriptors;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(m_renderContext.device(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
     }
 }
 
+void DescriptorTable::reserveUniformData(VkDeviceSize frameSize)
+{
+    m_reservedUniformSize += frameSize;
+}
+
+/*
+    Every uniform of the frame lives in the same persistently mapped arena. 64KB per swapchain
+    image covers the fixed data, the per object data of the scene was reserved on top of it
+*/
 void DescriptorTable::createDescriptorBuffers()
 {
     uint32_t swapChainImageSize = m_renderContext.swapChain().size();
-    VkMemoryPropertyFlags memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    m_uniformArena = std::make_unique<UniformArena>(m_renderContext);
+    m_uniformArena->create(swapChainImageSize, 64 * 1024 + m_reservedUniformSize);
+}
 
-    // Frame descriptor
-    VkDeviceSize matrixBufferSize = sizeof(MatrixBuffer::BufferData);
-    m_frameDescriptors.resize(swapChainImageSize);
+void DescriptorTable::createDescriptorSets()
+{
+    /* ------------------------- Create Descriptor ------------------------- */
+    VkDescriptorSetLayout layouts[2] = { m_globalUniformDescriptorLayout, m_resourceDescriptorLayout };
+    VkDescriptorSet descriptorSets[2];
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 2;
+    allocInfo.pSetLayouts = layouts;
+    if (vkAllocateDescriptorSets(m_renderContext.device(), &allocInfo, descriptorSets) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate descriptor sets!");
+    }
+    m_globalDescriptor.descriptorSet = descriptorSets[0];
+    m_resourceDescriptorSet = descriptorSets[1];
 
-    for (auto& frameDescriptor : m_frameDescriptors) {
-        frameDescriptor.initialize(m_materials);
+    /* ------------------------- Fill Descriptor ------------------------- */
+    VkDescriptorBufferInfo matrixInfo{};
+    matrixInfo.buffer = m_uniformArena->buffer();
+    matrixInfo.offset = 0;
+    matrixInfo.range = sizeof(MatrixBuffer::BufferData);
+
+    // Objects read their data at the vec4 index pushed with the draw
+    VkDescriptorBufferInfo objectInfo{};
+    objectInfo.buffer = m_uniformArena->buffer();
+    objectInfo.offset = 0;
+    objectInfo.range = VK_WHOLE_SIZE;
+
+    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstSet = m_globalDescriptor.descriptorSet;
+    descriptorWrites[0].dstBinding = matrixBinding;
+    descriptorWrites[0].dstArrayElement = 0;
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo = &matrixInfo;
+
+    descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].dstSet = m_globalDescriptor.descriptorSet;
+    descriptorWrites[1].dstBinding = objectDataBinding;
+    descriptorWrites[1].dstArrayElement = 0;
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pBufferInfo = &objectInfo;
 
-        // global descriptor
-        auto& globalDescriptor = frameDescriptor.getGlobalDescriptorEntry();
-        m_renderContext.createBuffer(matrixBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, memoryPropertyFlags, globalDescriptor.buffer, globalDescriptor.memory);
+    vkUpdateDescriptorSets(m_renderContext.device(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 
-        // material descriptor
-        for (auto& material : m_materials) {
-            auto& descriptorEntry = frameDescriptor.getDescriptorEntry(material->materialId());
-            material->createDescriptorBuffer(m_renderContext, descriptorEntry.buffer, descriptorEntry.memory);
-        }
+    // Materials
+    for (auto& material : m_materials) {
+        material->registerResources(*this);
     }
 }
 
-void DescriptorTable::createFrameDescriptors()
+void DescriptorTable::cleanUp()
 {
-    uint32_t swapChainImageSize = m_renderContext.swapChain().size();
+    vkDestroyPipelineLayout(m_renderContext.device(), m_pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_renderContext.device(), m_globalUniformDescriptorLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_renderContext.device(), m_resourceDescriptorLayout, nullptr);
+    m_uniformArena->cleanUp();
+    vkDestroyDescriptorPool(m_renderContext.device(), m_descriptorPool, nullptr);
+}
 
-    /* ------------------------- Create Descriptor ------------------------- */
-    for (auto& frameDescriptor : m_frameDescriptors) {
-
-        // Global Uniform Descriptors
-        VkDescriptorSetAllocateInfo allocInfo{};
-        auto& globalDescriptorEntry = frameDescriptor.getGlobalDescriptorEntry();
-        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocInfo.descriptorPool = m_descriptorPool;
-        allocInfo.descriptorSetCount = 1;
-        allocInfo.pSetLayouts = &m_globalUniformDescriptorLayout;
-        if (vkAllocateDescriptorSets(m_renderContext.device(), &allocInfo, &globalDescriptorEntry.descriptorSet) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate descriptor sets!");
-        }
-
-        // Material's descriptors
-        for (auto& material : m_materials) {
-            DescriptorEntry& descriptorEntry = frameDescriptor.getDescriptorEntry(material->materialId());
-            std::vector<VkDescriptorSetLayout> descriptorLayout = { material->descriptorLayout() };
-            VkDescriptorSetAllocateInfo allocInfo{};
-            allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-            allocInfo.descriptorPool = m_descriptorPool;
-            allocInfo.descriptorSetCount = 1;
-            allocInfo.pSetLayouts = descriptorLayout.data();
-
-            if (vkAllocateDescriptorSets(m_renderContext.device(), &allocInfo, &descriptorEntry.descriptorSet) != VK_SUCCESS) {
-                throw std::runtime_error("failed to allocate descriptor sets!");
-            }
-        }
+void DescriptorTable::addMaterial(Material* material)
+{
+    m_materials.push_back(material);
+    // late materials only fill new slots, no pool or set to rebuild
+    if (m_resourceDescriptorSet != VK_NULL_HANDLE) {
+        material->registerResources(*this);
     }
-    /* ------------------------- Fill Descriptor ------------------------- */
+}
 
-    std::vector<VkWriteDescriptorSet> descriptorWrites;
-    for (auto& frameDescriptor : m_frameDescriptors) {
-
-        auto& globalDescriptorEntry = frameDescriptor.getGlobalDescriptorEntry();
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = globalDescriptorEntry.buffer;
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(MatrixBuffer::BufferData);
-        VkWriteDescriptorSet descriptorWrite;
-        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrite.dstSet = globalDescriptorEntry.descriptorSet;
-        descriptorWrite.dstBinding = 0;
-        descriptorWrite.dstArrayElement = 0;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pBufferInfo = &bufferInfo;
-        descriptorWrites.push_back(descriptorWrite);
-
-        // Materials
-        for (auto& material : m_materials) {
-            DescriptorEntry& descriptorEntry = frameDescriptor.getDescriptorEntry(material->materialId());
-            material->updateDescriptorSet(m_renderContext, descriptorEntry.descriptorSet, descriptorEntry.buffer);
-        }
+uint32_t DescriptorTable::addTexture2D(VkImageView imageView)
+{
+    if (m_texture2DCount >= maxTextures2D) {
+        throw std::runtime_error("failed to add texture, bindless array is full!");
     }
+    writeImage(texture2DBinding, m_texture2DCount, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, imageView, VK_NULL_HANDLE);
+    return m_texture2DCount++;
+}
 
-    vkUpdateDescriptorSets(m_renderContext.device(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+void DescriptorTable::updateTexture2D(uint32_t slot, VkImageView imageView)
+{
+    if (slot >= m_texture2DCount) {
+        throw std::runtime_error("failed to update texture, slot was never added!");
+    }
+    writeImage(texture2DBinding, slot, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, imageView, VK_NULL_HANDLE);
 }
 
-void DescriptorTable::cleanUp()
+uint32_t DescriptorTable::addTexture3D(VkImageView imageView)
 {
-    vkDestroyDescriptorSetLayout(m_renderContext.device(), m_globalUniformDescriptorLayout, nullptr);
-    for (auto& frameDescriptor : m_frameDescriptors) {
-        frameDescriptor.cleanUp(m_renderContext);
+    if (m_texture3DCount >= maxTextures3D) {
+        throw std::runtime_error("failed to add texture, bindless array is full!");
     }
-    m_frameDescriptors.clear();
-    vkDestroyDescriptorPool(m_renderContext.device(), m_descriptorPool, nullptr);
+    writeImage(texture3DBinding, m_texture3DCount, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, imageView, VK_NULL_HANDLE);
+    return m_texture3DCount++;
 }
 
-void DescriptorTable::addMaterial(Material* material)
+void DescriptorTable::updateTexture3D(uint32_t slot, VkImageView imageView)
 {
-    m_materials.push_back(material);
+    if (slot >= m_texture3DCount) {
+        throw std::runtime_error("failed to update texture, slot was never added!");
+    }
+    writeImage(texture3DBinding, slot, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, imageView, VK_NULL_HANDLE);
 }
 
-FrameDescriptor& DescriptorTable::getFrameDescriptor(size_t frameIndex)
+uint32_t DescriptorTable::addSampler(VkSampler sampler)
 {
-    return m_frameDescriptors.at(frameIndex);
+    if (m_samplerCount >= maxSamplers) {
+        throw std::runtime_error("failed to add sampler, bindless array is full!");
+    }
+    writeImage(samplerBinding, m_samplerCount, VK_DESCRIPTOR_TYPE_SAMPLER, VK_NULL_HANDLE, sampler);
+    return m_samplerCount++;
+}
+
+uint32_t DescriptorTable::addStorageBuffer(VkBuffer buffer, VkDeviceSize range)
+{
+    if (m_storageBufferCount >= maxStorageBuffers) {
+        throw std::runtime_error("failed to add storage buffer, bindless array is full!");
+    }
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = range;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = m_resourceDescriptorSet;
+    descriptorWrite.dstBinding = storageBufferBinding;
+    descriptorWrite.dstArrayElement = m_storageBufferCount;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(m_renderContext.device(), 1, &descriptorWrite, 0, nullptr);
+
+    return m_storageBufferCount++;
 }
 
-DescriptorEntry& DescriptorTable::getGlobalDescriptor(size_t frameIndex)
+uint32_t DescriptorTable::addStorageImage(VkImageView imageView)
 {
-    return m_frameDescriptors.at(frameIndex).getGlobalDescriptorEntry();
+    if (m_storageImageCount >= maxStorageImages) {
+        throw std::runtime_error("failed to add storage image, bindless array is full!");
+    }
+    writeImage(storageImageBinding, m_storageImageCount, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, imageView, VK_NULL_HANDLE);
+    return m_storageImageCount++;
+}
+
+void DescriptorTable::updateStorageImage(uint32_t slot, VkImageView imageView)
+{
+    if (slot >= m_storageImageCount) {
+        throw std::runtime_error("failed to update storage image, slot was never added!");
+    }
+    writeImage(storageImageBinding, slot, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, imageView, VK_NULL_HANDLE);
+}
+
+void DescriptorTable::bindDescriptorSets(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint)
+{
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, m_pipelineLayout, 0, 1, &m_globalDescriptor.descriptorSet, 1, &m_globalDescriptor.dynamicOffset);
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, m_pipelineLayout, 1, 1, &m_resourceDescriptorSet, 0, nullptr);
+}
+
+DescriptorEntry& DescriptorTable::getGlobalDescriptor()
+{
+    return m_globalDescriptor;
+}
+
+VkDescriptorSet DescriptorTable::resourceDescriptorSet() const
+{
+    return m_resourceDescriptorSet;
 }
 
 VkDescriptorSetLayout DescriptorTable::globalDescriptorLayout() const
@@ -211,12 +312,37 @@ VkDescriptorSetLayout DescriptorTable::globalDescriptorLayout() const
     return m_globalUniformDescriptorLayout;
 }
 
-std::vector<DescriptorEntry> DescriptorTable::getMaterialDescriptors(MaterialID materialId)
+VkDescriptorSetLayout DescriptorTable::resourceDescriptorLayout() const
 {
-    std::vector<DescriptorEntry> descriptors;
-    for (auto& frameDescriptor : m_frameDescriptors) {
-        auto& descriptorRef = frameDescriptor.getDescriptorEntry(materialId);
-        descriptors.push_back(descriptorRef);
-    }
-    return descriptors;
-}
\ No newline at end of file
+    return m_resourceDescriptorLayout;
+}
+
+VkPipelineLayout DescriptorTable::pipelineLayout() const
+{
+    return m_pipelineLayout;
+}
+
+UniformArena& DescriptorTable::uniformArena()
+{
+    return *m_uniformArena;
+}
+
+/* --------------------------------- Private methods --------------------------------- */
+
+void DescriptorTable::writeImage(uint32_t binding, uint32_t slot, VkDescriptorType type, VkImageView imageView, VkSampler sampler)
+{
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = imageView;
+    imageInfo.sampler = sampler;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = m_resourceDescriptorSet;
+    descriptorWrite.dstBinding = binding;
+    descriptorWrite.dstArrayElement = slot;
+    descriptorWrite.descriptorType = type;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(m_renderContext.device(), 1, &descriptorWrite, 0, nullptr);
+}
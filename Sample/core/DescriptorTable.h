@@ -1,60 +1,98 @@
 #pragma once
 
-#include <utils/Material.h> 
+#include <utils/Material.h>
 
 #include <vulkan/vulkan.h>
 #include <vector>
-#include <unordered_map>
 #include <memory>
 
 #include "RenderContext.h"
+#include "UniformArena.h"
 
 struct DescriptorEntry {
     VkDescriptorSet descriptorSet;
-    VkBuffer buffer;
-    VkDeviceMemory memory;
+    // offset of the uniform data inside the arena, bound as a dynamic offset
+    uint32_t dynamicOffset;
 };
 
-class FrameDescriptor
+/*
+    Bindless descriptor model, every pipeline share the same layout:
+        - set 0: frame data, the matrix buffer (dynamic offset) and a storage view of the uniform arena
+        - set 1: global arrays of textures, samplers, storage buffers and storage images indexed from the push constants
+    Both sets are bound once per frame whatever the number of objects, the compute passes use the same layout.
+*/
+class DescriptorTable
 {
 public:
-    FrameDescriptor() = default;
+    // set 0
+    static constexpr uint32_t matrixBinding = 0;
+    static constexpr uint32_t objectDataBinding = 1;
+    // set 1
+    static constexpr uint32_t texture2DBinding = 0;
+    static constexpr uint32_t texture3DBinding = 1;
+    static constexpr uint32_t samplerBinding = 2;
+    static constexpr uint32_t storageBufferBinding = 3;
+    static constexpr uint32_t storageImageBinding = 4;
 
-public:
-    void initialize(const std::vector<Material*>& materials);
-    void cleanUp(RenderContext& renderContext);
-    DescriptorEntry& getDescriptorEntry(MaterialID materialId);
-    DescriptorEntry& getGlobalDescriptorEntry();
+    static constexpr uint32_t maxTextures2D = 256;
+    static constexpr uint32_t maxTextures3D = 32;
+    static constexpr uint32_t maxSamplers = 16;
+    static constexpr uint32_t maxStorageBuffers = 64;
+    static constexpr uint32_t maxStorageImages = 16;
 
-private:
-    std::unordered_map<MaterialID, DescriptorEntry> m_descriptors;
-    DescriptorEntry m_globalDescriptorEntry;
-};
-
-class DescriptorTable 
-{
 public:
     DescriptorTable(RenderContext& renderContext);
 
 public:
     void addMaterial(Material* material);
+    // Arena space per frame needed by data growing with the scene, before createDescriptorBuffers
+    void reserveUniformData(VkDeviceSize frameSize);
 
     void createDescriptorPool();
     void createDescriptorLayouts();
     void createDescriptorBuffers();
-    void createFrameDescriptors();
+    void createDescriptorSets();
     void cleanUp();
 
-    FrameDescriptor& getFrameDescriptor(size_t frameIndex);
-    DescriptorEntry& getGlobalDescriptor(size_t frameIndex);
+    // Write the resource in the next free slot of its array, the slot is the index to push
+    uint32_t addTexture2D(VkImageView imageView);
+    uint32_t addTexture3D(VkImageView imageView);
+    uint32_t addSampler(VkSampler sampler);
+    uint32_t addStorageBuffer(VkBuffer buffer, VkDeviceSize range);
+    // Written by compute passes, the image must be in the general layout when accessed
+    uint32_t addStorageImage(VkImageView imageView);
+    // Point an existing slot to a new view, the previous one must not be in use anymore
+    void updateTexture2D(uint32_t slot, VkImageView imageView);
+    void updateTexture3D(uint32_t slot, VkImageView imageView);
+    void updateStorageImage(uint32_t slot, VkImageView imageView);
+
+    void bindDescriptorSets(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+    DescriptorEntry& getGlobalDescriptor();
+    VkDescriptorSet resourceDescriptorSet() const;
     VkDescriptorSetLayout globalDescriptorLayout() const;
+    VkDescriptorSetLayout resourceDescriptorLayout() const;
+    VkPipelineLayout pipelineLayout() const;
+    UniformArena& uniformArena();
 
-    std::vector<DescriptorEntry> getMaterialDescriptors(MaterialID materialId);
+private:
+    void writeImage(uint32_t binding, uint32_t slot, VkDescriptorType type, VkImageView imageView, VkSampler sampler);
 
 private:
     RenderContext& m_renderContext;
     VkDescriptorPool m_descriptorPool;
-    std::vector<FrameDescriptor> m_frameDescriptors;
     std::vector<Material*> m_materials;
     VkDescriptorSetLayout m_globalUniformDescriptorLayout;
+    VkDescriptorSetLayout m_resourceDescriptorLayout;
+    VkPipelineLayout m_pipelineLayout;
+    DescriptorEntry m_globalDescriptor;
+    VkDescriptorSet m_resourceDescriptorSet;
+    std::unique_ptr<UniformArena> m_uniformArena;
+    VkDeviceSize m_reservedUniformSize;
+
+    uint32_t m_texture2DCount;
+    uint32_t m_texture3DCount;
+    uint32_t m_samplerCount;
+    uint32_t m_storageBufferCount;
+    uint32_t m_storageImageCount;
 };
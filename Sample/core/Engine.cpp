@@ -1,17 +1,33 @@
 #include "Engine.h"
+#include "VkInitializer.h"
 #include <utils/ShaderLoader.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/string_cast.hpp>
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <fstream>
+#include <iostream>
 
 /* --------------------------------- Constructors --------------------------------- */
 
 Engine::Engine(const VkInstance& vkInstance, const VkSurfaceKHR& surface, const VkPhysicalDevice& device):
     m_renderContext(nullptr),
+    m_mainRenderPassFormat(VK_FORMAT_UNDEFINED),
+    m_volumetricRenderPass(VK_NULL_HANDLE),
+    m_volumetricFrameBuffer(VK_NULL_HANDLE),
+    m_volumetricExtent({ 0, 0 }),
+    m_volumetricDivisor(1),
+    m_volumetricScale(1.0f),
+    m_fogPath(FogPath::Raster),
+    m_resolveFrameBuffers({ VK_NULL_HANDLE, VK_NULL_HANDLE }),
+    m_historyIndex(0),
+    m_renderGraph(nullptr),
     m_renderScene(nullptr),
-    m_descriptorTable(nullptr)
+    m_descriptorTable(nullptr),
+    m_gpuProfiler(nullptr)
 {
     m_renderContext = std::make_unique<RenderContext>(vkInstance, surface, device);
 }
@@ -31,42 +47,140 @@ void Engine::initialize(Window* window, const SwapChainSupportInfos& swapChainSu
     m_windowHeight = window->height();
     VkExtent2D dimension = { m_windowWidth, m_windowHeight };
 
-    m_renderContext->createLogicalDevice();
     m_renderContext->pickGraphicQueue();
+    m_renderContext->createLogicalDevice();
     m_renderContext->pickDepthImageFormat();
     m_renderContext->pickSampleCount();
     m_renderContext->createSwapChain(dimension, swapChainSupport);
 
-    createMainRenderPass();
+    initializeRenderer(window, viewParams);
+}
 
-    m_renderContext->createFrameBuffers(m_mainRenderPass);
-    m_renderContext->createCommandPool();
+void Engine::initializeOffscreen(const VkExtent2D& dimension, uint32_t imageCount, ViewParams& viewParams)
+{
+    m_windowWidth = dimension.width;
+    m_windowHeight = dimension.height;
 
-    // Graphic Interface
-    createGraphicInterface(window, viewParams);
-    // Scene Managements
-    m_renderScene = std::make_unique<RenderScene>();
-    // Shader Uniforms
-    m_descriptorTable = std::make_unique<DescriptorTable>(*m_renderContext);
+    m_renderContext->pickGraphicQueue();
+    m_renderContext->createLogicalDevice();
+    m_renderContext->pickDepthImageFormat();
+    m_renderContext->pickSampleCount();
+    m_renderContext->createOffscreenSwapChain(dimension, imageCount);
 
-    // Mesh, Material, Textures & Shaders
-    m_renderScene->initialize(*m_renderContext, *m_descriptorTable, viewParams);
+    initializeRenderer(nullptr, viewParams);
+}
 
-    // Descriptor 
-    m_descriptorTable->createDescriptorPool();
-    m_descriptorTable->createDescriptorLayouts();
-    m_descriptorTable->createDescriptorBuffers();
-    m_descriptorTable->createFrameDescriptors();
+/*
+    Without a surface there is no acquire and no present, the images are used in turn and
+    the submission only signals the fence of the image
+*/
+void Engine::waitOffscreenFrame()
+{
+    CPU_ZONE("Wait fence");
+    const VkFence& fence = m_renderContext->getRenderFrame(m_currentFrame).synchronizationFence();
+    vkWaitForFences(m_renderContext->device(), 1, &fence, VK_TRUE, UINT64_MAX);
+}
 
-    // Pipelines
-    m_renderScene->createGraphicPipelines(*m_renderContext, m_mainRenderPass, *m_descriptorTable);
+uint32_t Engine::drawOffscreenFrame(Camera& camera, ViewParams& viewParams)
+{
+    CPU_ZONE("Engine::drawOffscreenFrame");
+    uint32_t imageIndex = m_currentFrame;
 
-    createCommandBuffers();
-    createSyncObjects();
+    // already signaled when the caller waited on its own
+    waitOffscreenFrame();
+    const VkFence& fence = m_renderContext->getRenderFrame(imageIndex).synchronizationFence();
+    vkResetFences(m_renderContext->device(), 1, &fence);
+    m_gpuProfiler->collect(imageIndex);
+    updateDynamicResolution(viewParams);
+
+    updateVolumetricResolution(viewParams);
+    updateUniformBuffer(camera, viewParams, imageIndex);
+    updateCommandBuffer(imageIndex);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_commandBuffers[imageIndex];
+
+    CPU_ZONE("Submit");
+    if (vkQueueSubmit(m_renderContext->graphicsQueue(), 1, &submitInfo, fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit draw command buffer!");
+    }
+
+    m_currentFrame = (m_currentFrame + 1) % m_renderContext->swapChain().size();
+    return imageIndex;
+}
+
+/*
+    Copy a finished offscreen image to the host and write it as a binary PPM,
+    only meant for headless captures so it waits for the queue
+*/
+void Engine::captureFrame(uint32_t imageIndex, const std::string& path)
+{
+    const VkFence& fence = m_renderContext->getRenderFrame(imageIndex).synchronizationFence();
+    vkWaitForFences(m_renderContext->device(), 1, &fence, VK_TRUE, UINT64_MAX);
+
+    uint32_t width = m_renderContext->width();
+    uint32_t height = m_renderContext->height();
+    VkDeviceSize size = VkDeviceSize(width) * height * 4;
+    VkBuffer readbackBuffer;
+    VkDeviceMemory readbackMemory;
+    m_renderContext->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer, readbackMemory);
+
+    VkCommandBuffer commandBuffer = m_renderContext->beginSingleTimeCommands();
+    VkImage image = m_renderContext->swapChain().images()[imageIndex];
+
+    // the render pass left the image in the back buffer layout, make its writes visible to the copy
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = m_renderContext->backBufferLayout();
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageExtent = { width, height, 1 };
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+    m_renderContext->endSingleTimeCommands(commandBuffer);
+
+    void* data;
+    vkMapMemory(m_renderContext->device(), readbackMemory, 0, size, 0, &data);
+    const unsigned char* pixels = static_cast<const unsigned char*>(data);
+    bool bgra = m_renderContext->swapChain().currentImageFormat() == VK_FORMAT_B8G8R8A8_SRGB
+        || m_renderContext->swapChain().currentImageFormat() == VK_FORMAT_B8G8R8A8_UNORM;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (file.is_open()) {
+        file << "P6\n" << width << " " << height << "\n255\n";
+        std::vector<unsigned char> row(width * 3);
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                const unsigned char* pixel = pixels + (VkDeviceSize(y) * width + x) * 4;
+                row[x * 3 + 0] = bgra ? pixel[2] : pixel[0];
+                row[x * 3 + 1] = pixel[1];
+                row[x * 3 + 2] = bgra ? pixel[0] : pixel[2];
+            }
+            file.write(reinterpret_cast<const char*>(row.data()), row.size());
+        }
+    }
+    else {
+        std::cout << "failed to write capture " << path << std::endl;
+    }
+
+    vkUnmapMemory(m_renderContext->device(), readbackMemory);
+    vkDestroyBuffer(m_renderContext->device(), readbackBuffer, nullptr);
+    vkFreeMemory(m_renderContext->device(), readbackMemory, nullptr);
 }
 
 void Engine::drawFrame(Camera& camera, ViewParams& viewParams)
 {
+    CPU_ZONE("Engine::drawFrame");
     uint32_t imageIndex;
     VkResult result = vkAcquireNextImageKHR(m_renderContext->device(), m_renderContext->swapChain().vkSwapChain(), UINT64_MAX, m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &imageIndex);
 
@@ -80,12 +194,18 @@ void Engine::drawFrame(Camera& camera, ViewParams& viewParams)
 
     const RenderFrame& currentFrame = m_renderContext->getRenderFrame(imageIndex);
     const VkFence& fence = currentFrame.synchronizationFence();
-    vkWaitForFences(m_renderContext->device(), 1, &fence, VK_TRUE, UINT64_MAX);
+    {
+        CPU_ZONE("Wait fence");
+        vkWaitForFences(m_renderContext->device(), 1, &fence, VK_TRUE, UINT64_MAX);
+    }
     vkResetFences(m_renderContext->device(), 1, &fence);
+    m_gpuProfiler->collect(imageIndex);
+    updateDynamicResolution(viewParams);
 
     // --------------------------------- Update UI ---------------------------------
     
     m_graphicInterface->draw(*m_renderContext);
+    updateVolumetricResolution(viewParams);
 
     // --------------------------------- Submit command ---------------------------------
 
@@ -107,6 +227,7 @@ void Engine::drawFrame(Camera& camera, ViewParams& viewParams)
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
+    CPU_ZONE("Submit & present");
     if (vkQueueSubmit(m_renderContext->graphicsQueue(), 1, &submitInfo, currentFrame.synchronizationFence()) != VK_SUCCESS) {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
@@ -151,12 +272,18 @@ void Engine::recreateSwapChain()
 
     auto extent = VkExtent2D({ m_windowWidth, m_windowHeight });
     m_renderContext->createSwapChain(extent, m_swapChainSupportInfo);
-    // Renderpass
-    createMainRenderPass();
-    // Pipeline
-    m_renderScene->createGraphicPipelines(*m_renderContext, m_mainRenderPass, *m_descriptorTable);
+    // Renderpass & Pipeline, viewport and scissor are dynamic so a resize keeps them
+    if (m_renderContext->swapChain().currentImageFormat() != m_mainRenderPassFormat) {
+        m_renderScene->destroyGraphicPipelines(*m_renderContext);
+        vkDestroyRenderPass(m_renderContext->device(), m_mainRenderPass, nullptr);
+        createMainRenderPass();
+        m_renderScene->createGraphicPipelines(*m_renderContext, m_mainRenderPass, m_volumetricRenderPass, *m_descriptorTable);
+    }
+    createRenderGraph();
     // FrameBuffers
-    m_renderContext->createFrameBuffers(m_mainRenderPass);
+    m_renderContext->createFrameBuffers(m_mainRenderPass, m_renderGraph->imageView(m_sceneColor), m_renderGraph->imageView(m_sceneDepth));
+    createVolumetricTargets();
+    bindFogTargets();
     // Command buffers
     createCommandBuffers();
 }
@@ -164,10 +291,16 @@ void Engine::recreateSwapChain()
 void Engine::cleanUp()
 {
     cleanUpSwapchain();
+    m_renderScene->destroyGraphicPipelines(*m_renderContext);
+    vkDestroyRenderPass(m_renderContext->device(), m_mainRenderPass, nullptr);
+    vkDestroyRenderPass(m_renderContext->device(), m_volumetricRenderPass, nullptr);
 
-    m_graphicInterface->cleanUp(*m_renderContext);
+    if (m_graphicInterface) {
+        m_graphicInterface->cleanUp(*m_renderContext);
+    }
     m_renderScene->cleanUp(*m_renderContext);
     m_descriptorTable->cleanUp();
+    m_gpuProfiler->cleanUp();
 
     for (size_t i = 0; i < m_imageAvailableSemaphores.size(); i++) {
         vkDestroySemaphore(m_renderContext->device(), m_renderFinishedSemaphores[i], nullptr);
@@ -178,11 +311,12 @@ void Engine::cleanUp()
 
 void Engine::cleanUpSwapchain()
 {
+    cleanUpVolumetricTargets();
     m_renderContext->cleanUpFrameBuffers();
+    m_renderGraph->cleanUp(*m_renderContext);
+    m_renderGraph.reset();
 
     vkFreeCommandBuffers(m_renderContext->device(), m_renderContext->commandPool(), static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
-    m_renderScene->destroyGraphicPipelines(*m_renderContext);
-    vkDestroyRenderPass(m_renderContext->device(), m_mainRenderPass, nullptr);
 
     m_renderContext->cleanUpSwapChain();
 }
@@ -192,13 +326,63 @@ RenderContext* Engine::renderContext()
     return m_renderContext.get();
 }
 
+GpuProfiler* Engine::gpuProfiler()
+{
+    return m_gpuProfiler.get();
+}
+
 /* --------------------------------- Private methods --------------------------------- */
 
+void Engine::initializeRenderer(Window* window, ViewParams& viewParams)
+{
+    // one set of queries per swapchain image, read back once its fence is signaled
+    m_gpuProfiler = std::make_unique<GpuProfiler>(*m_renderContext);
+    m_gpuProfiler->create(m_renderContext->swapChain().size());
+
+    m_volumetricDivisor = viewParams.volumetricDivisor();
+    m_fogPath = viewParams.fogPath();
+    createMainRenderPass();
+    createVolumetricRenderPass();
+    createRenderGraph();
+
+    m_renderContext->createFrameBuffers(m_mainRenderPass, m_renderGraph->imageView(m_sceneColor), m_renderGraph->imageView(m_sceneDepth));
+    m_renderContext->createCommandPool();
+    createVolumetricTargets();
+
+    // Graphic Interface, none in headless
+    if (window) {
+        createGraphicInterface(window, viewParams);
+    }
+    // Scene Managements
+    m_renderScene = std::make_unique<RenderScene>();
+    // Shader Uniforms
+    m_descriptorTable = std::make_unique<DescriptorTable>(*m_renderContext);
+
+    // Mesh, Material, Textures & Shaders
+    m_renderScene->initialize(*m_renderContext, *m_descriptorTable, viewParams);
+
+    // Descriptor 
+    m_descriptorTable->createDescriptorPool();
+    m_descriptorTable->createDescriptorLayouts();
+    m_descriptorTable->createDescriptorBuffers();
+    m_descriptorTable->createDescriptorSets();
+    bindFogTargets();
+    m_renderScene->registerCullingBuffers(*m_descriptorTable);
+
+    // Pipelines
+    m_renderScene->createGraphicPipelines(*m_renderContext, m_mainRenderPass, m_volumetricRenderPass, *m_descriptorTable);
+
+    createCommandBuffers();
+    createSyncObjects();
+}
+
 void Engine::updateUniformBuffer(Camera& camera, ViewParams& viewParams, uint32_t imageIndex)
 {
-    auto& frameDescriptors = m_descriptorTable->getFrameDescriptor(imageIndex);
-    auto& globalDescritpor = m_descriptorTable->getGlobalDescriptor(imageIndex);
-    m_renderScene->updateUniforms(*m_renderContext, camera, viewParams, *m_descriptorTable, frameDescriptors, globalDescritpor);
+    // the fence of this swapchain image was waited, its arena region can be rewritten
+    m_descriptorTable->uniformArena().beginFrame(imageIndex);
+    m_historyIndex = 1 - m_historyIndex;
+    m_renderScene->setFogHistoryIndex(m_historyIndex);
+    m_renderScene->updateUniforms(*m_renderContext, camera, viewParams, *m_descriptorTable);
 }
 
 void Engine::createMainRenderPass()
@@ -208,7 +392,7 @@ void Engine::createMainRenderPass()
     colorAttachment.samples = m_renderContext->multiSamplingSamples();
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
     colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
     VkAttachmentDescription depthAttachment{};
@@ -218,7 +402,7 @@ void Engine::createMainRenderPass()
     depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
     depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
     VkAttachmentDescription colorAttachmentResolve{};
@@ -228,8 +412,8 @@ void Engine::createMainRenderPass()
     colorAttachmentResolve.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachmentResolve.finalLayout = m_renderContext->backBufferLayout();
 
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
@@ -250,19 +434,10 @@ void Engine::createMainRenderPass()
     subpass.pDepthStencilAttachment = &depthAttachmentRef;
     subpass.pResolveAttachments = &colorAttachmentResolveRef;
 
-    /* Start the RenderPass when the piepeline is ready to write to the color attachment*/
-    VkSubpassDependency dependency{};
-    // Implicit before and after subpass
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    // the current subpass
-    dependency.dstSubpass = 0;
-    // which state to wait
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.srcAccessMask = 0;
-    // which state to wait
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    // when the transition start
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    /* 
+        No external subpass dependency, the render graph already transitioned the attachments
+        and waited for their previous users before the render pass starts
+    */
 
     std::array<VkAttachmentDescription, 3> attachments = { colorAttachment, depthAttachment, colorAttachmentResolve };
     VkRenderPassCreateInfo renderPassInfo{};
@@ -271,18 +446,177 @@ void Engine::createMainRenderPass()
     renderPassInfo.pAttachments = attachments.data();
     renderPassInfo.subpassCount = 1;
     renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
+    renderPassInfo.dependencyCount = 0;
+    renderPassInfo.pDependencies = nullptr;
 
     if (vkCreateRenderPass(m_renderContext->device(), &renderPassInfo, nullptr, &m_mainRenderPass) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render pass!");
     }
+    m_mainRenderPassFormat = m_renderContext->swapChain().currentImageFormat();
+}
+
+/*
+    Single sample float target holding the fog color and, in alpha, the distance at which the
+    ray enters the box. Misses keep the -1 clear value so the upsample can skip them
+*/
+void Engine::createVolumetricRenderPass()
+{
+    VkAttachmentDescription colorAttachment{};
+    colorAttachment.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+
+    // the render graph moves the target to shader read for the pass reading it
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 0;
+    renderPassInfo.pDependencies = nullptr;
+
+    if (vkCreateRenderPass(m_renderContext->device(), &renderPassInfo, nullptr, &m_volumetricRenderPass) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create volumetric render pass!");
+    }
+}
+
+void Engine::createVolumetricTargets()
+{
+    // the compute path writes the fog target as a storage image, the froxel path doesn't use it
+    m_volumetricFrameBuffer = VK_NULL_HANDLE;
+    if (m_fogPath == FogPath::Raster) {
+        VkImageView attachment = m_renderGraph->imageView(m_fogTarget);
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = m_volumetricRenderPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = &attachment;
+        framebufferInfo.width = m_volumetricExtent.width;
+        framebufferInfo.height = m_volumetricExtent.height;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(m_renderContext->device(), &framebufferInfo, nullptr, &m_volumetricFrameBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create volumetric framebuffer!");
+        }
+    }
+
+    // The history outlives the frame so it isn't a transient of the graph, it is imported
+    VkCommandBuffer commandBuffer = m_renderContext->beginSingleTimeCommands();
+    for (size_t i = 0; i < m_fogHistory.size(); i++) {
+        Image image;
+        image.Vkformat = VK_FORMAT_R16G16B16A16_SFLOAT;
+        image.mipLevels = 1;
+        image.aspectFlag = VK_IMAGE_ASPECT_COLOR_BIT;
+        image.textureSize = { m_volumetricExtent.width, m_volumetricExtent.height, 1 };
+        vk_initializer::createImage(m_renderContext->device(), m_renderContext->physicalDevice(), m_volumetricExtent.width, m_volumetricExtent.height, 1, VK_SAMPLE_COUNT_1_BIT,
+            image.Vkformat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            image.Vkimage, image.Vkmemory);
+        m_fogHistory[i] = ImageView(m_renderContext->device(), image, VK_IMAGE_VIEW_TYPE_2D);
+
+        // between two frames both images wait in shader read, their content is ignored until written once
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image.Vkimage;
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        attachment = m_fogHistory[i].view();
+        if (vkCreateFramebuffer(m_renderContext->device(), &framebufferInfo, nullptr, &m_resolveFrameBuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create resolve framebuffer!");
+        }
+    }
+    m_renderContext->endSingleTimeCommands(commandBuffer);
+}
+
+void Engine::cleanUpVolumetricTargets()
+{
+    vkDestroyFramebuffer(m_renderContext->device(), m_volumetricFrameBuffer, nullptr);
+    for (size_t i = 0; i < m_fogHistory.size(); i++) {
+        vkDestroyFramebuffer(m_renderContext->device(), m_resolveFrameBuffers[i], nullptr);
+        m_fogHistory[i].cleanUp(m_renderContext->device());
+    }
+}
+
+/*
+    The fog target size is baked in the graph and the framebuffers, the pipelines don't
+    depend on it so only those are rebuilt
+*/
+void Engine::updateVolumetricResolution(ViewParams& viewParams)
+{
+    if (viewParams.volumetricDivisor() == m_volumetricDivisor && viewParams.fogPath() == m_fogPath) {
+        return;
+    }
+    m_volumetricDivisor = viewParams.volumetricDivisor();
+    m_fogPath = viewParams.fogPath();
+
+    vkDeviceWaitIdle(m_renderContext->device());
+    cleanUpVolumetricTargets();
+    m_renderContext->cleanUpFrameBuffers();
+    m_renderGraph->cleanUp(*m_renderContext);
+
+    createRenderGraph();
+    m_renderContext->createFrameBuffers(m_mainRenderPass, m_renderGraph->imageView(m_sceneColor), m_renderGraph->imageView(m_sceneDepth));
+    createVolumetricTargets();
+    bindFogTargets();
+}
+
+void Engine::bindFogTargets()
+{
+    // only the images of the active path are allocated by the graph
+    if (m_fogPath == FogPath::Froxel) {
+        m_renderScene->setFroxelTargets(*m_descriptorTable, m_renderGraph->imageView(m_froxelScattering), m_renderGraph->imageView(m_froxelIntegrated));
+        return;
+    }
+    VkImageView fogTarget = m_renderGraph->imageView(m_fogTarget);
+    m_renderScene->setFogTargets(*m_descriptorTable, fogTarget, m_fogHistory[0].view(), m_fogHistory[1].view(), m_fogPath == FogPath::Compute ? fogTarget : VK_NULL_HANDLE);
+}
+
+/*
+    Only the viewport changes with the scale so the graph, the framebuffers and the history
+    are kept, the resolve reprojects from the scale of the previous frame
+*/
+void Engine::updateDynamicResolution(ViewParams& viewParams)
+{
+    if (!viewParams.dynamicResolution() || !m_gpuProfiler->isEnabled()) {
+        m_resolutionController.reset();
+    }
+    else {
+        m_resolutionController.setTargetFrameTime(viewParams.targetFrameTime());
+        m_resolutionController.setAdjustSteps(viewParams.dynamicSteps());
+        m_resolutionController.update(m_gpuProfiler->lastFrameTime());
+    }
+    m_volumetricScale = m_resolutionController.renderScale();
+    viewParams.setRenderScale(m_volumetricScale);
+    viewParams.setStepScale(m_resolutionController.stepScale());
 }
 
 void Engine::createGraphicInterface(Window* window, ViewParams& viewParams)
 {
     m_graphicInterface = std::make_unique<FogMenu>(viewParams);
     m_graphicInterface->initialize(window, *m_renderContext, m_mainRenderPass);
+    m_graphicInterface->setGpuProfiler(m_gpuProfiler.get());
 }
 
 void Engine::createCommandBuffers()
@@ -319,6 +653,7 @@ void Engine::createCommandBuffers()
 
 void Engine::updateCommandBuffer(uint32_t imageIndex)
 {
+    CPU_ZONE("Engine::updateCommandBuffer");
     vkResetCommandBuffer(m_commandBuffers[imageIndex], 0);
     //vkResetCommandBuffer(m_commandBuffers[imageIndex], VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
 
@@ -339,6 +674,236 @@ void Engine::updateCommandBuffer(uint32_t imageIndex)
 }
 
 void Engine::fillCommandBuffers(uint32_t imageIndex)
+{
+    VkImage backBuffer = m_renderContext->swapChain().images()[imageIndex];
+    VkImageView backBufferView = m_renderContext->getRenderFrame(imageIndex).getImageView();
+    m_renderGraph->bindImportedImage(m_backBuffer, backBuffer, backBufferView);
+    const ImageView& historyWrite = m_fogHistory[m_historyIndex];
+    const ImageView& historyRead = m_fogHistory[1 - m_historyIndex];
+    m_renderGraph->bindImportedImage(m_historyWrite, historyWrite.imageInfo.Vkimage, historyWrite.view());
+    m_renderGraph->bindImportedImage(m_historyRead, historyRead.imageInfo.Vkimage, historyRead.view());
+    const GpuCulling& gpuCulling = m_renderScene->gpuCulling();
+    m_renderGraph->bindImportedBuffer(m_cullObjects, gpuCulling.objectBuffer());
+    m_renderGraph->bindImportedBuffer(m_instanceCounts, gpuCulling.instanceCountBuffer());
+    m_renderGraph->bindImportedBuffer(m_drawSlots, gpuCulling.drawSlotBuffer());
+    m_renderGraph->bindImportedBuffer(m_drawCommands, gpuCulling.commandBuffer());
+    m_renderGraph->bindImportedBuffer(m_drawCounts, gpuCulling.countBuffer());
+    m_renderGraph->bindImportedBuffer(m_visibleInstances, gpuCulling.visibleInstanceBuffer());
+    m_renderGraph->bindImportedBuffer(m_geometryIndices, m_renderScene->geometryArena().indexBuffer());
+    m_gpuProfiler->beginFrame(m_commandBuffers[imageIndex], imageIndex);
+    m_renderGraph->execute(m_commandBuffers[imageIndex], imageIndex);
+}
+
+/*
+    Declare every pass with the resources it reads and writes, the graph derives the barriers
+    and the layout transitions, culls the unused passes and aliases the transient attachments
+*/
+void Engine::createRenderGraph()
+{
+    m_renderGraph = std::make_unique<RenderGraph>();
+    m_renderGraph->setProfiler(m_gpuProfiler.get());
+    VkExtent3D extent = { m_renderContext->dimension().width, m_renderContext->dimension().height, 1 };
+    VkFormat depthFormat = m_renderContext->depthImageFormat();
+    VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT) {
+        depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+
+    ImageResourceDesc backBufferDesc{ extent, m_renderContext->swapChain().currentImageFormat(), VK_SAMPLE_COUNT_1_BIT,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT };
+    ImageResourceDesc sceneColorDesc{ extent, m_renderContext->swapChain().currentImageFormat(), m_renderContext->multiSamplingSamples(),
+        VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT };
+    ImageResourceDesc sceneDepthDesc{ extent, depthFormat, m_renderContext->multiSamplingSamples(),
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthAspect };
+
+    // The acquire semaphore is waited at the color output stage
+    ResourceAccess acquired = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED };
+    m_backBuffer = m_renderGraph->importImage("BackBuffer", backBufferDesc, acquired, m_renderContext->backBufferLayout());
+    m_sceneColor = m_renderGraph->createImage("SceneColor", sceneColorDesc);
+    m_sceneDepth = m_renderGraph->createImage("SceneDepth", sceneDepthDesc);
+    m_renderGraph->markOutput(m_backBuffer);
+
+    // The culling outputs are owned by the scene, bound every frame like the back buffer.
+    // The draws of the previous frame are the last ones reading them, the cull objects persist between frames
+    m_cullObjects = m_renderGraph->importBuffer("CullObjects", VK_NULL_HANDLE, VK_WHOLE_SIZE, render_graph::computeStorageRead());
+    m_instanceCounts = m_renderGraph->importBuffer("InstanceCounts", VK_NULL_HANDLE, VK_WHOLE_SIZE, render_graph::computeStorageRead());
+    m_drawSlots = m_renderGraph->importBuffer("DrawSlots", VK_NULL_HANDLE, VK_WHOLE_SIZE, render_graph::computeStorageRead());
+    m_drawCommands = m_renderGraph->importBuffer("DrawCommands", VK_NULL_HANDLE, VK_WHOLE_SIZE, render_graph::indirectCommandRead());
+    m_drawCounts = m_renderGraph->importBuffer("DrawCounts", VK_NULL_HANDLE, VK_WHOLE_SIZE, render_graph::indirectCommandRead());
+    m_visibleInstances = m_renderGraph->importBuffer("VisibleInstances", VK_NULL_HANDLE, VK_WHOLE_SIZE, render_graph::vertexShaderRead());
+    // the index buffer of every mesh, the cluster culling rewrites the ranges of the large ones
+    m_geometryIndices = m_renderGraph->importBuffer("GeometryIndices", VK_NULL_HANDLE, VK_WHOLE_SIZE, render_graph::indexRead());
+
+    // Only the cull objects changed since the previous frame, copied from the arena
+    RenderGraphPass& uploadPass = m_renderGraph->addPass("CullUpload");
+    uploadPass.write(m_cullObjects, render_graph::transferWrite());
+    uploadPass.setExecute([this](VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        m_renderScene->uploadCullObjects(commandBuffer, m_gpuProfiler.get());
+    });
+
+    // Frustum culling of every scene object, before any pass drawing them
+    RenderGraphPass& cullPass = m_renderGraph->addPass("SceneCull");
+    cullPass.read(m_cullObjects, render_graph::computeStorageRead());
+    cullPass.write(m_instanceCounts, render_graph::computeShaderWrite(), true);
+    cullPass.write(m_visibleInstances, render_graph::computeShaderWrite(), true);
+    cullPass.setExecute([this](VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        m_renderScene->dispatchCulling(commandBuffer, *m_descriptorTable, m_gpuProfiler.get());
+    });
+
+    // The commands of the visible objects packed per bucket, with one draw count each
+    RenderGraphPass& compactPass = m_renderGraph->addPass("DrawCompact");
+    compactPass.read(m_cullObjects, render_graph::computeStorageRead());
+    compactPass.read(m_instanceCounts, render_graph::computeStorageRead());
+    compactPass.write(m_drawCommands, render_graph::computeShaderWrite(), true);
+    compactPass.write(m_drawCounts, render_graph::computeShaderWrite(), true);
+    compactPass.write(m_drawSlots, render_graph::computeShaderWrite(), true);
+    compactPass.setExecute([this](VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        m_renderScene->dispatchDrawCompaction(commandBuffer, *m_descriptorTable, m_gpuProfiler.get());
+    });
+
+    // Meshlets of the large meshes, their index counts are added atomically to the packed commands,
+    // found through the draw slot of their object. The indices of the meshlets are read from the buffer the visible ones are copied to
+    RenderGraphPass& clusterPass = m_renderGraph->addPass("ClusterCull");
+    clusterPass.read(m_drawSlots, render_graph::computeStorageRead());
+    clusterPass.write(m_drawCommands, render_graph::computeStorageReadWrite());
+    clusterPass.write(m_geometryIndices, render_graph::computeStorageReadWrite());
+    clusterPass.setExecute([this](VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        m_renderScene->dispatchClusterCulling(commandBuffer, *m_descriptorTable, m_gpuProfiler.get());
+    });
+
+    // Rounded up so the last row and column of pixels still have a texel to read
+    m_volumetricExtent = { (extent.width + m_volumetricDivisor - 1) / m_volumetricDivisor, (extent.height + m_volumetricDivisor - 1) / m_volumetricDivisor };
+    ImageResourceDesc fogTargetDesc{ { m_volumetricExtent.width, m_volumetricExtent.height, 1 }, VK_FORMAT_R16G16B16A16_SFLOAT, VK_SAMPLE_COUNT_1_BIT,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT };
+    ImageResourceDesc historyDesc = fogTargetDesc;
+    if (m_fogPath == FogPath::Compute) {
+        fogTargetDesc.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    }
+    m_fogTarget = m_renderGraph->createImage("FogTarget", fogTargetDesc);
+
+    // Fog raymarch at reduced resolution, rasterized box or compute tiles over its screen bounds.
+    // The froxel path doesn't read the history, this chain is culled
+    if (m_fogPath == FogPath::Compute) {
+        RenderGraphPass& computePass = m_renderGraph->addPass("VolumetricCompute");
+        computePass.write(m_fogTarget, render_graph::computeShaderWrite(), true);
+        computePass.setExecute([this](VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+            m_renderScene->dispatchFogCompute(commandBuffer, *m_descriptorTable, m_gpuProfiler.get());
+        });
+    }
+    else {
+        RenderGraphPass& volumetricPass = m_renderGraph->addPass("Volumetric");
+        volumetricPass.read(m_drawCommands, render_graph::indirectCommandRead());
+        volumetricPass.read(m_drawCounts, render_graph::indirectCommandRead());
+        volumetricPass.read(m_geometryIndices, render_graph::indexRead());
+        volumetricPass.writeAttachment(m_fogTarget, render_graph::colorAttachmentWrite(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true);
+        volumetricPass.setExecute([this](VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+            recordVolumetricPass(commandBuffer, m_volumetricFrameBuffer, MaterialPass::Volumetric);
+        });
+    }
+
+    // History images swap every frame, the final barriers of the graph leave both ready for a fragment read
+    m_historyRead = m_renderGraph->importImage("FogHistoryRead", historyDesc, render_graph::fragmentShaderRead(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    m_historyWrite = m_renderGraph->importImage("FogHistoryWrite", historyDesc, render_graph::fragmentShaderRead(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // Blend the raymarch with the reprojected history
+    RenderGraphPass& resolvePass = m_renderGraph->addPass("FogResolve");
+    resolvePass.read(m_drawCommands, render_graph::indirectCommandRead());
+    resolvePass.read(m_drawCounts, render_graph::indirectCommandRead());
+    resolvePass.read(m_geometryIndices, render_graph::indexRead());
+    resolvePass.read(m_fogTarget, render_graph::fragmentShaderRead());
+    resolvePass.read(m_historyRead, render_graph::fragmentShaderRead());
+    resolvePass.writeAttachment(m_historyWrite, render_graph::colorAttachmentWrite(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true);
+    resolvePass.setExecute([this](VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        recordVolumetricPass(commandBuffer, m_resolveFrameBuffers[m_historyIndex], MaterialPass::Resolve);
+    });
+
+    // Froxel volumes, fixed size whatever the screen resolution
+    VkExtent3D froxelExtent = { FroxelFog::gridWidth, FroxelFog::gridHeight, FroxelFog::gridDepth };
+    ImageResourceDesc scatteringDesc{ froxelExtent, FroxelFog::gridFormat, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_TYPE_3D };
+    ImageResourceDesc integratedDesc = scatteringDesc;
+    integratedDesc.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    m_froxelScattering = m_renderGraph->createImage("FroxelScattering", scatteringDesc);
+    m_froxelIntegrated = m_renderGraph->createImage("FroxelIntegrated", integratedDesc);
+
+    // Scattering and extinction of every froxel, then the front to back integration
+    RenderGraphPass& injectPass = m_renderGraph->addPass("FroxelInject");
+    injectPass.write(m_froxelScattering, render_graph::computeShaderWrite(), true);
+    injectPass.setExecute([this](VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        m_renderScene->dispatchFroxelInject(commandBuffer, *m_descriptorTable, m_gpuProfiler.get());
+    });
+
+    RenderGraphPass& integratePass = m_renderGraph->addPass("FroxelIntegrate");
+    integratePass.read(m_froxelScattering, render_graph::computeStorageRead());
+    integratePass.write(m_froxelIntegrated, render_graph::computeShaderWrite(), true);
+    integratePass.setExecute([this](VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        m_renderScene->dispatchFroxelIntegrate(commandBuffer, *m_descriptorTable, m_gpuProfiler.get());
+    });
+
+    // Scene + UI, the resolve attachment leaves the render pass ready to be presented.
+    // The fog composite reads the resolved history or the integrated froxels, the other chain is culled
+    RenderGraphPass& mainPass = m_renderGraph->addPass("Main");
+    if (m_fogPath == FogPath::Froxel) {
+        mainPass.read(m_froxelIntegrated, render_graph::fragmentShaderRead());
+    }
+    else {
+        mainPass.read(m_historyWrite, render_graph::fragmentShaderRead());
+    }
+    // the cloud field reads its visible boxes in the vertex shader
+    mainPass.read(m_drawCommands, render_graph::indirectCommandRead());
+    mainPass.read(m_drawCounts, render_graph::indirectCommandRead());
+    mainPass.read(m_visibleInstances, render_graph::vertexShaderRead());
+    mainPass.read(m_geometryIndices, render_graph::indexRead());
+    mainPass.writeAttachment(m_sceneColor, render_graph::colorAttachmentWrite(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true);
+    mainPass.writeAttachment(m_sceneDepth, render_graph::depthAttachmentWrite(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true);
+    mainPass.writeAttachment(m_backBuffer, render_graph::colorAttachmentWrite(), m_renderContext->backBufferLayout(), true);
+    mainPass.setExecute([this](VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        recordMainPass(commandBuffer, imageIndex);
+    });
+
+    m_renderGraph->compile(*m_renderContext);
+}
+
+void Engine::recordVolumetricPass(VkCommandBuffer commandBuffer, VkFramebuffer frameBuffer, MaterialPass pass)
+{
+    VkClearValue clearValue{};
+    clearValue.color = { {0.0f, 0.0f, 0.0f, -1.0f} };
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = m_volumetricRenderPass;
+    renderPassInfo.framebuffer = frameBuffer;
+    // Scaled corner of the target, the texels around it are never read
+    VkExtent2D scaledExtent = {
+        std::min(static_cast<uint32_t>(std::ceil(m_volumetricExtent.width * m_volumetricScale)), m_volumetricExtent.width),
+        std::min(static_cast<uint32_t>(std::ceil(m_volumetricExtent.height * m_volumetricScale)), m_volumetricExtent.height)
+    };
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = scaledExtent;
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    // Exact fraction of the screen, a low resolution texel covers divisor x divisor pixels
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(m_renderContext->width()) / m_volumetricDivisor * m_volumetricScale;
+    viewport.height = static_cast<float>(m_renderContext->height()) / m_volumetricDivisor * m_volumetricScale;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = scaledExtent;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+    m_renderScene->fillCommandBuffer(*m_renderContext, commandBuffer, *m_descriptorTable, pass, m_gpuProfiler.get());
+
+    vkCmdEndRenderPass(commandBuffer);
+}
+
+void Engine::recordMainPass(VkCommandBuffer commandBuffer, uint32_t imageIndex)
 {
     std::array<VkClearValue, 2> clearValues{};
     clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
@@ -353,15 +918,30 @@ void Engine::fillCommandBuffers(uint32_t imageIndex)
     renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
     renderPassInfo.pClearValues = clearValues.data();
 
-    vkCmdBeginRenderPass(m_commandBuffers[imageIndex], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-    auto& frameDescriptor = m_descriptorTable->getFrameDescriptor(imageIndex);
-    auto& globalDescriptor = m_descriptorTable->getGlobalDescriptor(imageIndex);
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    // Dynamic states of every scene pipeline
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(m_renderContext->width());
+    viewport.height = static_cast<float>(m_renderContext->height());
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = m_renderContext->dimension();
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
     // Fill Scene command buffer
-    m_renderScene->fillCommandBuffer(*m_renderContext, m_commandBuffers[imageIndex], frameDescriptor, globalDescriptor.descriptorSet);
-    m_graphicInterface->fillCommandBuffer(m_commandBuffers[imageIndex]);
+    m_renderScene->fillCommandBuffer(*m_renderContext, commandBuffer, *m_descriptorTable, MaterialPass::Main, m_gpuProfiler.get());
+    if (m_graphicInterface) {
+        GpuScope scope(m_gpuProfiler.get(), commandBuffer, "ImGui", true);
+        m_graphicInterface->fillCommandBuffer(commandBuffer);
+    }
 
-    vkCmdEndRenderPass(m_commandBuffers[imageIndex]);
+    vkCmdEndRenderPass(commandBuffer);
 }
 
 void Engine::createSyncObjects()
@@ -2,15 +2,22 @@
 
 #include "RenderContext.h"
 #include "DescriptorTable.h"
+#include "RenderGraph.h"
+#include "GpuProfiler.h"
+#include "ResolutionController.h"
+#include "CpuProfiler.h"
 #include "Window.h"
 #include <scene/RenderScene.h>
 #include <utils/Camera.h>
 #include <ui/ViewParams.h>
 #include <ui/FogMenu.h>
+#include <utils/ImageView.h>
 
+#include <array>
 #include <memory>
 #include <vector>
 #include <optional>
+#include <string>
 
 class Engine
 {
@@ -20,19 +27,40 @@ public:
 
 public:
     void initialize(Window* window, const SwapChainSupportInfos& swapChainSupport, ViewParams& viewParams);
+    void initializeOffscreen(const VkExtent2D& dimension, uint32_t imageCount, ViewParams& viewParams);
     void createCommandBuffers();
     void updateUniformBuffer(Camera& camera, ViewParams& viewParams, uint32_t imageIndex);
     void updateCommandBuffer(uint32_t imageIndex);
     void fillCommandBuffers(uint32_t imageIndex);
     void drawFrame(Camera& camera, ViewParams& viewParams);
+    // Headless, wait until the image of the next frame is no longer used by the GPU
+    void waitOffscreenFrame();
+    // Headless, returns the offscreen image the frame is rendered into
+    uint32_t drawOffscreenFrame(Camera& camera, ViewParams& viewParams);
+    void captureFrame(uint32_t imageIndex, const std::string& path);
     void resize(int width, int height, const SwapChainSupportInfos& swapChainSupport);
     void cleanUp();
 
 public:
     RenderContext* renderContext();
+    GpuProfiler* gpuProfiler();
 
 private:
+    void initializeRenderer(Window* window, ViewParams& viewParams);
     void createMainRenderPass();
+    void createVolumetricRenderPass();
+    void createRenderGraph();
+    // Framebuffers of the reduced resolution passes and the fog history, sized like the graph target
+    void createVolumetricTargets();
+    void cleanUpVolumetricTargets();
+    // Rebuild the graph when the fog resolution or path changed in the menu
+    void updateVolumetricResolution(ViewParams& viewParams);
+    // Slots of the fog target and history, to call whenever they are recreated
+    void bindFogTargets();
+    // Fraction of the fog target rendered this frame, from the last gpu frame time
+    void updateDynamicResolution(ViewParams& viewParams);
+    void recordVolumetricPass(VkCommandBuffer commandBuffer, VkFramebuffer frameBuffer, MaterialPass pass);
+    void recordMainPass(VkCommandBuffer commandBuffer, uint32_t imageIndex);
     void createGraphicInterface(Window* window, ViewParams& viewParams);
     void createSyncObjects();
     void recreateSwapChain();
@@ -46,6 +74,40 @@ private:
     // RenderPass
     std::unique_ptr<RenderContext> m_renderContext;
     VkRenderPass m_mainRenderPass;
+    // pipelines only depend on the swapchain through the render pass format
+    VkFormat m_mainRenderPassFormat;
+    // Reduced resolution fog, composited by the main pass
+    VkRenderPass m_volumetricRenderPass;
+    VkFramebuffer m_volumetricFrameBuffer;
+    VkExtent2D m_volumetricExtent;
+    uint32_t m_volumetricDivisor;
+    // the passes render into the top left corner of the targets, the allocation never changes
+    float m_volumetricScale;
+    ResolutionController m_resolutionController;
+    // raster writes the fog target in the volumetric render pass, compute as a storage image,
+    // the froxel path replaces both with its volumes
+    FogPath m_fogPath;
+    // Temporal fog, the resolve writes m_fogHistory[m_historyIndex] and reads the other one
+    std::array<ImageView, 2> m_fogHistory;
+    std::array<VkFramebuffer, 2> m_resolveFrameBuffers;
+    uint32_t m_historyIndex;
+    // Frame Graph
+    std::unique_ptr<RenderGraph> m_renderGraph;
+    RenderGraphHandle m_backBuffer;
+    RenderGraphHandle m_sceneColor;
+    RenderGraphHandle m_sceneDepth;
+    RenderGraphHandle m_fogTarget;
+    RenderGraphHandle m_historyRead;
+    RenderGraphHandle m_historyWrite;
+    RenderGraphHandle m_froxelScattering;
+    RenderGraphHandle m_froxelIntegrated;
+    RenderGraphHandle m_cullObjects;
+    RenderGraphHandle m_instanceCounts;
+    RenderGraphHandle m_drawSlots;
+    RenderGraphHandle m_drawCommands;
+    RenderGraphHandle m_drawCounts;
+    RenderGraphHandle m_visibleInstances;
+    RenderGraphHandle m_geometryIndices;
     // Draw commands
     std::vector<VkCommandBuffer> m_commandBuffers;
     // Graphic Interface
@@ -54,6 +116,8 @@ private:
     std::unique_ptr<RenderScene> m_renderScene;
     // Uniforms
     std::unique_ptr<DescriptorTable> m_descriptorTable;
+    // Profiling
+    std::unique_ptr<GpuProfiler> m_gpuProfiler;
 
     // Sync Objects
     uint32_t m_currentFrame;
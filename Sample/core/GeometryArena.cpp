@@ -0,0 +1,137 @@
+#include "GeometryArena.h"
+
+#include <stdexcept>
+#include <cstring>
+
+/* --------------------------------- Constructors --------------------------------- */
+
+GeometryArena::GeometryArena(RenderContext& renderContext):
+    m_renderContext(renderContext),
+    m_vertexSize(0),
+    m_indexSize(0),
+    m_vertexBuffer(VK_NULL_HANDLE),
+    m_vertexMemory(VK_NULL_HANDLE),
+    m_indexBuffer(VK_NULL_HANDLE),
+    m_indexMemory(VK_NULL_HANDLE)
+{
+
+}
+
+GeometryArena::~GeometryArena()
+{
+
+}
+
+/* --------------------------------- Public methods --------------------------------- */
+
+/*
+    The range starts on a multiple of its own stride, the vertex offset of the draws is in vertices.
+    Meshes with another layout only leave a few bytes of padding between them
+*/
+int32_t GeometryArena::addVertices(const void* vertices, VkDeviceSize size, uint32_t stride)
+{
+    if (m_vertexBuffer != VK_NULL_HANDLE) {
+        throw std::runtime_error("failed to add vertices, the geometry arena is already uploaded!");
+    }
+    size_t offset = (m_vertexData.size() + stride - 1) / stride * stride;
+    m_vertexData.resize(offset + size);
+    memcpy(m_vertexData.data() + offset, vertices, static_cast<size_t>(size));
+    return static_cast<int32_t>(offset / stride);
+}
+
+uint32_t GeometryArena::addIndices(const uint32_t* indices, size_t indexCount)
+{
+    if (m_indexBuffer != VK_NULL_HANDLE) {
+        throw std::runtime_error("failed to add indices, the geometry arena is already uploaded!");
+    }
+    uint32_t firstIndex = static_cast<uint32_t>(m_indexData.size());
+    m_indexData.insert(m_indexData.end(), indices, indices + indexCount);
+    return firstIndex;
+}
+
+uint32_t GeometryArena::reserveIndices(size_t indexCount)
+{
+    if (m_indexBuffer != VK_NULL_HANDLE) {
+        throw std::runtime_error("failed to reserve indices, the geometry arena is already uploaded!");
+    }
+    uint32_t firstIndex = static_cast<uint32_t>(m_indexData.size());
+    m_indexData.resize(m_indexData.size() + indexCount, 0);
+    return firstIndex;
+}
+
+void GeometryArena::upload()
+{
+    m_vertexSize = m_vertexData.size();
+    m_indexSize = sizeof(uint32_t) * m_indexData.size();
+    if (m_vertexSize == 0 || m_indexSize == 0) {
+        throw std::runtime_error("failed to upload an empty geometry arena!");
+    }
+    uploadBuffer(m_vertexData.data(), m_vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_vertexBuffer, m_vertexMemory);
+    uploadBuffer(m_indexData.data(), m_indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_indexBuffer, m_indexMemory);
+
+    // the meshes keep their own copy
+    m_vertexData = std::vector<uint8_t>();
+    m_indexData = std::vector<uint32_t>();
+}
+
+void GeometryArena::bind(VkCommandBuffer commandBuffer) const
+{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_vertexBuffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void GeometryArena::cleanUp()
+{
+    if (m_vertexBuffer == VK_NULL_HANDLE) {
+        return;
+    }
+    vkDestroyBuffer(m_renderContext.device(), m_indexBuffer, nullptr);
+    vkFreeMemory(m_renderContext.device(), m_indexMemory, nullptr);
+    vkDestroyBuffer(m_renderContext.device(), m_vertexBuffer, nullptr);
+    vkFreeMemory(m_renderContext.device(), m_vertexMemory, nullptr);
+    m_vertexBuffer = VK_NULL_HANDLE;
+    m_vertexMemory = VK_NULL_HANDLE;
+    m_indexBuffer = VK_NULL_HANDLE;
+    m_indexMemory = VK_NULL_HANDLE;
+}
+
+VkBuffer GeometryArena::vertexBuffer() const
+{
+    return m_vertexBuffer;
+}
+
+VkBuffer GeometryArena::indexBuffer() const
+{
+    return m_indexBuffer;
+}
+
+VkDeviceSize GeometryArena::vertexSize() const
+{
+    return m_vertexSize;
+}
+
+VkDeviceSize GeometryArena::indexSize() const
+{
+    return m_indexSize;
+}
+
+/* --------------------------------- Private methods --------------------------------- */
+
+void GeometryArena::uploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory)
+{
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    m_renderContext.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+    void* mappedData;
+    vkMapMemory(m_renderContext.device(), stagingBufferMemory, 0, size, 0, &mappedData);
+    memcpy(mappedData, data, static_cast<size_t>(size));
+    vkUnmapMemory(m_renderContext.device(), stagingBufferMemory);
+
+    m_renderContext.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, memory);
+    m_renderContext.copyBuffer(stagingBuffer, buffer, size);
+
+    vkDestroyBuffer(m_renderContext.device(), stagingBuffer, nullptr);
+    vkFreeMemory(m_renderContext.device(), stagingBufferMemory, nullptr);
+}
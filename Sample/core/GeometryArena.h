@@ -0,0 +1,51 @@
+#pragma once
+
+#include "RenderContext.h"
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+/*
+    One device local vertex buffer and one index buffer holding every mesh of the scene.
+    The meshes are added at load time, each one gets the vertexOffset / firstIndex of its range,
+    then everything is uploaded at once. Every draw shares the same binding.
+*/
+class GeometryArena
+{
+public:
+    GeometryArena(RenderContext& renderContext);
+    ~GeometryArena();
+
+public:
+    // Returns the vertexOffset of the range, counted in vertices of the given stride
+    int32_t addVertices(const void* vertices, VkDeviceSize size, uint32_t stride);
+    // Returns the firstIndex of the range, the indices stay relative to their vertexOffset
+    uint32_t addIndices(const uint32_t* indices, size_t indexCount);
+    // Range left to the gpu, the index buffer is a storage buffer as well
+    uint32_t reserveIndices(size_t indexCount);
+    // Creates both buffers with the ranges added so far, nothing can be added afterwards
+    void upload();
+    void bind(VkCommandBuffer commandBuffer) const;
+    void cleanUp();
+
+    VkBuffer vertexBuffer() const;
+    VkBuffer indexBuffer() const;
+    VkDeviceSize vertexSize() const;
+    VkDeviceSize indexSize() const;
+
+private:
+    void uploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory);
+
+private:
+    RenderContext& m_renderContext;
+    // kept until the upload
+    std::vector<uint8_t> m_vertexData;
+    std::vector<uint32_t> m_indexData;
+    VkDeviceSize m_vertexSize;
+    VkDeviceSize m_indexSize;
+    VkBuffer m_vertexBuffer;
+    VkDeviceMemory m_vertexMemory;
+    VkBuffer m_indexBuffer;
+    VkDeviceMemory m_indexMemory;
+};
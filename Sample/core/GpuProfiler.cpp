@@ -0,0 +1,306 @@
+#include "GpuProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+// vertex, fragment and compute invocations, written in this bit order by the driver
+static const VkQueryPipelineStatisticFlags statisticFlags =
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+static const uint32_t statisticCount = 3;
+
+/* --------------------------------- Constructors --------------------------------- */
+
+GpuProfiler::GpuProfiler(RenderContext& renderContext):
+    m_renderContext(renderContext),
+    m_currentFrame(0),
+    m_frameNumber(0),
+    m_timestampPeriod(1.0f),
+    m_timestampSupported(false),
+    m_statisticsSupported(false),
+    m_statisticsActive(false),
+    m_recordFrameTimes(false),
+    m_drawScopes(false)
+{
+    m_lastFrameTime = { 0, 0.0f };
+
+}
+
+GpuProfiler::~GpuProfiler()
+{
+
+}
+
+/* --------------------------------- Public methods --------------------------------- */
+
+void GpuProfiler::create(uint32_t frameCount)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_renderContext.physicalDevice(), &properties);
+    m_timestampPeriod = properties.limits.timestampPeriod;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_renderContext.physicalDevice(), &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_renderContext.physicalDevice(), &queueFamilyCount, queueFamilies.data());
+    m_timestampSupported = queueFamilies[m_renderContext.graphicQueueIndex()].timestampValidBits > 0;
+    m_statisticsSupported = m_renderContext.pipelineStatisticsSupported();
+
+    if (!m_timestampSupported) {
+        std::cout << "timestamp queries not supported by the graphic queue, gpu profiler disabled" << std::endl;
+        return;
+    }
+
+    m_frames.resize(frameCount);
+    for (auto& frame : m_frames) {
+        VkQueryPoolCreateInfo timestampInfo{};
+        timestampInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        timestampInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        timestampInfo.queryCount = maxScopes * 2;
+        if (vkCreateQueryPool(m_renderContext.device(), &timestampInfo, nullptr, &frame.timestampPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+
+        frame.statisticsPool = VK_NULL_HANDLE;
+        if (m_statisticsSupported) {
+            VkQueryPoolCreateInfo statisticsInfo{};
+            statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            statisticsInfo.queryCount = maxScopes;
+            statisticsInfo.pipelineStatistics = statisticFlags;
+            if (vkCreateQueryPool(m_renderContext.device(), &statisticsInfo, nullptr, &frame.statisticsPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create pipeline statistics query pool!");
+            }
+        }
+        frame.statisticsCount = 0;
+        frame.frameNumber = 0;
+    }
+}
+
+void GpuProfiler::cleanUp()
+{
+    for (auto& frame : m_frames) {
+        vkDestroyQueryPool(m_renderContext.device(), frame.timestampPool, nullptr);
+        if (frame.statisticsPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(m_renderContext.device(), frame.statisticsPool, nullptr);
+        }
+    }
+    m_frames.clear();
+}
+
+void GpuProfiler::collect(uint32_t frameIndex)
+{
+    if (m_frames.empty()) {
+        return;
+    }
+    FrameQueries& frame = m_frames[frameIndex % m_frames.size()];
+    uint32_t scopeCount = static_cast<uint32_t>(frame.scopeNames.size());
+    if (scopeCount == 0) {
+        return;
+    }
+
+    // No WAIT flag, a frame that isn't ready yet is just skipped
+    std::vector<uint64_t> timestamps(scopeCount * 2);
+    VkResult result = vkGetQueryPoolResults(m_renderContext.device(), frame.timestampPool, 0, scopeCount * 2,
+        timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        return;
+    }
+
+    std::vector<uint64_t> statistics(frame.statisticsCount * statisticCount, 0);
+    if (frame.statisticsCount > 0) {
+        result = vkGetQueryPoolResults(m_renderContext.device(), frame.statisticsPool, 0, frame.statisticsCount,
+            statistics.size() * sizeof(uint64_t), statistics.data(), statisticCount * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) {
+            std::fill(statistics.begin(), statistics.end(), 0);
+        }
+    }
+
+    uint64_t frameStart = UINT64_MAX;
+    uint64_t frameEnd = 0;
+    for (uint32_t scope = 0; scope < scopeCount; scope++) {
+        frameStart = std::min(frameStart, timestamps[scope * 2]);
+        frameEnd = std::max(frameEnd, timestamps[scope * 2 + 1]);
+    }
+    m_lastFrameTime = { frame.frameNumber, static_cast<float>(frameEnd - frameStart) * m_timestampPeriod / 1000000.0f };
+    if (m_recordFrameTimes) {
+        m_frameTimes.push_back(m_lastFrameTime);
+    }
+
+    for (uint32_t scope = 0; scope < scopeCount; scope++) {
+        Sample sample{};
+        sample.frame = frame.frameNumber;
+        sample.milliseconds = static_cast<float>(timestamps[scope * 2 + 1] - timestamps[scope * 2]) * m_timestampPeriod / 1000000.0f;
+        int statisticsQuery = frame.statisticsQueries[scope];
+        if (statisticsQuery >= 0) {
+            sample.vertexInvocations = statistics[statisticsQuery * statisticCount];
+            sample.fragmentInvocations = statistics[statisticsQuery * statisticCount + 1];
+            sample.computeInvocations = statistics[statisticsQuery * statisticCount + 2];
+        }
+
+        ScopeHistory& scopeHistory = history(frame.scopeNames[scope]);
+        scopeHistory.timings[scopeHistory.head] = sample.milliseconds;
+        scopeHistory.samples[scopeHistory.head] = sample;
+        scopeHistory.head = (scopeHistory.head + 1) % historySize;
+        scopeHistory.count = std::min(scopeHistory.count + 1, historySize);
+    }
+    frame.scopeNames.clear();
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    if (m_frames.empty()) {
+        return;
+    }
+    m_currentFrame = frameIndex % m_frames.size();
+    FrameQueries& frame = m_frames[m_currentFrame];
+    frame.scopeNames.clear();
+    frame.statisticsQueries.clear();
+    frame.statisticsCount = 0;
+    frame.frameNumber = m_frameNumber++;
+    m_statisticsActive = false;
+
+    vkCmdResetQueryPool(commandBuffer, frame.timestampPool, 0, maxScopes * 2);
+    if (frame.statisticsPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(commandBuffer, frame.statisticsPool, 0, maxScopes);
+    }
+}
+
+/*
+    Only one pipeline statistics query can be active at a time in a command buffer,
+    a statistics scope nested in another one only gets its timing
+*/
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string& name, bool withStatistics)
+{
+    if (m_frames.empty()) {
+        return maxScopes;
+    }
+    FrameQueries& frame = m_frames[m_currentFrame];
+    uint32_t scope = static_cast<uint32_t>(frame.scopeNames.size());
+    if (scope >= maxScopes) {
+        return maxScopes;
+    }
+
+    frame.scopeNames.push_back(name);
+    frame.statisticsQueries.push_back(-1);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestampPool, scope * 2);
+
+    if (withStatistics && m_statisticsSupported && !m_statisticsActive) {
+        frame.statisticsQueries[scope] = static_cast<int>(frame.statisticsCount);
+        vkCmdBeginQuery(commandBuffer, frame.statisticsPool, frame.statisticsCount, 0);
+        frame.statisticsCount++;
+        m_statisticsActive = true;
+    }
+    return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope)
+{
+    if (scope >= maxScopes) {
+        return;
+    }
+    FrameQueries& frame = m_frames[m_currentFrame];
+    int statisticsQuery = frame.statisticsQueries[scope];
+    if (statisticsQuery >= 0) {
+        vkCmdEndQuery(commandBuffer, frame.statisticsPool, static_cast<uint32_t>(statisticsQuery));
+        m_statisticsActive = false;
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestampPool, scope * 2 + 1);
+}
+
+void GpuProfiler::exportCSV(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        std::cout << "failed to write gpu profile " << path << std::endl;
+        return;
+    }
+
+    file << "frame,scope,gpu_ms,vertex_invocations,fragment_invocations,compute_invocations" << std::endl;
+    for (auto& scopeHistory : m_histories) {
+        // oldest sample first
+        uint32_t first = (scopeHistory.head + historySize - scopeHistory.count) % historySize;
+        for (uint32_t i = 0; i < scopeHistory.count; i++) {
+            const Sample& sample = scopeHistory.samples[(first + i) % historySize];
+            file << sample.frame << "," << scopeHistory.name << "," << sample.milliseconds << ","
+                << sample.vertexInvocations << "," << sample.fragmentInvocations << "," << sample.computeInvocations << std::endl;
+        }
+    }
+    std::cout << "gpu profile written to " << path << std::endl;
+}
+
+const std::vector<GpuProfiler::ScopeHistory>& GpuProfiler::histories() const
+{
+    return m_histories;
+}
+
+bool GpuProfiler::isEnabled() const
+{
+    return !m_frames.empty();
+}
+
+void GpuProfiler::setRecordFrameTimes(bool record)
+{
+    m_recordFrameTimes = record;
+}
+
+const std::vector<GpuProfiler::FrameTime>& GpuProfiler::frameTimes() const
+{
+    return m_frameTimes;
+}
+
+GpuProfiler::FrameTime GpuProfiler::lastFrameTime() const
+{
+    return m_lastFrameTime;
+}
+
+bool GpuProfiler::drawScopes() const
+{
+    return m_drawScopes;
+}
+
+void GpuProfiler::setDrawScopes(bool enabled)
+{
+    m_drawScopes = enabled;
+}
+
+/* --------------------------------- Private methods --------------------------------- */
+
+GpuProfiler::ScopeHistory& GpuProfiler::history(const std::string& name)
+{
+    for (auto& scopeHistory : m_histories) {
+        if (scopeHistory.name == name) {
+            return scopeHistory;
+        }
+    }
+    ScopeHistory scopeHistory;
+    scopeHistory.name = name;
+    scopeHistory.timings.resize(historySize, 0.0f);
+    scopeHistory.samples.resize(historySize, Sample{});
+    scopeHistory.head = 0;
+    scopeHistory.count = 0;
+    m_histories.push_back(scopeHistory);
+    return m_histories.back();
+}
+
+/* --------------------------------- GpuScope --------------------------------- */
+
+GpuScope::GpuScope(GpuProfiler* profiler, VkCommandBuffer commandBuffer, const std::string& name, bool withStatistics):
+    m_profiler(profiler),
+    m_commandBuffer(commandBuffer),
+    m_scope(GpuProfiler::maxScopes)
+{
+    if (m_profiler) {
+        m_scope = m_profiler->beginScope(m_commandBuffer, name, withStatistics);
+    }
+}
+
+GpuScope::~GpuScope()
+{
+    if (m_profiler) {
+        m_profiler->endScope(m_commandBuffer, m_scope);
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "RenderContext.h"
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+/*
+    GPU timings from timestamp queries, with optional pipeline statistics on the leaf scopes.
+    One query pool per swapchain image: the results of a frame are read once its fence has
+    been waited so the readback never stalls the CPU.
+*/
+class GpuProfiler
+{
+public:
+    struct Sample {
+        uint64_t frame;
+        float milliseconds;
+        uint64_t vertexInvocations;
+        uint64_t fragmentInvocations;
+        uint64_t computeInvocations;
+    };
+
+    // Rolling history of one named scope
+    struct ScopeHistory {
+        std::string name;
+        std::vector<float> timings;
+        std::vector<Sample> samples;
+        uint32_t head;
+        uint32_t count;
+    };
+
+    // First scope begin to last scope end of a whole frame
+    struct FrameTime {
+        uint64_t frame;
+        float milliseconds;
+    };
+
+    static constexpr uint32_t maxScopes = 32;
+    static constexpr uint32_t historySize = 128;
+
+public:
+    GpuProfiler(RenderContext& renderContext);
+    ~GpuProfiler();
+
+public:
+    void create(uint32_t frameCount);
+    void cleanUp();
+
+    // Read the results of the last submission of this frame, its fence must have been waited
+    void collect(uint32_t frameIndex);
+    // Reset the queries of the frame, recorded outside of any render pass
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    uint32_t beginScope(VkCommandBuffer commandBuffer, const std::string& name, bool withStatistics = false);
+    void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+    void exportCSV(const std::string& path) const;
+    const std::vector<ScopeHistory>& histories() const;
+    bool isEnabled() const;
+    // Keep every frame time instead of the rolling history, for benchmarks
+    void setRecordFrameTimes(bool record);
+    const std::vector<FrameTime>& frameTimes() const;
+    // Most recent frame read back, its number only changes when a new one was collected
+    FrameTime lastFrameTime() const;
+    // One scope per draw instead of one per material, only to debug a few objects since a frame holds maxScopes
+    bool drawScopes() const;
+    void setDrawScopes(bool enabled);
+
+private:
+    struct FrameQueries {
+        VkQueryPool timestampPool;
+        VkQueryPool statisticsPool;
+        std::vector<std::string> scopeNames;
+        // index in the statistics pool, -1 for timing only scopes
+        std::vector<int> statisticsQueries;
+        uint32_t statisticsCount;
+        uint64_t frameNumber;
+    };
+
+    ScopeHistory& history(const std::string& name);
+
+private:
+    RenderContext& m_renderContext;
+    std::vector<FrameQueries> m_frames;
+    std::vector<ScopeHistory> m_histories;
+    std::vector<FrameTime> m_frameTimes;
+    FrameTime m_lastFrameTime;
+    uint32_t m_currentFrame;
+    uint64_t m_frameNumber;
+    float m_timestampPeriod;
+    bool m_timestampSupported;
+    bool m_statisticsSupported;
+    bool m_statisticsActive;
+    bool m_recordFrameTimes;
+    bool m_drawScopes;
+};
+
+// Time a block of commands for the lifetime of the object
+class GpuScope
+{
+public:
+    GpuScope(GpuProfiler* profiler, VkCommandBuffer commandBuffer, const std::string& name, bool withStatistics = false);
+    ~GpuScope();
+
+private:
+    GpuProfiler* m_profiler;
+    VkCommandBuffer m_commandBuffer;
+    uint32_t m_scope;
+};
@@ -0,0 +1,116 @@
+#include "PipelineCache.h"
+
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+#include <iostream>
+
+/* --------------------------------- Constructors --------------------------------- */
+
+PipelineCache::PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path):
+    m_device(device),
+    m_physicalDevice(physicalDevice),
+    m_path(path),
+    m_pipelineCache(VK_NULL_HANDLE)
+{
+
+}
+
+PipelineCache::~PipelineCache()
+{
+
+}
+
+/* --------------------------------- Public methods --------------------------------- */
+
+void PipelineCache::create()
+{
+    std::vector<char> data = loadFile();
+    if (!data.empty() && !isCompatible(data)) {
+        std::cout << "pipeline cache " << m_path << " was built by another driver, ignored" << std::endl;
+        data.clear();
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline cache!");
+    }
+}
+
+void PipelineCache::save() const
+{
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+        return;
+    }
+
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+        return;
+    }
+
+    std::ofstream file(m_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cout << "failed to write pipeline cache " << m_path << std::endl;
+        return;
+    }
+    file.write(data.data(), dataSize);
+}
+
+void PipelineCache::cleanUp()
+{
+    vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr);
+    m_pipelineCache = VK_NULL_HANDLE;
+}
+
+VkPipelineCache PipelineCache::handle() const
+{
+    return m_pipelineCache;
+}
+
+/* --------------------------------- Private methods --------------------------------- */
+
+std::vector<char> PipelineCache::loadFile() const
+{
+    std::ifstream file(m_path, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        return {};
+    }
+
+    size_t fileSize = (size_t)file.tellg();
+    std::vector<char> buffer(fileSize);
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+    return buffer;
+}
+
+/*
+    Header written by the driver (VkPipelineCacheHeaderVersionOne):
+        - uint32_t headerSize, uint32_t headerVersion, uint32_t vendorID, uint32_t deviceID
+        - uint8_t pipelineCacheUUID[VK_UUID_SIZE]
+*/
+bool PipelineCache::isCompatible(const std::vector<char>& data) const
+{
+    const size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+    if (data.size() < headerSize) {
+        return false;
+    }
+
+    uint32_t header[4];
+    memcpy(header, data.data(), sizeof(header));
+    uint8_t cacheUUID[VK_UUID_SIZE];
+    memcpy(cacheUUID, data.data() + sizeof(header), VK_UUID_SIZE);
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+
+    return header[0] >= headerSize
+        && header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header[2] == properties.vendorID
+        && header[3] == properties.deviceID
+        && memcmp(cacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
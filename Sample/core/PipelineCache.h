@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+/*
+    VkPipelineCache persisted on disk between runs, the blob is only reused when its header
+    matches the current driver (vendor, device and pipeline cache UUID)
+*/
+class PipelineCache
+{
+public:
+    PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path);
+    ~PipelineCache();
+
+public:
+    void create();
+    void save() const;
+    void cleanUp();
+
+    VkPipelineCache handle() const;
+
+private:
+    std::vector<char> loadFile() const;
+    bool isCompatible(const std::vector<char>& data) const;
+
+private:
+    VkDevice m_device;
+    VkPhysicalDevice m_physicalDevice;
+    std::string m_path;
+    VkPipelineCache m_pipelineCache;
+};
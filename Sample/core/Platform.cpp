@@ -1,7 +1,15 @@
 #include "Platform.h"
+#include "CpuProfiler.h"
 
 
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <set>
 #include <iterator>
 #include <iostream>
@@ -27,7 +35,9 @@ Platform::Platform():
     m_camera(nullptr),
     m_cameraController(nullptr),
     m_viewParams(nullptr),
-    m_dimension({ 1200, 600 })
+    m_surface(VK_NULL_HANDLE),
+    m_dimension({ 1200, 600 }),
+    m_headless(false)
 {
 
 }
@@ -59,16 +69,92 @@ void Platform::initialize()
     m_engine->initialize(m_window.get(), m_availableSwapChainInfos, *m_viewParams);
 }
 
+/*
+    No window and no surface: the engine renders into offscreen images, works on a
+    software implementation such as lavapipe
+*/
+void Platform::initializeHeadless(const BenchmarkSettings& settings)
+{
+    m_headless = true;
+    m_benchmarkSettings = settings;
+    m_dimension = settings.dimension;
+    createVulkanInstance();
+    setupDebugMessenger();
+
+    m_physicalDevice = pickPhysicalDevice();
+
+    m_camera = std::make_unique<Camera>(glm::vec2(m_dimension.width, m_dimension.height), glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f), 45.0f);
+    m_viewParams = std::make_unique<ViewParams>();
+
+    m_engine = std::make_unique<Engine>(m_instance, m_surface, m_physicalDevice);
+    // same frames in flight as a usual triple buffered swapchain
+    m_engine->initializeOffscreen(m_dimension, 3, *m_viewParams);
+}
+
 void Platform::mainLoop()
 {
+    CpuProfiler::setThreadName("Main");
     while (!glfwWindowShouldClose(m_window->handle())) {
-        glfwPollEvents();
+        CPU_ZONE("Frame");
+        {
+            CPU_ZONE("Poll events");
+            glfwPollEvents();
+        }
         m_engine->drawFrame(*m_camera, * m_viewParams);
     }
 
     vkDeviceWaitIdle(m_engine->renderContext()->device());
 }
 
+void Platform::runBenchmark()
+{
+    CpuProfiler::setThreadName("Main");
+    const BenchmarkSettings& settings = m_benchmarkSettings;
+    GpuProfiler* gpuProfiler = m_engine->gpuProfiler();
+    gpuProfiler->setRecordFrameTimes(true);
+    if (!settings.captureDirectory.empty()) {
+        std::filesystem::create_directories(settings.captureDirectory);
+    }
+
+    std::vector<float> cpuTimes(settings.frameCount, 0.0f);
+    std::vector<float> waitTimes(settings.frameCount, 0.0f);
+    for (uint32_t frame = 0; frame < settings.frameCount; frame++) {
+        // one orbit around the fog with a slow dolly
+        float progress = float(frame) / float(settings.frameCount);
+        float angle = progress * glm::two_pi<float>();
+        m_camera->setArcBallModel(glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+        m_camera->setEye(glm::vec3(0.0f, 0.0f, 3.0f + 0.75f * glm::sin(2.0f * angle)));
+
+        // the wait on the GPU is reported on its own, the cpu time only covers the work of the frame
+        auto start = std::chrono::steady_clock::now();
+        m_engine->waitOffscreenFrame();
+        auto waited = std::chrono::steady_clock::now();
+        uint32_t imageIndex = m_engine->drawOffscreenFrame(*m_camera, *m_viewParams);
+        cpuTimes[frame] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - waited).count();
+        waitTimes[frame] = std::chrono::duration<float, std::milli>(waited - start).count();
+
+        if (!settings.captureDirectory.empty() && settings.captureInterval > 0 && frame % settings.captureInterval == 0) {
+            char fileName[32];
+            snprintf(fileName, sizeof(fileName), "frame_%04u.ppm", frame);
+            m_engine->captureFrame(imageIndex, (std::filesystem::path(settings.captureDirectory) / fileName).string());
+        }
+    }
+
+    // the last frames in flight
+    vkDeviceWaitIdle(m_engine->renderContext()->device());
+    for (uint32_t i = 0; i < m_engine->renderContext()->swapChain().size(); i++) {
+        gpuProfiler->collect(i);
+    }
+
+    std::vector<float> gpuTimes(settings.frameCount, 0.0f);
+    for (auto& frameTime : gpuProfiler->frameTimes()) {
+        if (frameTime.frame < gpuTimes.size()) {
+            gpuTimes[frameTime.frame] = frameTime.milliseconds;
+        }
+    }
+    writeBenchmarkReport(cpuTimes, waitTimes, gpuTimes);
+}
+
 void Platform::resize(int width, int height)
 {
     int frameWidth, frameHeight;
@@ -118,13 +204,48 @@ void Platform::cleanUp()
     if (RenderContext::enableValidationLayers) {
         DestroyDebugUtilsMessengerEXT(m_instance, m_debugMessenger, nullptr);
     }
-    vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+    if (m_surface != VK_NULL_HANDLE) {
+        vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+    }
     vkDestroyInstance(m_instance, nullptr);
     m_window.reset();
 }
 
 /* --------------------------------- Private methods --------------------------------- */
 
+void Platform::writeBenchmarkReport(const std::vector<float>& cpuTimes, const std::vector<float>& waitTimes, const std::vector<float>& gpuTimes)
+{
+    std::ofstream file(m_benchmarkSettings.reportPath, std::ios::trunc);
+    if (file.is_open()) {
+        file << "frame,cpu_ms,wait_ms,gpu_ms" << std::endl;
+        for (size_t frame = 0; frame < cpuTimes.size(); frame++) {
+            file << frame << "," << cpuTimes[frame] << "," << waitTimes[frame] << "," << gpuTimes[frame] << std::endl;
+        }
+    }
+    else {
+        std::cout << "failed to write benchmark report " << m_benchmarkSettings.reportPath << std::endl;
+    }
+
+    auto printSummary = [](const char* name, std::vector<float> times) {
+        if (times.empty()) {
+            return;
+        }
+        std::sort(times.begin(), times.end());
+        float total = 0.0f;
+        for (float time : times) {
+            total += time;
+        }
+        std::cout << name << ": avg " << total / times.size() << " ms, min " << times.front() << " ms, p95 "
+            << times[(times.size() * 95) / 100] << " ms, max " << times.back() << " ms" << std::endl;
+    };
+    std::cout << "benchmark, " << cpuTimes.size() << " frames at " << m_dimension.width << "x" << m_dimension.height << std::endl;
+    printSummary("cpu", cpuTimes);
+    printSummary("wait", waitTimes);
+    if (m_engine->gpuProfiler()->isEnabled()) {
+        printSummary("gpu", gpuTimes);
+    }
+}
+
 void Platform::createVulkanInstance()
 {
     if (RenderContext::enableValidationLayers && !checkValidationLayerSupport()) {
@@ -140,7 +261,8 @@ void Platform::createVulkanInstance()
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // 1.2 for the core descriptor indexing used by the bindless descriptor table
+    appInfo.apiVersion = VK_API_VERSION_1_2;
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -256,10 +378,14 @@ bool Platform::checkExtensionSupport()
 
 std::vector<const char*> Platform::getRequiredExtensions()
 {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    // headless, glfw isn't even initialized
+    std::vector<const char*> extensions;
+    if (!m_headless) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions;
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (RenderContext::enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -281,9 +407,10 @@ bool Platform::isDeviceSuitable(VkPhysicalDevice device) {
         return false;
     }
 
-    bool extensionsSupported = checkDeviceExtensionSupport(device);
-    bool swapChainAdequate = false;
-    if (extensionsSupported) {
+    // nothing to present in headless
+    bool extensionsSupported = m_headless || checkDeviceExtensionSupport(device);
+    bool swapChainAdequate = m_headless;
+    if (extensionsSupported && !m_headless) {
         SwapChainSupportInfos swapChainSupport = querySwapChainSupport(device);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
@@ -291,7 +418,28 @@ bool Platform::isDeviceSuitable(VkPhysicalDevice device) {
     VkPhysicalDeviceFeatures supportedFeatures;
     vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-    return extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+
+    // Bindless descriptors
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceVulkan11Features vulkan11Features{};
+    vulkan11Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+    vulkan11Features.pNext = &vulkan12Features;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &vulkan11Features;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+    bool bindlessSupported = vulkan12Features.runtimeDescriptorArray && vulkan12Features.descriptorBindingPartiallyBound
+        && vulkan12Features.descriptorBindingSampledImageUpdateAfterBind && vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind
+        && vulkan12Features.descriptorBindingStorageImageUpdateAfterBind;
+    // one indirect count draw per pipeline, the draws find their object through their first instance
+    bool indirectCountSupported = vulkan12Features.drawIndirectCount && vulkan11Features.shaderDrawParameters
+        && supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+
+    return extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy && bindlessSupported && indirectCountSupported;
 }
 
 bool Platform::checkDeviceExtensionSupport(VkPhysicalDevice device) {
@@ -9,6 +9,7 @@
 #include <memory>
 #include <vector>
 #include <optional>
+#include <string>
 
 class QueueFamilyIndices {
 public:
@@ -21,6 +22,16 @@ public:
     }
 };
 
+// Headless run, scripted camera orbit over a fixed number of frames
+struct BenchmarkSettings {
+    uint32_t frameCount = 300;
+    VkExtent2D dimension = { 1280, 720 };
+    // frames written as PPM when not empty
+    std::string captureDirectory;
+    uint32_t captureInterval = 30;
+    std::string reportPath = "benchmark.csv";
+};
+
 class Platform
 {
 public:
@@ -29,7 +40,9 @@ public:
 
 public:
     void initialize();
+    void initializeHeadless(const BenchmarkSettings& settings);
     void mainLoop();
+    void runBenchmark();
     void cleanUp();
     void resize(int width, int height);
     void mouseMove(double xpos, double ypos);
@@ -41,6 +54,7 @@ private:
     void createVulkanInstance();
     void setupDebugMessenger();
     VkPhysicalDevice pickPhysicalDevice();
+    void writeBenchmarkReport(const std::vector<float>& cpuTimes, const std::vector<float>& waitTimes, const std::vector<float>& gpuTimes);
 
 private:
     bool checkValidationLayerSupport();
@@ -66,5 +80,7 @@ private:
     VkSurfaceKHR m_surface;
     VkExtent2D m_dimension;
     SwapChainSupportInfos m_availableSwapChainInfos;
+    bool m_headless;
+    BenchmarkSettings m_benchmarkSettings;
 };
 
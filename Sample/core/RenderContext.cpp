@@ -26,7 +26,9 @@ RenderContext::RenderContext(const VkInstance& vkInstance, const VkSurfaceKHR& s
     m_surface(surface),
     m_physicalDevice(device),
     m_swapChain(nullptr),
-    m_depthImageFormat(VK_FORMAT_UNDEFINED)
+    m_pipelineCache(nullptr),
+    m_depthImageFormat(VK_FORMAT_UNDEFINED),
+    m_pipelineStatisticsSupported(false)
 {
 
 }
@@ -40,20 +42,15 @@ RenderContext::~RenderContext()
 
 void RenderContext::cleanUpDevice()
 {
+    // Keep the compiled pipelines for the next run
+    m_pipelineCache->save();
+    m_pipelineCache->cleanUp();
     vkDestroyCommandPool(m_device, m_commandPool, nullptr);
     vkDestroyDevice(m_device, nullptr);
 }
 
 void RenderContext::cleanUpFrameBuffers()
 {
-    vkDestroyImageView(m_device, m_depthAttachment.imageView, nullptr);
-    vkDestroyImage(m_device, m_depthAttachment.image, nullptr);
-    vkFreeMemory(m_device, m_depthAttachment.imageMemory, nullptr);
-
-    vkDestroyImageView(m_device, m_colorAttachment.imageView, nullptr);
-    vkDestroyImage(m_device, m_colorAttachment.image, nullptr);
-    vkFreeMemory(m_device, m_colorAttachment.imageMemory, nullptr);
-
     for (size_t i = 0; i < m_frameBuffers.size(); i++) {
         vkDestroyFramebuffer(m_device, m_frameBuffers[i], nullptr);
     }
@@ -80,16 +77,47 @@ void RenderContext::createLogicalDevice()
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
-    VkPhysicalDeviceFeatures deviceFeatures{};
-    deviceFeatures.samplerAnisotropy = VK_TRUE;
-    deviceFeatures.sampleRateShading = VK_TRUE; // enable sample shading feature for the device
+    // Descriptor indexing for the bindless descriptor table
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.descriptorIndexing = VK_TRUE;
+    vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+    vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+    vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    vulkan12Features.descriptorBindingStorageImageUpdateAfterBind = VK_TRUE;
+    // the scene draws read their draw count from the gpu culling
+    vulkan12Features.drawIndirectCount = VK_TRUE;
+
+    // every draw of a bucket finds its object through gl_BaseInstance, its first instance
+    VkPhysicalDeviceVulkan11Features vulkan11Features{};
+    vulkan11Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+    vulkan11Features.pNext = &vulkan12Features;
+    vulkan11Features.shaderDrawParameters = VK_TRUE;
+
+    VkPhysicalDeviceFeatures2 deviceFeatures{};
+    deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    deviceFeatures.pNext = &vulkan11Features;
+    deviceFeatures.features.samplerAnisotropy = VK_TRUE;
+    deviceFeatures.features.multiDrawIndirect = VK_TRUE;
+    deviceFeatures.features.drawIndirectFirstInstance = VK_TRUE;
+    deviceFeatures.features.sampleRateShading = VK_TRUE; // enable sample shading feature for the device
+
+    // Optional, only used by the gpu profiler
+    VkPhysicalDeviceFeatures supportedFeatures{};
+    vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+    m_pipelineStatisticsSupported = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+    deviceFeatures.features.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &deviceFeatures;
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-    createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
-    createInfo.ppEnabledExtensionNames = requiredExtensions.data();
+    createInfo.pEnabledFeatures = nullptr;
+    // nothing to present without a surface
+    createInfo.enabledExtensionCount = isHeadless() ? 0 : static_cast<uint32_t>(requiredExtensions.size());
+    createInfo.ppEnabledExtensionNames = isHeadless() ? nullptr : requiredExtensions.data();
 
     if (enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -105,13 +133,27 @@ void RenderContext::createLogicalDevice()
 
     vkGetDeviceQueue(m_device, m_graphicQueueIndex, 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_device, m_presentQueueIndex, 0, &m_presentQueue);
+
+    m_pipelineCache = std::make_unique<PipelineCache>(m_device, m_physicalDevice, "pipeline_cache.bin");
+    m_pipelineCache->create();
 }
 
 void RenderContext::createSwapChain(const VkExtent2D& dimension, const SwapChainSupportInfos& availableDetails)
 {
     m_swapChain = std::make_unique<SwapChain>(m_device, m_surface, dimension, availableDetails);
     m_swapChain->create();
+    createRenderFrames();
+}
+
+void RenderContext::createOffscreenSwapChain(const VkExtent2D& dimension, uint32_t imageCount)
+{
+    m_swapChain = std::make_unique<SwapChain>(m_device, m_surface, m_physicalDevice, dimension, imageCount);
+    m_swapChain->create();
+    createRenderFrames();
+}
 
+void RenderContext::createRenderFrames()
+{
     auto& swapChainImages = m_swapChain->images();
     auto imageFormat = m_swapChain->currentImageFormat();
     m_frames.clear();
@@ -121,28 +163,18 @@ void RenderContext::createSwapChain(const VkExtent2D& dimension, const SwapChain
     }
 }
 
-void RenderContext::createFrameBuffers(const VkRenderPass& renderPass)
+/*
+    The multisampled color and depth attachments are transient resources of the render graph,
+    only the resolve target changes between the framebuffers
+*/
+void RenderContext::createFrameBuffers(const VkRenderPass& renderPass, VkImageView colorAttachment, VkImageView depthAttachment)
 {
-    // Color Attachment
-    vk_initializer::createImage(m_device, m_physicalDevice, this->width(), this->height(), 1, m_MSAASamples, 
-        m_swapChain->currentImageFormat(), VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_colorAttachment.image, m_colorAttachment.imageMemory);
-
-    m_colorAttachment.imageView = vk_initializer::createImageView(m_device, m_colorAttachment.image, m_swapChain->currentImageFormat(), VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
-    // Depth Attachment
-    vk_initializer::createImage(m_device, m_physicalDevice, this->width(), this->height(), 1, m_MSAASamples, 
-        m_depthImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
-        m_depthAttachment.image, m_depthAttachment.imageMemory);
-
-    m_depthAttachment.imageView = vk_initializer::createImageView(m_device, m_depthAttachment.image, m_depthImageFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
-
     // FrameBuffers
     m_frameBuffers.resize(m_frames.size());
     for (size_t i = 0; i < m_frames.size(); i++) {
         std::array<VkImageView, 3> attachments = {
-            m_colorAttachment.imageView,
-            m_depthAttachment.imageView,
+            colorAttachment,
+            depthAttachment,
             m_frames[i]->getImageView(),
         };
 
@@ -260,8 +292,11 @@ void RenderContext::pickGraphicQueue()
     for (auto index = 0; index < queueFamilies.size(); index++) {
         VkQueueFamilyProperties& queueFamily = queueFamilies[index];
         if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(m_physicalDevice, index, m_surface, &presentSupport);
+            // headless, any graphic queue will do
+            VkBool32 presentSupport = isHeadless();
+            if (!isHeadless()) {
+                vkGetPhysicalDeviceSurfaceSupportKHR(m_physicalDevice, index, m_surface, &presentSupport);
+            }
             // GraphicFamily and Window presenting should be the same
             if (presentSupport) {
                 m_graphicQueueIndex = index;
@@ -374,6 +409,11 @@ const VkCommandPool& RenderContext::commandPool() const
     return m_commandPool;
 }
 
+VkPipelineCache RenderContext::pipelineCache() const
+{
+    return m_pipelineCache->handle();
+}
+
 const VkQueue& RenderContext::graphicsQueue() const
 {
     return m_graphicsQueue;
@@ -389,6 +429,21 @@ uint32_t RenderContext::graphicQueueIndex() const
     return m_graphicQueueIndex;
 }
 
+bool RenderContext::pipelineStatisticsSupported() const
+{
+    return m_pipelineStatisticsSupported;
+}
+
+bool RenderContext::isHeadless() const
+{
+    return m_surface == VK_NULL_HANDLE;
+}
+
+VkImageLayout RenderContext::backBufferLayout() const
+{
+    return isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
+
 uint32_t RenderContext::presentQueueIndex() const
 {
     return m_presentQueueIndex;
@@ -2,17 +2,12 @@
 
 #include "SwapChain.h"
 #include "RenderFrame.h"
+#include "PipelineCache.h"
 
 #include <vulkan/vulkan.h>
 #include <vector>
 #include <memory>
 
-struct FrameBufferAttachment {
-    VkImage image;
-    VkDeviceMemory imageMemory;
-    VkImageView imageView;
-};
-
 class RenderContext
 {
 public:
@@ -22,7 +17,8 @@ public:
 public:
     void createLogicalDevice();
     void createSwapChain(const VkExtent2D& dimension, const SwapChainSupportInfos& availableDetails);
-    void createFrameBuffers(const VkRenderPass& renderPass);
+    void createOffscreenSwapChain(const VkExtent2D& dimension, uint32_t imageCount);
+    void createFrameBuffers(const VkRenderPass& renderPass, VkImageView colorAttachment, VkImageView depthAttachment);
     void createCommandPool();
     void pickGraphicQueue();
     void pickDepthImageFormat();
@@ -48,10 +44,16 @@ public:
     const VkPhysicalDevice& physicalDevice() const;
     const VkDevice& device() const;
     const VkCommandPool& commandPool() const;
+    VkPipelineCache pipelineCache() const;
     const VkQueue& graphicsQueue() const;
     const VkQueue& presentQueue() const;
     uint32_t graphicQueueIndex() const;
     uint32_t presentQueueIndex() const;
+    bool pipelineStatisticsSupported() const;
+    // No surface, the frames are rendered into offscreen images
+    bool isHeadless() const;
+    // Layout of the back buffer once the frame is done, presented or read back
+    VkImageLayout backBufferLayout() const;
 
     const VkExtent2D& dimension() const;
     int width() const;
@@ -62,24 +64,26 @@ public:
     static const std::vector<const char*> requiredExtensions;
     static const std::vector<const char*> validationLayers;
 
+private:
+    void createRenderFrames();
+
 private:
     const VkInstance& m_vkInstance;
     const VkSurfaceKHR& m_surface;
     const VkPhysicalDevice& m_physicalDevice;
     VkDevice m_device;
     VkCommandPool m_commandPool;
+    std::unique_ptr<PipelineCache> m_pipelineCache;
     std::unique_ptr<SwapChain> m_swapChain;
     std::vector<std::unique_ptr<RenderFrame>> m_frames;
     std::vector<VkFramebuffer> m_frameBuffers;
 
-    FrameBufferAttachment m_colorAttachment;
-    FrameBufferAttachment m_depthAttachment;
-
     VkQueue m_graphicsQueue;
     VkQueue m_presentQueue;
     uint32_t m_graphicQueueIndex;
     uint32_t m_presentQueueIndex;
     VkFormat m_depthImageFormat;
     VkSampleCountFlagBits m_MSAASamples;
+    bool m_pipelineStatisticsSupported;
 };
 
@@ -0,0 +1,761 @@
+#include "RenderGraph.h"
+#include "VkInitializer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+    constexpr VkAccessFlags writeAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+    struct ResourceState {
+        VkImageLayout layout;
+        // last write, and the reads issued since then
+        VkPipelineStageFlags writeStages;
+        VkAccessFlags writeAccess;
+        VkPipelineStageFlags readStages;
+        // stages/accesses the last write has already been made visible to
+        VkPipelineStageFlags visibleStages;
+        VkAccessFlags visibleAccess;
+    };
+}
+
+/* --------------------------------- Access presets --------------------------------- */
+
+namespace render_graph {
+
+    ResourceAccess colorAttachmentWrite()
+    {
+        // blending reads the attachment as well
+        return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    }
+
+    ResourceAccess depthAttachmentWrite()
+    {
+        return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+    }
+
+    ResourceAccess vertexShaderRead()
+    {
+        return { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    }
+
+    ResourceAccess fragmentShaderRead()
+    {
+        return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    }
+
+    ResourceAccess computeShaderRead()
+    {
+        return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    }
+
+    ResourceAccess computeShaderWrite()
+    {
+        return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+    }
+
+    ResourceAccess computeStorageRead()
+    {
+        return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+    }
+
+    ResourceAccess computeStorageReadWrite()
+    {
+        return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+    }
+
+    ResourceAccess transferRead()
+    {
+        return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+    }
+
+    ResourceAccess transferWrite()
+    {
+        return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+    }
+
+    ResourceAccess indirectCommandRead()
+    {
+        return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+    }
+
+    ResourceAccess indexRead()
+    {
+        return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED };
+    }
+
+    ResourceAccess presentation()
+    {
+        return { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+    }
+
+    ResourceAccess accessForLayout(VkImageLayout layout)
+    {
+        switch (layout)
+        {
+        case VK_IMAGE_LAYOUT_UNDEFINED:
+            return { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, layout };
+        case VK_IMAGE_LAYOUT_PREINITIALIZED:
+            return { VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_WRITE_BIT, layout };
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+            return transferRead();
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+            return transferWrite();
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+            return colorAttachmentWrite();
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+            return depthAttachmentWrite();
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+            // textures are sampled by the vertex and fragment stages of the materials
+            return { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, layout };
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+            return presentation();
+        default:
+            // Other layouts aren't handled (yet), stay conservative
+            return { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT, layout };
+        }
+    }
+}
+
+/* --------------------------------- RenderGraphPass --------------------------------- */
+
+RenderGraphPass::RenderGraphPass(const std::string& name):
+    m_name(name),
+    m_execute(nullptr),
+    m_hasSideEffects(false)
+{
+
+}
+
+void RenderGraphPass::read(RenderGraphHandle resource, const ResourceAccess& access)
+{
+    m_uses.push_back({ resource, access, access.layout, false, false });
+}
+
+void RenderGraphPass::write(RenderGraphHandle resource, const ResourceAccess& access, bool discard)
+{
+    m_uses.push_back({ resource, access, access.layout, true, discard });
+}
+
+void RenderGraphPass::writeAttachment(RenderGraphHandle resource, const ResourceAccess& access, VkImageLayout finalLayout, bool discard)
+{
+    m_uses.push_back({ resource, access, finalLayout, true, discard });
+}
+
+void RenderGraphPass::setExecute(const ExecuteCallback& callback)
+{
+    m_execute = callback;
+}
+
+void RenderGraphPass::setSideEffects(bool hasSideEffects)
+{
+    m_hasSideEffects = hasSideEffects;
+}
+
+const std::string& RenderGraphPass::name() const
+{
+    return m_name;
+}
+
+const std::vector<RenderGraphPass::ResourceUse>& RenderGraphPass::uses() const
+{
+    return m_uses;
+}
+
+bool RenderGraphPass::hasSideEffects() const
+{
+    return m_hasSideEffects;
+}
+
+void RenderGraphPass::execute(VkCommandBuffer commandBuffer, uint32_t frameIndex) const
+{
+    if (m_execute) {
+        m_execute(commandBuffer, frameIndex);
+    }
+}
+
+/* --------------------------------- Constructors --------------------------------- */
+
+RenderGraph::RenderGraph():
+    m_unaliasedMemorySize(0),
+    m_profiler(nullptr)
+{
+
+}
+
+RenderGraph::~RenderGraph()
+{
+
+}
+
+/* --------------------------------- Public methods --------------------------------- */
+
+RenderGraphHandle RenderGraph::createImage(const std::string& name, const ImageResourceDesc& desc)
+{
+    Resource resource{};
+    resource.name = name;
+    resource.isImage = true;
+    resource.isImported = false;
+    resource.isOutput = false;
+    resource.desc = desc;
+    resource.initialAccess = { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED };
+    resource.finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.image = VK_NULL_HANDLE;
+    resource.view = VK_NULL_HANDLE;
+    resource.buffer = VK_NULL_HANDLE;
+    resource.memoryBlock = -1;
+    m_resources.push_back(resource);
+    return static_cast<RenderGraphHandle>(m_resources.size() - 1);
+}
+
+RenderGraphHandle RenderGraph::importImage(const std::string& name, const ImageResourceDesc& desc, const ResourceAccess& initialAccess, VkImageLayout finalLayout)
+{
+    RenderGraphHandle handle = createImage(name, desc);
+    Resource& resource = m_resources[handle];
+    resource.isImported = true;
+    resource.initialAccess = initialAccess;
+    resource.finalLayout = finalLayout;
+    return handle;
+}
+
+RenderGraphHandle RenderGraph::importBuffer(const std::string& name, VkBuffer buffer, VkDeviceSize size, const ResourceAccess& initialAccess)
+{
+    Resource resource{};
+    resource.name = name;
+    resource.isImage = false;
+    resource.isImported = true;
+    resource.isOutput = false;
+    resource.initialAccess = initialAccess;
+    resource.finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.image = VK_NULL_HANDLE;
+    resource.view = VK_NULL_HANDLE;
+    resource.buffer = buffer;
+    resource.size = size;
+    resource.memoryBlock = -1;
+    m_resources.push_back(resource);
+    return static_cast<RenderGraphHandle>(m_resources.size() - 1);
+}
+
+void RenderGraph::bindImportedImage(RenderGraphHandle resource, VkImage image, VkImageView view)
+{
+    m_resources.at(resource).image = image;
+    m_resources.at(resource).view = view;
+}
+
+void RenderGraph::bindImportedBuffer(RenderGraphHandle resource, VkBuffer buffer)
+{
+    m_resources.at(resource).buffer = buffer;
+}
+
+void RenderGraph::markOutput(RenderGraphHandle resource)
+{
+    m_resources.at(resource).isOutput = true;
+}
+
+RenderGraphPass& RenderGraph::addPass(const std::string& name)
+{
+    m_passes.push_back(std::make_unique<RenderGraphPass>(name));
+    return *m_passes.back();
+}
+
+void RenderGraph::setProfiler(GpuProfiler* profiler)
+{
+    m_profiler = profiler;
+}
+
+/*
+    Resolve the graph once, the result is replayed every frame by execute():
+        - passes whose outputs are never consumed are culled
+        - transient images with disjoint lifetimes share the same device memory
+        - every pass gets the smallest barrier batch satisfying its declared accesses
+*/
+void RenderGraph::compile(RenderContext& renderContext)
+{
+    cullPasses();
+    computeLifetimes();
+    allocateTransientImages(renderContext);
+    computeBarriers();
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, uint32_t frameIndex) const
+{
+    for (size_t i = 0; i < m_activePasses.size(); i++) {
+        recordBarriers(commandBuffer, m_passBarriers[i]);
+        const RenderGraphPass& pass = *m_passes[m_activePasses[i]];
+        GpuScope scope(m_profiler, commandBuffer, pass.name());
+        pass.execute(commandBuffer, frameIndex);
+    }
+    recordBarriers(commandBuffer, m_finalBarriers);
+}
+
+void RenderGraph::cleanUp(RenderContext& renderContext)
+{
+    for (auto& resource : m_resources) {
+        if (resource.isImage && !resource.isImported && resource.image != VK_NULL_HANDLE) {
+            vkDestroyImageView(renderContext.device(), resource.view, nullptr);
+            vkDestroyImage(renderContext.device(), resource.image, nullptr);
+            resource.view = VK_NULL_HANDLE;
+            resource.image = VK_NULL_HANDLE;
+        }
+    }
+    for (auto& block : m_memoryBlocks) {
+        vkFreeMemory(renderContext.device(), block.memory, nullptr);
+    }
+    m_memoryBlocks.clear();
+    m_unaliasedMemorySize = 0;
+}
+
+VkImage RenderGraph::image(RenderGraphHandle resource) const
+{
+    return m_resources.at(resource).image;
+}
+
+VkImageView RenderGraph::imageView(RenderGraphHandle resource) const
+{
+    return m_resources.at(resource).view;
+}
+
+VkBuffer RenderGraph::buffer(RenderGraphHandle resource) const
+{
+    return m_resources.at(resource).buffer;
+}
+
+bool RenderGraph::isPassActive(const std::string& name) const
+{
+    for (size_t passIndex : m_activePasses) {
+        if (m_passes[passIndex]->name() == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+VkDeviceSize RenderGraph::transientMemorySize() const
+{
+    VkDeviceSize result = 0;
+    for (const auto& block : m_memoryBlocks) {
+        result += block.size;
+    }
+    return result;
+}
+
+VkDeviceSize RenderGraph::unaliasedMemorySize() const
+{
+    return m_unaliasedMemorySize;
+}
+
+/* --------------------------------- Private methods --------------------------------- */
+
+/*
+    Reference counting from the outputs (Frostbite frame graph):
+        - a pass is referenced by each resource it writes
+        - a resource is referenced by each pass reading it, outputs hold an extra reference
+    Resources nobody references release their writers, culled writers release what they read.
+*/
+void RenderGraph::cullPasses()
+{
+    std::vector<int> passRefCount(m_passes.size(), 0);
+    std::vector<int> resourceRefCount(m_resources.size(), 0);
+    std::vector<bool> culled(m_passes.size(), false);
+
+    for (size_t passIndex = 0; passIndex < m_passes.size(); passIndex++) {
+        for (const auto& use : m_passes[passIndex]->uses()) {
+            if (use.isWrite) {
+                passRefCount[passIndex]++;
+            } else {
+                resourceRefCount[use.resource]++;
+            }
+        }
+    }
+
+    std::vector<RenderGraphHandle> unreferenced;
+    for (size_t resourceIndex = 0; resourceIndex < m_resources.size(); resourceIndex++) {
+        if (m_resources[resourceIndex].isOutput) {
+            resourceRefCount[resourceIndex]++;
+        }
+        if (resourceRefCount[resourceIndex] == 0) {
+            unreferenced.push_back(static_cast<RenderGraphHandle>(resourceIndex));
+        }
+    }
+
+    auto cullPass = [&](size_t passIndex) {
+        culled[passIndex] = true;
+        for (const auto& use : m_passes[passIndex]->uses()) {
+            if (!use.isWrite && --resourceRefCount[use.resource] == 0) {
+                unreferenced.push_back(use.resource);
+            }
+        }
+    };
+
+    // passes writing nothing can only be kept alive by their side effects
+    for (size_t passIndex = 0; passIndex < m_passes.size(); passIndex++) {
+        if (passRefCount[passIndex] == 0 && !m_passes[passIndex]->hasSideEffects()) {
+            cullPass(passIndex);
+        }
+    }
+
+    while (!unreferenced.empty()) {
+        RenderGraphHandle resource = unreferenced.back();
+        unreferenced.pop_back();
+
+        for (size_t passIndex = 0; passIndex < m_passes.size(); passIndex++) {
+            if (culled[passIndex] || m_passes[passIndex]->hasSideEffects()) {
+                continue;
+            }
+            for (const auto& use : m_passes[passIndex]->uses()) {
+                if (use.isWrite && use.resource == resource && --passRefCount[passIndex] == 0) {
+                    cullPass(passIndex);
+                    break;
+                }
+            }
+        }
+    }
+
+    m_activePasses.clear();
+    for (size_t passIndex = 0; passIndex < m_passes.size(); passIndex++) {
+        if (!culled[passIndex]) {
+            m_activePasses.push_back(passIndex);
+        }
+    }
+}
+
+void RenderGraph::computeLifetimes()
+{
+    for (auto& resource : m_resources) {
+        resource.firstPass = -1;
+        resource.lastPass = -1;
+    }
+
+    for (size_t i = 0; i < m_activePasses.size(); i++) {
+        for (const auto& use : m_passes[m_activePasses[i]]->uses()) {
+            Resource& resource = m_resources[use.resource];
+            if (resource.firstPass < 0) {
+                resource.firstPass = static_cast<int>(i);
+            }
+            resource.lastPass = static_cast<int>(i);
+        }
+    }
+}
+
+/*
+    Greedy first fit: biggest images first, an image joins the first memory block whose
+    occupants are never alive during the same passes.
+*/
+void RenderGraph::allocateTransientImages(RenderContext& renderContext)
+{
+    std::vector<RenderGraphHandle> transientImages;
+    std::vector<VkMemoryRequirements> requirements(m_resources.size());
+
+    for (size_t resourceIndex = 0; resourceIndex < m_resources.size(); resourceIndex++) {
+        Resource& resource = m_resources[resourceIndex];
+        if (!resource.isImage || resource.isImported || resource.firstPass < 0) {
+            continue;
+        }
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = resource.desc.imageType;
+        imageInfo.extent = resource.desc.extent;
+        imageInfo.mipLevels = resource.desc.mipLevels;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = resource.desc.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = resource.desc.usage;
+        imageInfo.samples = resource.desc.samples;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        // aliased memory doesn't keep the content of the previous occupant
+        imageInfo.flags = 0;
+
+        if (vkCreateImage(renderContext.device(), &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create render graph image " + resource.name + "!");
+        }
+
+        vkGetImageMemoryRequirements(renderContext.device(), resource.image, &requirements[resourceIndex]);
+        m_unaliasedMemorySize += requirements[resourceIndex].size;
+        transientImages.push_back(static_cast<RenderGraphHandle>(resourceIndex));
+    }
+
+    std::sort(transientImages.begin(), transientImages.end(), [&requirements](RenderGraphHandle a, RenderGraphHandle b) {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    for (RenderGraphHandle handle : transientImages) {
+        Resource& resource = m_resources[handle];
+        const VkMemoryRequirements& requirement = requirements[handle];
+
+        int blockIndex = -1;
+        for (size_t i = 0; i < m_memoryBlocks.size() && blockIndex < 0; i++) {
+            MemoryBlock& block = m_memoryBlocks[i];
+            if ((block.memoryTypeBits & requirement.memoryTypeBits) == 0) {
+                continue;
+            }
+            bool overlap = std::any_of(block.resources.begin(), block.resources.end(), [&](RenderGraphHandle other) {
+                const Resource& occupant = m_resources[other];
+                return resource.firstPass <= occupant.lastPass && occupant.firstPass <= resource.lastPass;
+            });
+            if (!overlap) {
+                blockIndex = static_cast<int>(i);
+            }
+        }
+
+        if (blockIndex < 0) {
+            MemoryBlock block{};
+            block.memory = VK_NULL_HANDLE;
+            block.size = 0;
+            block.memoryTypeBits = requirement.memoryTypeBits;
+            m_memoryBlocks.push_back(block);
+            blockIndex = static_cast<int>(m_memoryBlocks.size() - 1);
+        }
+
+        MemoryBlock& block = m_memoryBlocks[blockIndex];
+        block.size = std::max(block.size, requirement.size);
+        block.memoryTypeBits &= requirement.memoryTypeBits;
+        block.resources.push_back(handle);
+        resource.memoryBlock = blockIndex;
+    }
+
+    for (auto& block : m_memoryBlocks) {
+        std::sort(block.resources.begin(), block.resources.end(), [this](RenderGraphHandle a, RenderGraphHandle b) {
+            return m_resources[a].firstPass < m_resources[b].firstPass;
+        });
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = block.size;
+        allocInfo.memoryTypeIndex = vk_initializer::findMemoryType(renderContext.physicalDevice(), block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkAllocateMemory(renderContext.device(), &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate render graph memory!");
+        }
+
+        for (RenderGraphHandle handle : block.resources) {
+            Resource& resource = m_resources[handle];
+            vkBindImageMemory(renderContext.device(), resource.image, block.memory, 0);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = resource.image;
+            viewInfo.viewType = resource.desc.imageType == VK_IMAGE_TYPE_3D ? VK_IMAGE_VIEW_TYPE_3D : VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = resource.desc.format;
+            viewInfo.subresourceRange.aspectMask = resource.desc.aspect;
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = resource.desc.mipLevels;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(renderContext.device(), &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create render graph image view " + resource.name + "!");
+            }
+        }
+    }
+}
+
+void RenderGraph::computeBarriers()
+{
+    std::vector<ResourceState> states(m_resources.size());
+
+    for (size_t resourceIndex = 0; resourceIndex < m_resources.size(); resourceIndex++) {
+        const Resource& resource = m_resources[resourceIndex];
+        ResourceState& state = states[resourceIndex];
+        ResourceAccess initialAccess = resource.initialAccess;
+
+        // A transient image first waits for whoever used its memory before: the previous occupant
+        // of the block, or for the first occupant the last one of the previous frame
+        if (resource.memoryBlock >= 0) {
+            const auto& occupants = m_memoryBlocks[resource.memoryBlock].resources;
+            auto position = std::find(occupants.begin(), occupants.end(), static_cast<RenderGraphHandle>(resourceIndex));
+            RenderGraphHandle previous = position == occupants.begin() ? occupants.back() : *(position - 1);
+            initialAccess = lastAccess(previous);
+            initialAccess.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+
+        state.layout = initialAccess.layout;
+        state.writeStages = initialAccess.stageMask;
+        state.writeAccess = initialAccess.accessMask & writeAccessMask;
+        state.readStages = 0;
+        state.visibleStages = 0;
+        state.visibleAccess = 0;
+    }
+
+    m_passBarriers.assign(m_activePasses.size(), BarrierBatch());
+    for (size_t i = 0; i < m_activePasses.size(); i++) {
+        BarrierBatch& batch = m_passBarriers[i];
+
+        for (const auto& use : m_passes[m_activePasses[i]]->uses()) {
+            const Resource& resource = m_resources[use.resource];
+            ResourceState& state = states[use.resource];
+            const ResourceAccess& access = use.access;
+            VkPipelineStageFlags srcStages = 0;
+            VkAccessFlags srcAccess = 0;
+            bool needBarrier = false;
+            bool transition = resource.isImage && state.layout != access.layout;
+
+            if (transition) {
+                // Layout transition, it behaves as a write visible to the current stages
+                srcStages = state.writeStages | state.readStages;
+                srcAccess = state.writeAccess;
+                ImageBarrier barrier{ use.resource, use.discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout, access.layout, srcAccess, access.accessMask };
+                batch.imageBarriers.push_back(barrier);
+
+                state.writeStages = access.stageMask;
+                state.writeAccess = use.isWrite ? access.accessMask & writeAccessMask : 0;
+                state.readStages = 0;
+                state.visibleStages = access.stageMask;
+                state.visibleAccess = access.accessMask;
+                needBarrier = true;
+            }
+            else if (use.isWrite) {
+                // WAW needs a memory dependency, WAR only an execution one
+                if ((state.writeStages | state.readStages) != 0) {
+                    srcStages = state.writeStages | state.readStages;
+                    srcAccess = state.writeAccess;
+                    needBarrier = true;
+                }
+                state.writeStages = access.stageMask;
+                state.writeAccess = access.accessMask & writeAccessMask;
+                state.readStages = 0;
+                state.visibleStages = 0;
+                state.visibleAccess = 0;
+            }
+            else {
+                // RAW, skipped when a previous barrier already made the write visible to this reader
+                bool alreadyVisible = (access.stageMask & ~state.visibleStages) == 0 && (access.accessMask & ~state.visibleAccess) == 0;
+                if (state.writeStages != 0 && !alreadyVisible) {
+                    srcStages = state.writeStages;
+                    srcAccess = state.writeAccess;
+                    state.visibleStages |= access.stageMask;
+                    state.visibleAccess |= access.accessMask;
+                    needBarrier = true;
+                }
+                state.readStages |= access.stageMask;
+            }
+
+            if (needBarrier) {
+                batch.srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+                batch.dstStages |= access.stageMask;
+                if (resource.isImage && !transition) {
+                    batch.imageBarriers.push_back({ use.resource, state.layout, state.layout, srcAccess, access.accessMask });
+                }
+                else if (!resource.isImage) {
+                    batch.bufferBarriers.push_back({ use.resource, srcAccess, access.accessMask });
+                }
+            }
+
+            // render passes may leave their attachments in another layout
+            if (resource.isImage) {
+                state.layout = use.finalLayout;
+            }
+        }
+    }
+
+    // Hand the imported resources back in the state the next frame imports them with: the
+    // first barrier of that frame only waits for the initial access, so everything done since
+    // has to be chained to it here. Images left for outside of the graph follow their final layout
+    m_finalBarriers = BarrierBatch();
+    for (size_t resourceIndex = 0; resourceIndex < m_resources.size(); resourceIndex++) {
+        const Resource& resource = m_resources[resourceIndex];
+        const ResourceState& state = states[resourceIndex];
+        if (!resource.isImported || resource.firstPass < 0) {
+            continue;
+        }
+
+        VkImageLayout finalLayout = resource.isImage && resource.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED ? resource.finalLayout : state.layout;
+        ResourceAccess target = resource.initialAccess;
+        if (resource.isImage && target.layout != finalLayout) {
+            target = render_graph::accessForLayout(finalLayout);
+        }
+
+        bool transition = resource.isImage && state.layout != finalLayout;
+        // presentation has no access of its own, it waits on the semaphore of the submission
+        bool pendingWrite = state.writeAccess != 0 && target.accessMask != 0 &&
+            ((target.stageMask & ~state.visibleStages) != 0 || (target.accessMask & ~state.visibleAccess) != 0);
+        // the reads only need an execution dependency, unless the next frame starts at their stages
+        VkPipelineStageFlags pendingReads = state.readStages & ~target.stageMask;
+        if (!transition && !pendingWrite && pendingReads == 0) {
+            continue;
+        }
+
+        VkPipelineStageFlags srcStages = transition || pendingWrite ? state.writeStages | state.readStages : pendingReads;
+        VkAccessFlags srcAccess = transition || pendingWrite ? state.writeAccess : 0;
+        m_finalBarriers.srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        m_finalBarriers.dstStages |= target.stageMask;
+        if (resource.isImage) {
+            m_finalBarriers.imageBarriers.push_back({ static_cast<RenderGraphHandle>(resourceIndex), state.layout, finalLayout, srcAccess, target.accessMask });
+        }
+        else {
+            m_finalBarriers.bufferBarriers.push_back({ static_cast<RenderGraphHandle>(resourceIndex), srcAccess, target.accessMask });
+        }
+    }
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch) const
+{
+    if (batch.imageBarriers.empty() && batch.bufferBarriers.empty()) {
+        return;
+    }
+
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    imageBarriers.reserve(batch.imageBarriers.size());
+    for (const auto& barrier : batch.imageBarriers) {
+        const Resource& resource = m_resources[barrier.resource];
+        VkImageMemoryBarrier imageBarrier{};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.oldLayout = barrier.oldLayout;
+        imageBarrier.newLayout = barrier.newLayout;
+        imageBarrier.srcAccessMask = barrier.srcAccess;
+        imageBarrier.dstAccessMask = barrier.dstAccess;
+        imageBarrier.image = resource.image;
+        imageBarrier.subresourceRange.aspectMask = resource.desc.aspect;
+        imageBarrier.subresourceRange.baseMipLevel = 0;
+        imageBarrier.subresourceRange.levelCount = resource.desc.mipLevels;
+        imageBarrier.subresourceRange.baseArrayLayer = 0;
+        imageBarrier.subresourceRange.layerCount = 1;
+        imageBarriers.push_back(imageBarrier);
+    }
+
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    bufferBarriers.reserve(batch.bufferBarriers.size());
+    for (const auto& barrier : batch.bufferBarriers) {
+        const Resource& resource = m_resources[barrier.resource];
+        VkBufferMemoryBarrier bufferBarrier{};
+        bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.srcAccessMask = barrier.srcAccess;
+        bufferBarrier.dstAccessMask = barrier.dstAccess;
+        bufferBarrier.buffer = resource.buffer;
+        bufferBarrier.offset = 0;
+        bufferBarrier.size = VK_WHOLE_SIZE;
+        bufferBarriers.push_back(bufferBarrier);
+    }
+
+    vkCmdPipelineBarrier(commandBuffer,
+        batch.srcStages, batch.dstStages, 0,
+        0, nullptr,
+        static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+        static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+ResourceAccess RenderGraph::lastAccess(RenderGraphHandle resource) const
+{
+    const Resource& target = m_resources[resource];
+    ResourceAccess result = { 0, 0, VK_IMAGE_LAYOUT_UNDEFINED };
+    if (target.lastPass < 0) {
+        return result;
+    }
+
+    for (const auto& use : m_passes[m_activePasses[target.lastPass]]->uses()) {
+        if (use.resource == resource) {
+            result.stageMask |= use.access.stageMask;
+            result.accessMask |= use.access.accessMask & writeAccessMask;
+            result.layout = use.finalLayout;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "RenderContext.h"
+#include "GpuProfiler.h"
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include <memory>
+
+using RenderGraphHandle = uint32_t;
+
+/*
+    How a pass touches a resource: the pipeline stages doing the access, the access types
+    and, for images, the layout the image must be in during the pass.
+*/
+struct ResourceAccess {
+    VkPipelineStageFlags stageMask;
+    VkAccessFlags accessMask;
+    VkImageLayout layout;
+};
+
+struct ImageResourceDesc {
+    VkExtent3D extent;
+    VkFormat format;
+    VkSampleCountFlagBits samples;
+    VkImageUsageFlags usage;
+    VkImageAspectFlags aspect;
+    VkImageType imageType = VK_IMAGE_TYPE_2D;
+    uint32_t mipLevels = 1;
+};
+
+namespace render_graph {
+
+    ResourceAccess colorAttachmentWrite();
+    ResourceAccess depthAttachmentWrite();
+    ResourceAccess vertexShaderRead();
+    ResourceAccess fragmentShaderRead();
+    ResourceAccess computeShaderRead();
+    ResourceAccess computeShaderWrite();
+    ResourceAccess computeStorageRead();
+    // atomics and in place updates of a storage buffer
+    ResourceAccess computeStorageReadWrite();
+    ResourceAccess transferRead();
+    ResourceAccess transferWrite();
+    ResourceAccess indirectCommandRead();
+    ResourceAccess indexRead();
+    ResourceAccess presentation();
+
+    // Smallest stage/access scope matching a layout, used by the one shot upload barriers
+    ResourceAccess accessForLayout(VkImageLayout layout);
+}
+
+class RenderGraphPass
+{
+public:
+    using ExecuteCallback = std::function<void(VkCommandBuffer commandBuffer, uint32_t frameIndex)>;
+
+    struct ResourceUse {
+        RenderGraphHandle resource;
+        ResourceAccess access;
+        // layout the image is left in once the pass ended (render pass final layout)
+        VkImageLayout finalLayout;
+        bool isWrite;
+        // previous content isn't needed (load op clear or don't care)
+        bool discard;
+    };
+
+public:
+    RenderGraphPass(const std::string& name);
+
+public:
+    void read(RenderGraphHandle resource, const ResourceAccess& access);
+    void write(RenderGraphHandle resource, const ResourceAccess& access, bool discard = false);
+    void writeAttachment(RenderGraphHandle resource, const ResourceAccess& access, VkImageLayout finalLayout, bool discard);
+    void setExecute(const ExecuteCallback& callback);
+    // never culled even if nothing reads what it writes
+    void setSideEffects(bool hasSideEffects);
+
+    const std::string& name() const;
+    const std::vector<ResourceUse>& uses() const;
+    bool hasSideEffects() const;
+    void execute(VkCommandBuffer commandBuffer, uint32_t frameIndex) const;
+
+private:
+    std::string m_name;
+    std::vector<ResourceUse> m_uses;
+    ExecuteCallback m_execute;
+    bool m_hasSideEffects;
+};
+
+class RenderGraph
+{
+public:
+    RenderGraph();
+    ~RenderGraph();
+
+public:
+    RenderGraphHandle createImage(const std::string& name, const ImageResourceDesc& desc);
+    RenderGraphHandle importImage(const std::string& name, const ImageResourceDesc& desc, const ResourceAccess& initialAccess, VkImageLayout finalLayout);
+    RenderGraphHandle importBuffer(const std::string& name, VkBuffer buffer, VkDeviceSize size, const ResourceAccess& initialAccess);
+    void bindImportedImage(RenderGraphHandle resource, VkImage image, VkImageView view);
+    void bindImportedBuffer(RenderGraphHandle resource, VkBuffer buffer);
+    void markOutput(RenderGraphHandle resource);
+    RenderGraphPass& addPass(const std::string& name);
+    // Every executed pass gets a timing scope named after it, nullptr disables it
+    void setProfiler(GpuProfiler* profiler);
+
+    void compile(RenderContext& renderContext);
+    void execute(VkCommandBuffer commandBuffer, uint32_t frameIndex) const;
+    void cleanUp(RenderContext& renderContext);
+
+    VkImage image(RenderGraphHandle resource) const;
+    VkImageView imageView(RenderGraphHandle resource) const;
+    VkBuffer buffer(RenderGraphHandle resource) const;
+    bool isPassActive(const std::string& name) const;
+    VkDeviceSize transientMemorySize() const;
+    VkDeviceSize unaliasedMemorySize() const;
+
+private:
+    struct Resource {
+        std::string name;
+        bool isImage;
+        bool isImported;
+        bool isOutput;
+        ImageResourceDesc desc;
+        ResourceAccess initialAccess;
+        VkImageLayout finalLayout;
+        VkImage image;
+        VkImageView view;
+        VkBuffer buffer;
+        VkDeviceSize size;
+        // Lifetime in active pass order, only meaningful for transient resources
+        int firstPass;
+        int lastPass;
+        int memoryBlock;
+    };
+
+    struct ImageBarrier {
+        RenderGraphHandle resource;
+        VkImageLayout oldLayout;
+        VkImageLayout newLayout;
+        VkAccessFlags srcAccess;
+        VkAccessFlags dstAccess;
+    };
+
+    struct BufferBarrier {
+        RenderGraphHandle resource;
+        VkAccessFlags srcAccess;
+        VkAccessFlags dstAccess;
+    };
+
+    struct BarrierBatch {
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        std::vector<ImageBarrier> imageBarriers;
+        std::vector<BufferBarrier> bufferBarriers;
+    };
+
+    struct MemoryBlock {
+        VkDeviceMemory memory;
+        VkDeviceSize size;
+        uint32_t memoryTypeBits;
+        // transient images sharing the block, sorted by first use
+        std::vector<RenderGraphHandle> resources;
+    };
+
+private:
+    void cullPasses();
+    void computeLifetimes();
+    void allocateTransientImages(RenderContext& renderContext);
+    void computeBarriers();
+    void recordBarriers(VkCommandBuffer commandBuffer, const BarrierBatch& batch) const;
+    ResourceAccess lastAccess(RenderGraphHandle resource) const;
+
+private:
+    std::vector<Resource> m_resources;
+    std::vector<std::unique_ptr<RenderGraphPass>> m_passes;
+    // Indices into m_passes of the passes that survived culling, in submission order
+    std::vector<size_t> m_activePasses;
+    std::vector<BarrierBatch> m_passBarriers;
+    BarrierBatch m_finalBarriers;
+    std::vector<MemoryBlock> m_memoryBlocks;
+    VkDeviceSize m_unaliasedMemorySize;
+    GpuProfiler* m_profiler;
+};
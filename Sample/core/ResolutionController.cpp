@@ -0,0 +1,119 @@
+#include "ResolutionController.h"
+
+#include <algorithm>
+#include <cmath>
+
+// weight of a new measurement in the moving average
+static const float smoothing = 0.1f;
+// no change while the average is between these fractions of the target
+static const float upperBand = 1.05f;
+static const float lowerBand = 0.85f;
+// largest change of the scale in one adjustment
+static const float maxScaleDecrease = 0.1f;
+static const float maxScaleIncrease = 0.05f;
+// frames the average needs to see the last change, the readback is a few frames late
+static const uint32_t cooldownFrames = 12;
+
+/* --------------------------------- Constructors --------------------------------- */
+
+ResolutionController::ResolutionController():
+    m_targetFrameTime(16.6f),
+    m_averageFrameTime(0.0f),
+    m_renderScale(1.0f),
+    m_stepScale(1.0f),
+    m_lastFrame(0),
+    m_cooldown(0),
+    m_adjustSteps(false),
+    m_hasSample(false)
+{
+
+}
+
+/* --------------------------------- Public methods --------------------------------- */
+
+void ResolutionController::setTargetFrameTime(float milliseconds)
+{
+    m_targetFrameTime = std::max(milliseconds, 1.0f);
+}
+
+void ResolutionController::setAdjustSteps(bool adjustSteps)
+{
+    m_adjustSteps = adjustSteps;
+    if (!m_adjustSteps) {
+        m_stepScale = 1.0f;
+    }
+}
+
+/*
+    The raymarch is fill rate bound, its cost follows the pixel count so the scale moves
+    with the square root of the ratio to the target. Steps are only traded once the
+    resolution can't go lower, and given back before the resolution goes up again
+*/
+bool ResolutionController::update(const GpuProfiler::FrameTime& frameTime)
+{
+    if (frameTime.milliseconds <= 0.0f || (m_hasSample && frameTime.frame == m_lastFrame)) {
+        return false;
+    }
+    m_averageFrameTime = m_hasSample ? m_averageFrameTime + (frameTime.milliseconds - m_averageFrameTime) * smoothing : frameTime.milliseconds;
+    m_lastFrame = frameTime.frame;
+    m_hasSample = true;
+
+    if (m_cooldown > 0) {
+        m_cooldown--;
+        return false;
+    }
+
+    float ratio = m_averageFrameTime / m_targetFrameTime;
+    float renderScale = m_renderScale;
+    float stepScale = m_stepScale;
+    if (ratio > upperBand) {
+        if (m_renderScale > minRenderScale) {
+            float scale = m_renderScale / std::sqrt(ratio);
+            renderScale = std::max(std::max(scale, m_renderScale - maxScaleDecrease), minRenderScale);
+        }
+        else if (m_adjustSteps) {
+            stepScale = std::max(m_stepScale / ratio, minStepScale);
+        }
+    }
+    else if (ratio < lowerBand) {
+        if (m_stepScale < 1.0f) {
+            stepScale = std::min(m_stepScale / ratio, 1.0f);
+        }
+        else {
+            float scale = m_renderScale / std::sqrt(ratio);
+            renderScale = std::min(std::min(scale, m_renderScale + maxScaleIncrease), 1.0f);
+        }
+    }
+
+    if (renderScale == m_renderScale && stepScale == m_stepScale) {
+        return false;
+    }
+    m_renderScale = renderScale;
+    m_stepScale = stepScale;
+    m_cooldown = cooldownFrames;
+    return true;
+}
+
+void ResolutionController::reset()
+{
+    m_renderScale = 1.0f;
+    m_stepScale = 1.0f;
+    m_averageFrameTime = 0.0f;
+    m_cooldown = 0;
+    m_hasSample = false;
+}
+
+float ResolutionController::renderScale() const
+{
+    return m_renderScale;
+}
+
+float ResolutionController::stepScale() const
+{
+    return m_stepScale;
+}
+
+float ResolutionController::averageFrameTime() const
+{
+    return m_averageFrameTime;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "GpuProfiler.h"
+
+#include <cstdint>
+
+/*
+    Holds the GPU frame time around a target by scaling the resolution of the fog raymarch.
+    The frame time is smoothed and nothing changes inside a dead band around the target,
+    after a change the controller waits for the new scale to reach the measurements.
+*/
+class ResolutionController
+{
+public:
+    static constexpr float minRenderScale = 0.5f;
+    static constexpr float minStepScale = 0.5f;
+
+public:
+    ResolutionController();
+
+public:
+    void setTargetFrameTime(float milliseconds);
+    // Lower the step count once the resolution is at its minimum
+    void setAdjustSteps(bool adjustSteps);
+    // Returns true when the scales changed
+    bool update(const GpuProfiler::FrameTime& frameTime);
+    void reset();
+
+    float renderScale() const;
+    float stepScale() const;
+    float averageFrameTime() const;
+
+private:
+    float m_targetFrameTime;
+    float m_averageFrameTime;
+    float m_renderScale;
+    float m_stepScale;
+    uint64_t m_lastFrame;
+    uint32_t m_cooldown;
+    bool m_adjustSteps;
+    bool m_hasSample;
+};
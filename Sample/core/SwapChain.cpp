@@ -1,4 +1,5 @@
 #include "SwapChain.h"
+#include "VkInitializer.h"
 
 #include <cstdint>
 #include <algorithm>
@@ -13,7 +14,9 @@ const VkColorSpaceKHR SwapChain::colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
 SwapChain::SwapChain(const VkDevice& device, const VkSurfaceKHR& surface, const VkExtent2D& dimension, const SwapChainSupportInfos& availableDetails):
     m_device(device),
     m_surface(surface),
-    m_dimension(dimension)
+    m_physicalDevice(VK_NULL_HANDLE),
+    m_dimension(dimension),
+    m_swapChain(VK_NULL_HANDLE)
 {
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(availableDetails.formats);
     VkPresentModeKHR presentMode = chooseSwapPresentMode(availableDetails.presentModes);
@@ -37,15 +40,45 @@ SwapChain::SwapChain(const VkDevice& device, const VkSurfaceKHR& surface, const
     m_properties.presentMode = presentMode;
 }
 
+SwapChain::SwapChain(const VkDevice& device, const VkSurfaceKHR& surface, VkPhysicalDevice physicalDevice, const VkExtent2D& dimension, uint32_t imageCount):
+    m_device(device),
+    m_surface(surface),
+    m_physicalDevice(physicalDevice),
+    m_dimension(dimension),
+    m_swapChain(VK_NULL_HANDLE)
+{
+    m_properties.extent = m_dimension;
+    m_properties.imageCount = imageCount;
+    // same format as a window swapchain so the pipelines don't change
+    m_properties.surfaceFormat = { imageFormat, colorSpace };
+    m_properties.arrayLayers = 1;
+    // transfer source to read the frames back
+    m_properties.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    m_properties.preTransform = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR;
+    m_properties.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+    m_properties.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+}
+
 SwapChain::~SwapChain()
 {
-    vkDestroySwapchainKHR(m_device, m_swapChain, nullptr);
+    if (m_swapChain != VK_NULL_HANDLE) {
+        vkDestroySwapchainKHR(m_device, m_swapChain, nullptr);
+    }
+    for (size_t i = 0; i < m_offscreenMemories.size(); i++) {
+        vkDestroyImage(m_device, m_swapChainImages[i], nullptr);
+        vkFreeMemory(m_device, m_offscreenMemories[i], nullptr);
+    }
 }
 
 /* --------------------------------- Public Methods  --------------------------------- */
 
 void SwapChain::create()
 {
+    if (m_surface == VK_NULL_HANDLE) {
+        createOffscreenImages();
+        return;
+    }
+
     VkSwapchainCreateInfoKHR createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
     createInfo.surface          = m_surface;
@@ -111,6 +144,11 @@ VkFormat SwapChain::currentImageFormat() const
     return m_properties.surfaceFormat.format;
 }
 
+bool SwapChain::isOffscreen() const
+{
+    return m_swapChain == VK_NULL_HANDLE;
+}
+
 /* --------------------------------- Private Methods --------------------------------- */
 
 VkSurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
@@ -150,4 +188,15 @@ VkExtent2D SwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilit
 
         return actualExtent;
     }
-}
\ No newline at end of file
+}
+
+void SwapChain::createOffscreenImages()
+{
+    m_swapChainImages.resize(m_properties.imageCount);
+    m_offscreenMemories.resize(m_properties.imageCount);
+    for (uint32_t i = 0; i < m_properties.imageCount; i++) {
+        vk_initializer::createImage(m_device, m_physicalDevice, m_dimension.width, m_dimension.height, 1, VK_SAMPLE_COUNT_1_BIT,
+            m_properties.surfaceFormat.format, VK_IMAGE_TILING_OPTIMAL, m_properties.imageUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            m_swapChainImages[i], m_offscreenMemories[i]);
+    }
+}
@@ -26,6 +26,8 @@ class SwapChain
 {
 public:
     SwapChain(const VkDevice& device,  const VkSurfaceKHR& surface, const VkExtent2D& dimension, const SwapChainSupportInfos& availableDetails);
+    // Headless, the images are plain offscreen color targets that are never presented
+    SwapChain(const VkDevice& device, const VkSurfaceKHR& surface, VkPhysicalDevice physicalDevice, const VkExtent2D& dimension, uint32_t imageCount);
     ~SwapChain();
 
 public:
@@ -45,19 +47,24 @@ public:
     const VkSurfaceFormatKHR& vkSurfaceFormat() const;
     VkPresentModeKHR vkPresentMode() const;
     VkFormat currentImageFormat() const;
+    bool isOffscreen() const;
 
 private:
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
+    void createOffscreenImages();
 
 private:
     const VkDevice& m_device;
     const VkSurfaceKHR& m_surface;
+    VkPhysicalDevice m_physicalDevice;
     VkExtent2D m_dimension;
     SwapchainProperties m_properties;
     VkSwapchainKHR m_swapChain;
 
     std::vector<VkImage> m_swapChainImages;
+    // only allocated by an offscreen swapchain
+    std::vector<VkDeviceMemory> m_offscreenMemories;
 };
 
@@ -0,0 +1,97 @@
+#include "UniformArena.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+/* --------------------------------- Constructors --------------------------------- */
+
+UniformArena::UniformArena(RenderContext& renderContext):
+    m_renderContext(renderContext),
+    m_buffer(VK_NULL_HANDLE),
+    m_memory(VK_NULL_HANDLE),
+    m_mappedData(nullptr),
+    m_alignment(256),
+    m_frameCapacity(0),
+    m_frameCount(0),
+    m_frameBegin(0),
+    m_head(0)
+{
+
+}
+
+UniformArena::~UniformArena()
+{
+
+}
+
+/* --------------------------------- Public methods --------------------------------- */
+
+void UniformArena::create(uint32_t frameCount, VkDeviceSize frameCapacity)
+{
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_renderContext.physicalDevice(), &properties);
+    m_alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 16);
+
+    // each region starts on an aligned offset so the dynamic offsets stay valid
+    m_frameCapacity = (frameCapacity + m_alignment - 1) & ~(m_alignment - 1);
+    m_frameCount = frameCount;
+    m_frameBegin = 0;
+    m_head = 0;
+
+    // also the staging source of the device local data updated from the frame
+    VkMemoryPropertyFlags memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    m_renderContext.createBuffer(m_frameCapacity * m_frameCount, usage, memoryPropertyFlags, m_buffer, m_memory);
+
+    // Mapped once for the whole lifetime of the buffer
+    void* data;
+    if (vkMapMemory(m_renderContext.device(), m_memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+        throw std::runtime_error("failed to map uniform arena memory!");
+    }
+    m_mappedData = static_cast<unsigned char*>(data);
+}
+
+void UniformArena::cleanUp()
+{
+    if (m_buffer == VK_NULL_HANDLE) {
+        return;
+    }
+    vkUnmapMemory(m_renderContext.device(), m_memory);
+    vkDestroyBuffer(m_renderContext.device(), m_buffer, nullptr);
+    vkFreeMemory(m_renderContext.device(), m_memory, nullptr);
+    m_buffer = VK_NULL_HANDLE;
+    m_memory = VK_NULL_HANDLE;
+    m_mappedData = nullptr;
+}
+
+void UniformArena::beginFrame(uint32_t frameIndex)
+{
+    m_frameBegin = (frameIndex % m_frameCount) * m_frameCapacity;
+    m_head = m_frameBegin;
+}
+
+uint32_t UniformArena::allocate(VkDeviceSize size, void** data)
+{
+    VkDeviceSize offset = (m_head + m_alignment - 1) & ~(m_alignment - 1);
+    if (offset + size > m_frameBegin + m_frameCapacity) {
+        throw std::runtime_error("failed to allocate uniform arena memory!");
+    }
+    m_head = offset + size;
+    *data = m_mappedData + offset;
+    return static_cast<uint32_t>(offset);
+}
+
+VkBuffer UniformArena::buffer() const
+{
+    return m_buffer;
+}
+
+VkDeviceSize UniformArena::frameCapacity() const
+{
+    return m_frameCapacity;
+}
+
+VkDeviceSize UniformArena::frameUsage() const
+{
+    return m_head - m_frameBegin;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "RenderContext.h"
+
+#include <vulkan/vulkan.h>
+#include <cstring>
+
+/*
+    One persistently mapped uniform buffer split in a linear region per swapchain image.
+    Objects push their shader data every frame and bind it through a dynamic offset,
+    the region is only rewritten once the fence of its swapchain image has been waited.
+*/
+class UniformArena
+{
+public:
+    UniformArena(RenderContext& renderContext);
+    ~UniformArena();
+
+public:
+    void create(uint32_t frameCount, VkDeviceSize frameCapacity);
+    void cleanUp();
+
+    // Reset the linear allocator on the region of the given swapchain image
+    void beginFrame(uint32_t frameIndex);
+    // Returns the dynamic offset of an aligned slice of the current frame region
+    uint32_t allocate(VkDeviceSize size, void** data);
+
+    template<typename T>
+    uint32_t push(const T& value)
+    {
+        void* data;
+        uint32_t offset = allocate(sizeof(T), &data);
+        memcpy(data, &value, sizeof(T));
+        return offset;
+    }
+
+    VkBuffer buffer() const;
+    VkDeviceSize frameCapacity() const;
+    VkDeviceSize frameUsage() const;
+
+private:
+    RenderContext& m_renderContext;
+    VkBuffer m_buffer;
+    VkDeviceMemory m_memory;
+    unsigned char* m_mappedData;
+    VkDeviceSize m_alignment;
+    VkDeviceSize m_frameCapacity;
+    uint32_t m_frameCount;
+    VkDeviceSize m_frameBegin;
+    VkDeviceSize m_head;
+};
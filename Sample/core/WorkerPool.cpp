@@ -0,0 +1,108 @@
+#include "WorkerPool.h"
+
+#include "CpuProfiler.h"
+#include <string>
+
+WorkerPool::WorkerPool(size_t workerCount):
+    m_job(nullptr),
+    m_generation(0),
+    m_pendingWorkers(0),
+    m_stopping(false)
+{
+    for (size_t worker = 1; worker < workerCount; worker++) {
+        m_threads.emplace_back(&WorkerPool::workerLoop, this, worker);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobReady.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+size_t WorkerPool::workerCount() const
+{
+    return m_threads.size() + 1;
+}
+
+// The calling thread takes its share before waiting for the others
+void WorkerPool::run(const Job& job)
+{
+    if (m_threads.empty()) {
+        job(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_pendingWorkers = m_threads.size();
+        m_failure = nullptr;
+        m_generation++;
+    }
+    m_jobReady.notify_all();
+
+    std::exception_ptr failure;
+    try {
+        job(0);
+    }
+    catch (...) {
+        failure = std::current_exception();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_jobDone.wait(lock, [this]() { return m_pendingWorkers == 0; });
+        m_job = nullptr;
+        if (!failure) {
+            failure = m_failure;
+        }
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+/* -------------------------- Private methods -------------------------- */
+
+void WorkerPool::workerLoop(size_t worker)
+{
+    CpuProfiler::setThreadName("Worker " + std::to_string(worker));
+    uint64_t generation = 0;
+    while (true) {
+        const Job* job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobReady.wait(lock, [this, generation]() { return m_stopping || m_generation != generation; });
+            if (m_stopping) {
+                return;
+            }
+            generation = m_generation;
+            job = m_job;
+        }
+
+        std::exception_ptr failure;
+        try {
+            (*job)(worker);
+        }
+        catch (...) {
+            failure = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (failure && !m_failure) {
+            m_failure = failure;
+        }
+        if (--m_pendingWorkers == 0) {
+            m_jobDone.notify_one();
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+    Threads created once and parked on a condition variable between jobs. A job runs once per
+    worker, the calling thread being worker 0, and run returns when every worker is done with it.
+    The first exception thrown by a worker is rethrown by run.
+*/
+class WorkerPool
+{
+public:
+    using Job = std::function<void(size_t worker)>;
+
+public:
+    // workerCount includes the calling thread, a single worker creates no thread
+    WorkerPool(size_t workerCount);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+public:
+    size_t workerCount() const;
+    void run(const Job& job);
+
+private:
+    void workerLoop(size_t worker);
+
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_jobReady;
+    std::condition_variable m_jobDone;
+    // the job of the current run, a new generation wakes the workers
+    const Job* m_job;
+    uint64_t m_generation;
+    size_t m_pendingWorkers;
+    bool m_stopping;
+    std::exception_ptr m_failure;
+};
@@ -4,15 +4,102 @@
 #include <iostream>
 #include <stdexcept>
 #include <cstdlib> 
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <cstdint>
 
+static const char* benchmarkUsage = "usage: --headless [--frames N] [--size WxH] [--capture directory] [--capture-every N] [--report file.csv]";
 
-int main() {
+// Decimal count of at least minimum, a negative or non numeric value is an error instead of a wrapped around count
+static uint32_t parseCount(const char* option, const char* value, unsigned long minimum)
+{
+    char* end = nullptr;
+    unsigned long count = strtoul(value, &end, 10);
+    if (value[0] < '0' || value[0] > '9' || *end != '\0' || count < minimum || count > UINT32_MAX) {
+        throw std::invalid_argument(std::string("invalid value for ") + option + ": " + value);
+    }
+    return static_cast<uint32_t>(count);
+}
+
+/*
+    --headless [--frames N] [--size WxH] [--capture directory] [--capture-every N] [--report file.csv]
+    renders offscreen without a window and reports the frame timings
+*/
+static bool parseBenchmarkSettings(int argc, char** argv, BenchmarkSettings& settings)
+{
+    bool headless = false;
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        if (strcmp(option, "--headless") == 0) {
+            headless = true;
+            continue;
+        }
+        // every other option takes a value
+        bool known = strcmp(option, "--frames") == 0 || strcmp(option, "--size") == 0 || strcmp(option, "--capture") == 0
+            || strcmp(option, "--capture-every") == 0 || strcmp(option, "--report") == 0;
+        if (!known) {
+            throw std::invalid_argument(std::string("unknown option: ") + option);
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument(std::string("missing value for ") + option);
+        }
+        const char* value = argv[++i];
+
+        if (strcmp(option, "--frames") == 0) {
+            settings.frameCount = parseCount(option, value, 1);
+        }
+        else if (strcmp(option, "--size") == 0) {
+            // both dimensions go through parseCount, a sign or trailing characters are rejected
+            std::string size(value);
+            size_t separator = size.find('x');
+            try {
+                if (separator == std::string::npos) {
+                    throw std::invalid_argument(size);
+                }
+                uint32_t width = parseCount(option, size.substr(0, separator).c_str(), 1);
+                uint32_t height = parseCount(option, size.substr(separator + 1).c_str(), 1);
+                settings.dimension = { width, height };
+            }
+            catch (const std::invalid_argument&) {
+                throw std::invalid_argument(std::string("invalid value for --size: ") + value);
+            }
+        }
+        else if (strcmp(option, "--capture") == 0) {
+            settings.captureDirectory = value;
+        }
+        else if (strcmp(option, "--capture-every") == 0) {
+            settings.captureInterval = parseCount(option, value, 0);
+        }
+        else {
+            settings.reportPath = value;
+        }
+    }
+    return headless;
+}
+
+int main(int argc, char** argv) {
     //Application app;
     Platform platform;
+    BenchmarkSettings benchmarkSettings;
+    bool headless = false;
+    try {
+        headless = parseBenchmarkSettings(argc, argv, benchmarkSettings);
+    }
+    catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << std::endl << benchmarkUsage << std::endl;
+        return EXIT_FAILURE;
+    }
 
     try {
-        platform.initialize();
-        platform.mainLoop();
+        if (headless) {
+            platform.initializeHeadless(benchmarkSettings);
+            platform.runBenchmark();
+        }
+        else {
+            platform.initialize();
+            platform.mainLoop();
+        }
         platform.cleanUp();
     }
     catch (const std::exception& e) {
@@ -21,4 +108,4 @@ int main() {
     }
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,145 @@
+#include "BlueNoise2D.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <limits>
+
+// Standard deviation of the energy filter, 1.5 is the value of the original paper
+static const float sigma = 1.5f;
+
+BlueNoise2D::BlueNoise2D(uint32_t size):
+    m_size(size),
+    m_randomSeed(42)
+{
+    computeRanks();
+}
+
+BlueNoise2D::BlueNoise2D(uint32_t size, int randomSeed):
+    m_size(size),
+    m_randomSeed(randomSeed)
+{
+    computeRanks();
+}
+
+BlueNoise2D::~BlueNoise2D()
+{
+
+}
+
+/* --------------------------------- Public methods --------------------------------- */
+
+float BlueNoise2D::evaluate(const glm::ivec2& pos) const
+{
+    uint32_t x = static_cast<uint32_t>(pos.x) % m_size;
+    uint32_t y = static_cast<uint32_t>(pos.y) % m_size;
+    return static_cast<float>(m_ranks[y * m_size + x]) / static_cast<float>(m_ranks.size());
+}
+
+/* --------------------------------- Private methods --------------------------------- */
+
+/*
+    - start from a random pattern holding 10% of the pixels and move its tightest clusters
+      to its largest voids until it is stable
+    - rank the initial points by removing the tightest clusters one by one
+    - rank the other pixels by filling the largest voids one by one
+*/
+void BlueNoise2D::computeRanks()
+{
+    uint32_t pixelCount = m_size * m_size;
+    m_kernel.resize(pixelCount);
+    for (uint32_t y = 0; y < m_size; y++) {
+        for (uint32_t x = 0; x < m_size; x++) {
+            float dx = static_cast<float>(std::min(x, m_size - x));
+            float dy = static_cast<float>(std::min(y, m_size - y));
+            m_kernel[y * m_size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+        }
+    }
+
+    std::mt19937 generator(m_randomSeed);
+    std::uniform_int_distribution<uint32_t> distribution(0, pixelCount - 1);
+    std::vector<bool> initialPattern(pixelCount, false);
+    std::vector<float> initialEnergy(pixelCount, 0.0f);
+    uint32_t initialCount = std::max(1u, pixelCount / 10);
+    for (uint32_t placed = 0; placed < initialCount;) {
+        uint32_t index = distribution(generator);
+        if (!initialPattern[index]) {
+            initialPattern[index] = true;
+            addPoint(initialEnergy, index, 1.0f);
+            placed++;
+        }
+    }
+
+    while (true) {
+        uint32_t cluster = tightestCluster(initialEnergy, initialPattern);
+        initialPattern[cluster] = false;
+        addPoint(initialEnergy, cluster, -1.0f);
+        uint32_t hole = largestVoid(initialEnergy, initialPattern);
+        initialPattern[hole] = true;
+        addPoint(initialEnergy, hole, 1.0f);
+        if (hole == cluster) {
+            break;
+        }
+    }
+
+    m_ranks.assign(pixelCount, 0);
+
+    std::vector<bool> pattern = initialPattern;
+    std::vector<float> energy = initialEnergy;
+    for (uint32_t rank = initialCount; rank > 0; rank--) {
+        uint32_t cluster = tightestCluster(energy, pattern);
+        pattern[cluster] = false;
+        addPoint(energy, cluster, -1.0f);
+        m_ranks[cluster] = rank - 1;
+    }
+
+    // past half the pixels the largest void of the ones is the tightest cluster of the zeros,
+    // so the same selection ranks the remaining pixels
+    pattern = initialPattern;
+    energy = initialEnergy;
+    for (uint32_t rank = initialCount; rank < pixelCount; rank++) {
+        uint32_t hole = largestVoid(energy, pattern);
+        pattern[hole] = true;
+        addPoint(energy, hole, 1.0f);
+        m_ranks[hole] = rank;
+    }
+}
+
+void BlueNoise2D::addPoint(std::vector<float>& energy, uint32_t index, float sign) const
+{
+    uint32_t px = index % m_size;
+    uint32_t py = index / m_size;
+    for (uint32_t y = 0; y < m_size; y++) {
+        uint32_t dy = (y + m_size - py) % m_size;
+        for (uint32_t x = 0; x < m_size; x++) {
+            uint32_t dx = (x + m_size - px) % m_size;
+            energy[y * m_size + x] += sign * m_kernel[dy * m_size + dx];
+        }
+    }
+}
+
+uint32_t BlueNoise2D::tightestCluster(const std::vector<float>& energy, const std::vector<bool>& pattern) const
+{
+    uint32_t result = 0;
+    float maxEnergy = -std::numeric_limits<float>::max();
+    for (uint32_t i = 0; i < energy.size(); i++) {
+        if (pattern[i] && energy[i] > maxEnergy) {
+            maxEnergy = energy[i];
+            result = i;
+        }
+    }
+    return result;
+}
+
+uint32_t BlueNoise2D::largestVoid(const std::vector<float>& energy, const std::vector<bool>& pattern) const
+{
+    uint32_t result = 0;
+    float minEnergy = std::numeric_limits<float>::max();
+    for (uint32_t i = 0; i < energy.size(); i++) {
+        if (!pattern[i] && energy[i] < minEnergy) {
+            minEnergy = energy[i];
+            result = i;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/*
+    Tileable blue noise threshold map built with the void and cluster method (Ulichney 93),
+    every value appears once so any threshold gives an evenly spread set of pixels
+*/
+class BlueNoise2D
+{
+public:
+    BlueNoise2D(uint32_t size);
+    BlueNoise2D(uint32_t size, int randomSeed);
+    ~BlueNoise2D();
+
+public:
+    // rank of the pixel normalized to [0, 1[, pos wraps around the tile
+    float evaluate(const glm::ivec2& pos) const;
+
+private:
+    void computeRanks();
+    void addPoint(std::vector<float>& energy, uint32_t index, float sign) const;
+    uint32_t tightestCluster(const std::vector<float>& energy, const std::vector<bool>& pattern) const;
+    uint32_t largestVoid(const std::vector<float>& energy, const std::vector<bool>& pattern) const;
+
+private:
+    uint32_t m_size;
+    int m_randomSeed;
+    // toroidal gaussian indexed by the wrapped offset between two pixels
+    std::vector<float> m_kernel;
+    std::vector<uint32_t> m_ranks;
+};
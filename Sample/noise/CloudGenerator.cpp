@@ -1,6 +1,7 @@
 #include "CloudGenerator.h"
 
 #include <noise/BrownianNoise3D.h>
+#include <core/CpuProfiler.h>
 
 #include <iostream>
 
@@ -28,6 +29,7 @@ CloudGenerator::CloudGenerator(uint32_t width, uint32_t height, uint32_t depth,
 
 std::vector<unsigned char> CloudGenerator::compute3DTexture(float noiseScale)
 {
+    CPU_ZONE("CloudGenerator::compute3DTexture");
     const uint32_t texMemSize = m_width * m_height * m_depth;
     auto result = std::vector<unsigned char>(texMemSize);
     m_worleyGenerator = WorleyNoise3D(glm::ivec3(4, 4, 4), m_randomSeed);
@@ -95,6 +97,7 @@ std::vector<unsigned char> CloudGenerator::compute3DTexture(float noiseScale)
 
 void CloudGenerator::computeWeatherTexture(float noiseScale, float randomSeed)
 {
+    CPU_ZONE("CloudGenerator::computeWeatherTexture");
     m_weatherGenerator = WorleyNoise2D(glm::ivec3(4, 4, 4), randomSeed);
     m_weatherTexture.resize(m_width * m_depth);
 
@@ -0,0 +1,172 @@
+#include "CloudField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// the boxes fill a layer above the fog, away from its center
+static const float fieldExtent = 6.0f;
+static const float fieldClearance = 1.0f;
+static const float layerBottom = 1.0f;
+static const float layerTop = 2.0f;
+
+CloudField::CloudField(Cube& mesh, CloudFieldMaterial& material, CubicFog& fog, uint32_t instanceCount, uint32_t seed) :
+    SceneObject(),
+    m_mesh(mesh),
+    m_material(material),
+    m_fog(fog),
+    m_instanceBuffer(VK_NULL_HANDLE),
+    m_instanceBufferMemory(VK_NULL_HANDLE),
+    m_visibleSlot(0)
+{
+    generateInstances(instanceCount, seed);
+}
+
+CloudField::~CloudField()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+void CloudField::createInstanceBuffer(RenderContext& renderContext)
+{
+    VkDeviceSize bufferSize = instanceBufferSize();
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    renderContext.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+    void* data;
+    vkMapMemory(renderContext.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
+    memcpy(data, m_instances.data(), (size_t)bufferSize);
+    vkUnmapMemory(renderContext.device(), stagingBufferMemory);
+
+    renderContext.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_instanceBuffer, m_instanceBufferMemory);
+    renderContext.copyBuffer(stagingBuffer, m_instanceBuffer, bufferSize);
+
+    vkDestroyBuffer(renderContext.device(), stagingBuffer, nullptr);
+    vkFreeMemory(renderContext.device(), stagingBufferMemory, nullptr);
+}
+
+VkBuffer CloudField::instanceBuffer() const
+{
+    return m_instanceBuffer;
+}
+
+VkDeviceSize CloudField::instanceBufferSize() const
+{
+    return sizeof(CloudFieldMaterial::InstanceData) * m_instances.size();
+}
+
+void CloudField::setVisibleInstances(uint32_t visibleSlot)
+{
+    m_visibleSlot = visibleSlot;
+}
+
+uint32_t CloudField::drawOrderIndex() const
+{
+    return (m_uniformOffset + sizeof(CloudFieldMaterial::FieldData)) / 16;
+}
+
+/*
+    Updated after the fog to share its lighting. The camera is brought in the space of the
+    fog box, the shaders bring it in each instance with its inverse transform
+*/
+void CloudField::update(RenderContext& renderContext, Camera& camera, const ViewParams& viewParams, UniformArena& uniformArena)
+{
+    glm::mat4 model = camera.arcBallModel() * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 1.0f, viewParams.fogScale()));
+    glm::vec3 eye = glm::vec3(glm::inverse(model) * glm::vec4(camera.eye(), 1.0f));
+
+    CloudFieldMaterial::FieldData fieldData;
+    fieldData.cloud = *m_fog.shaderData();
+    fieldData.cloud.worldCamera = glm::vec4(eye, 1.0f);
+    fieldData.cloud.bboxMin = glm::vec4(m_mesh.bboxMin(), 0.0f);
+    fieldData.cloud.bboxMax = glm::vec4(m_mesh.bboxMax(), 0.0f);
+    fieldData.field = glm::vec4(static_cast<float>(m_instances.size()), static_cast<float>(m_visibleSlot), 0.0f, 0.0f);
+    m_material.setVariant(viewParams.fogQuality());
+
+    for (size_t i = 0; i < m_instances.size(); i++) {
+        glm::vec3 delta = glm::vec3(m_instances[i].transform[3]) - eye;
+        m_distances[i] = glm::dot(delta, delta);
+    }
+    std::sort(m_drawOrder.begin(), m_drawOrder.end(), [this](uint32_t a, uint32_t b) {
+        return m_distances[a] > m_distances[b];
+    });
+
+    // the indices are read as floats by the cull pass, exact far beyond the instance count
+    size_t orderSize = ((m_drawOrder.size() + 3) / 4) * sizeof(glm::vec4);
+    void* data;
+    m_uniformOffset = uniformArena.allocate(sizeof(fieldData) + orderSize, &data);
+    memcpy(data, &fieldData, sizeof(fieldData));
+    float* order = reinterpret_cast<float*>(static_cast<unsigned char*>(data) + sizeof(fieldData));
+    for (size_t i = 0; i < m_drawOrder.size(); i++) {
+        order[i] = static_cast<float>(m_drawOrder[i]);
+    }
+}
+
+bool CloudField::hasShaderData() const
+{
+    return true;
+}
+
+Mesh* CloudField::getMesh()
+{
+    return &m_mesh;
+}
+
+Material* CloudField::getMaterial()
+{
+    return &m_material;
+}
+
+uint32_t CloudField::instanceCount() const
+{
+    return static_cast<uint32_t>(m_instances.size());
+}
+
+void CloudField::cleanUp(RenderContext& renderContext)
+{
+    vkDestroyBuffer(renderContext.device(), m_instanceBuffer, nullptr);
+    vkFreeMemory(renderContext.device(), m_instanceBufferMemory, nullptr);
+    m_instanceBuffer = VK_NULL_HANDLE;
+    m_instanceBufferMemory = VK_NULL_HANDLE;
+}
+
+/* -------------------------- Private methods -------------------------- */
+
+void CloudField::generateInstances(uint32_t instanceCount, uint32_t seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> position(-fieldExtent, fieldExtent);
+    std::uniform_real_distribution<float> height(layerBottom, layerTop);
+    std::uniform_real_distribution<float> width(0.6f, 1.6f);
+    std::uniform_real_distribution<float> thickness(0.3f, 0.6f);
+    std::uniform_real_distribution<float> angle(0.0f, glm::two_pi<float>());
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    m_instances.resize(instanceCount);
+    for (auto& instance : m_instances) {
+        glm::vec3 center;
+        do {
+            center = glm::vec3(position(generator), height(generator), position(generator));
+        } while (std::abs(center.x) < fieldClearance && std::abs(center.z) < fieldClearance);
+
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), center);
+        transform = glm::rotate(transform, angle(generator), glm::vec3(0.0f, 1.0f, 0.0f));
+        transform = glm::scale(transform, glm::vec3(width(generator), thickness(generator), width(generator)));
+        instance.transform = transform;
+        instance.inverseTransform = glm::inverse(transform);
+        instance.seedOffset = glm::vec4(unit(generator), unit(generator), unit(generator), 0.6f + 0.6f * unit(generator));
+        instance.motion = glm::vec4(0.5f + unit(generator), 0.0f, 0.0f, 0.0f);
+    }
+
+    m_drawOrder.resize(instanceCount);
+    m_distances.resize(instanceCount, 0.0f);
+    for (uint32_t i = 0; i < instanceCount; i++) {
+        m_drawOrder[i] = i;
+    }
+}
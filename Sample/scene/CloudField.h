@@ -0,0 +1,50 @@
+#pragma once
+
+#include <utils/Cube.h>
+#include "SceneObject.h"
+#include "CubicFog.h"
+#include "CloudFieldMaterial.h"
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Layer of cloud boxes around the fog, every box shares the cube mesh and the noise texture
+class CloudField : public SceneObject
+{
+public:
+    CloudField(Cube& mesh, CloudFieldMaterial& material, CubicFog& fog, uint32_t instanceCount, uint32_t seed);
+    ~CloudField();
+
+public:
+    // The instances never change, uploaded once in device local memory
+    void createInstanceBuffer(RenderContext& renderContext);
+    VkBuffer instanceBuffer() const;
+    VkDeviceSize instanceBufferSize() const;
+    // The cull pass compacts the visible instances in draw order into a list, the range of the field comes with its draw object
+    void setVisibleInstances(uint32_t visibleSlot);
+    // vec4 index of the draw order in the arena, valid after the update
+    uint32_t drawOrderIndex() const;
+
+    void update(RenderContext& renderContex, Camera& camera, const ViewParams& viewParams, UniformArena& uniformArena) override;
+    bool hasShaderData() const override;
+    Mesh* getMesh() override;
+    Material* getMaterial() override;
+    uint32_t instanceCount() const override;
+    void cleanUp(RenderContext& renderContext);
+
+private:
+    void generateInstances(uint32_t instanceCount, uint32_t seed);
+
+private:
+    Cube& m_mesh;
+    CloudFieldMaterial& m_material;
+    CubicFog& m_fog;
+    std::vector<CloudFieldMaterial::InstanceData> m_instances;
+    // back to front every frame, the blending needs the farthest boxes first
+    std::vector<uint32_t> m_drawOrder;
+    std::vector<float> m_distances;
+    VkBuffer m_instanceBuffer;
+    VkDeviceMemory m_instanceBufferMemory;
+    uint32_t m_visibleSlot;
+};
@@ -0,0 +1,48 @@
+#include "CloudFieldMaterial.h"
+#include <core/DescriptorTable.h>
+
+CloudFieldMaterial::CloudFieldMaterial(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader, FogMaterial& fogMaterial):
+    Material(device, vertexShader, fragmentShader),
+    m_fogMaterial(fogMaterial),
+    m_instanceBuffer(VK_NULL_HANDLE),
+    m_instanceBufferRange(0)
+{
+    // same quality tiers as the fog
+    setSpecializationEntries(FogMaterial::qualityEntries());
+    for (uint32_t quality = 0; quality < static_cast<uint32_t>(FogQuality::Count); quality++) {
+        addVariant(FogMaterial::qualityConstants(quality));
+    }
+    setVariant(static_cast<uint32_t>(FogQuality::High));
+    // back faces with the camera inside a box too, the boxes are sorted instead of depth tested against each other
+    setCullMode(VK_CULL_MODE_FRONT_BIT);
+    setDepthWrite(false);
+}
+
+CloudFieldMaterial::~CloudFieldMaterial()
+{
+
+}
+
+// Registered after the fog material, its noise slots are already known
+const char* CloudFieldMaterial::name() const
+{
+    return "Cloud field";
+}
+
+void CloudFieldMaterial::registerResources(DescriptorTable& descriptorTable)
+{
+    m_textureIndex = m_fogMaterial.textureIndex();
+    m_samplerIndex = m_fogMaterial.samplerIndex();
+    m_bufferIndex = descriptorTable.addStorageBuffer(m_instanceBuffer, m_instanceBufferRange);
+}
+
+void CloudFieldMaterial::setInstanceBuffer(VkBuffer buffer, VkDeviceSize range)
+{
+    m_instanceBuffer = buffer;
+    m_instanceBufferRange = range;
+}
+
+uint32_t CloudFieldMaterial::instanceBufferIndex() const
+{
+    return m_bufferIndex;
+}
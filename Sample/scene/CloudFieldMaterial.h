@@ -0,0 +1,51 @@
+#pragma once
+
+#include "FogMaterial.h"
+
+#include <utils/Material.h>
+#include <glm/glm.hpp>
+
+/*
+    Many fog boxes drawn in one instanced call of the main pass, blended back to front.
+    The noise texture and its sampler are the ones of the fog material, every instance
+    reads its own transform and noise parameters from the instance buffer.
+*/
+class CloudFieldMaterial : public Material
+{
+public:
+    CloudFieldMaterial(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader, FogMaterial& fogMaterial);
+    ~CloudFieldMaterial();
+
+public:
+    // Same layout as CloudInstance in cloud_field.vert and cloud_field.frag
+    struct InstanceData {
+        // unit box to the space of the fog box
+        glm::mat4 transform;
+        glm::mat4 inverseTransform;
+        // xyz: offset in the noise texture, w: density scale
+        glm::vec4 seedOffset;
+        // x: scale of the fog scroll speed
+        glm::vec4 motion;
+    };
+
+    // Frame data, the draw order of the instances follows it, packed 4 per vec4
+    struct FieldData {
+        // camera and light in the space of the fog box, the unit box as bounds
+        FogMaterial::CloudData cloud;
+        // x: instance count, y: storage slot of the visible instances
+        glm::vec4 field;
+    };
+
+public:
+    void registerResources(DescriptorTable& descriptorTable) override;
+    const char* name() const override;
+    // Owned by the cloud field, added to the storage buffers with the other resources
+    void setInstanceBuffer(VkBuffer buffer, VkDeviceSize range);
+    // Storage slot of the instances, read by the cull pass as well
+    uint32_t instanceBufferIndex() const;
+
+private:
+    FogMaterial& m_fogMaterial;
+    VkBuffer m_instanceBuffer;
+    VkDeviceSize m_instanceBufferRange;
+};
@@ -0,0 +1,138 @@
+#include "ClusterCulling.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+ClusterCulling::ClusterCulling(VkShaderModule cullShader):
+    m_cullShader(cullShader),
+    m_pipeline(VK_NULL_HANDLE),
+    m_pipelineLayout(VK_NULL_HANDLE),
+    m_meshletCount(0),
+    m_chunkCount(0),
+    m_uniformOffset(0),
+    m_meshletBuffer(VK_NULL_HANDLE),
+    m_meshletBufferMemory(VK_NULL_HANDLE),
+    m_meshletIndex(0),
+    m_indexBufferIndex(0),
+    m_commandIndex(0),
+    m_drawSlotIndex(0)
+{
+    static_assert(sizeof(ClusterObject) % 16 == 0, "the cluster objects are read as vec4");
+    static_assert(sizeof(ClusterChunk) == 16, "the cluster chunks are read as vec4");
+}
+
+ClusterCulling::~ClusterCulling()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+void ClusterCulling::createBuffers(RenderContext& renderContext, const std::vector<Meshlet>& meshlets)
+{
+    // a scene without large mesh still gets a buffer to register
+    m_meshletCount = static_cast<uint32_t>(meshlets.size());
+    VkDeviceSize bufferSize = sizeof(Meshlet) * std::max(m_meshletCount, 1u);
+    renderContext.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_meshletBuffer, m_meshletBufferMemory);
+    if (meshlets.empty()) {
+        return;
+    }
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    renderContext.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+    void* data;
+    vkMapMemory(renderContext.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
+    memcpy(data, meshlets.data(), (size_t)bufferSize);
+    vkUnmapMemory(renderContext.device(), stagingBufferMemory);
+    renderContext.copyBuffer(stagingBuffer, m_meshletBuffer, bufferSize);
+
+    vkDestroyBuffer(renderContext.device(), stagingBuffer, nullptr);
+    vkFreeMemory(renderContext.device(), stagingBufferMemory, nullptr);
+}
+
+void ClusterCulling::registerBuffers(DescriptorTable& descriptorTable, const GeometryArena& geometryArena, const GpuCulling& gpuCulling)
+{
+    m_meshletIndex = descriptorTable.addStorageBuffer(m_meshletBuffer, sizeof(Meshlet) * std::max(m_meshletCount, 1u));
+    m_indexBufferIndex = descriptorTable.addStorageBuffer(geometryArena.indexBuffer(), geometryArena.indexSize());
+    m_commandIndex = gpuCulling.commandIndex();
+    m_drawSlotIndex = gpuCulling.drawSlotIndex();
+}
+
+void ClusterCulling::createPipeline(RenderContext& renderContext, VkPipelineLayout pipelineLayout)
+{
+    m_pipelineLayout = pipelineLayout;
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = m_cullShader;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_pipelineLayout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    if (vkCreateComputePipelines(renderContext.device(), renderContext.pipelineCache(), 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create cluster culling pipeline!");
+    }
+}
+
+void ClusterCulling::destroyPipeline(RenderContext& renderContext)
+{
+    vkDestroyPipeline(renderContext.device(), m_pipeline, nullptr);
+    m_pipeline = VK_NULL_HANDLE;
+}
+
+// The view projection comes first, then the vec4 offset of the objects with the slot of the draw slots, the chunks and the objects
+void ClusterCulling::update(const glm::mat4& viewProj, const std::vector<ClusterObject>& objects, UniformArena& uniformArena)
+{
+    m_chunks.clear();
+    for (uint32_t object = 0; object < objects.size(); object++) {
+        for (uint32_t meshlet = 0; meshlet < objects[object].meshlets.y; meshlet += groupSize) {
+            m_chunks.push_back({ glm::uvec4(object, meshlet, 0, 0) });
+        }
+    }
+    m_chunkCount = static_cast<uint32_t>(m_chunks.size());
+    if (m_chunks.empty()) {
+        return;
+    }
+
+    size_t headerSize = sizeof(viewProj) + sizeof(glm::uvec4);
+    size_t chunkSize = sizeof(ClusterChunk) * m_chunks.size();
+    // x: vec4 offset of the objects from the start of the data, y: storage slot of the draw slots
+    glm::uvec4 header(static_cast<uint32_t>((headerSize + chunkSize) / 16), m_drawSlotIndex, 0, 0);
+
+    void* data;
+    m_uniformOffset = uniformArena.allocate(headerSize + chunkSize + sizeof(ClusterObject) * objects.size(), &data);
+    unsigned char* bytes = static_cast<unsigned char*>(data);
+    memcpy(bytes, &viewProj, sizeof(viewProj));
+    memcpy(bytes + sizeof(viewProj), &header, sizeof(header));
+    memcpy(bytes + headerSize, m_chunks.data(), chunkSize);
+    memcpy(bytes + headerSize + chunkSize, objects.data(), sizeof(ClusterObject) * objects.size());
+}
+
+void ClusterCulling::dispatch(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable)
+{
+    if (m_chunkCount == 0) {
+        return;
+    }
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    descriptorTable.bindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+    // the index buffer, the commands and the meshlets are storage buffer slots, one workgroup per chunk of meshlets
+    DrawConstants drawConstants{ m_uniformOffset / 16, m_indexBufferIndex, m_commandIndex, m_meshletIndex };
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DrawConstants), &drawConstants);
+    vkCmdDispatch(commandBuffer, m_chunkCount, 1, 1);
+}
+
+void ClusterCulling::cleanUp(RenderContext& renderContext)
+{
+    vkDestroyShaderModule(renderContext.device(), m_cullShader, nullptr);
+
+    vkDestroyBuffer(renderContext.device(), m_meshletBuffer, nullptr);
+    vkFreeMemory(renderContext.device(), m_meshletBufferMemory, nullptr);
+    m_meshletBuffer = VK_NULL_HANDLE;
+}
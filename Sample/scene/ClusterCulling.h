@@ -0,0 +1,76 @@
+#pragma once
+
+#include <core/DescriptorTable.h>
+#include <core/GeometryArena.h>
+#include <utils/Mesh.h>
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "GpuCulling.h"
+
+/*
+    Meshlet culling of the large meshes, after the culling of the objects. Every meshlet outside
+    of the frustum or facing away from the camera is dropped, the indices of the others are
+    copied in a range of the geometry arena left to the object. The draw command of the object
+    then only reads that range, the chunks of an object the gpu culling gave no command are skipped.
+    One workgroup per chunk of groupSize meshlets, the chunks of an object reserve their part of
+    the range atomically so the meshlets don't keep the order of the mesh.
+*/
+class ClusterCulling
+{
+public:
+    static constexpr uint32_t groupSize = 64;
+
+    // Same layout as ClusterObject in cluster_cull.comp
+    struct ClusterObject {
+        // from the mesh space to the space of the model matrix
+        glm::mat4 transform;
+        // xyz: camera position in the mesh space, w: 1 when the back facing meshlets can be dropped
+        glm::vec4 camera;
+        // x: first meshlet, y: meshlet count, z: scene object, its draw slot gives the command, w: first index of the culled range
+        glm::uvec4 meshlets;
+    };
+
+    // Same layout as ClusterChunk in cluster_cull.comp, one per workgroup
+    struct ClusterChunk {
+        // x: cluster object, y: first meshlet of the chunk counted from the first one of the object
+        glm::uvec4 meshlets;
+    };
+
+public:
+    ClusterCulling(VkShaderModule cullShader);
+    ~ClusterCulling();
+
+public:
+    // The meshlets of every mesh, their ranges in the whole geometry arena
+    void createBuffers(RenderContext& renderContext, const std::vector<Meshlet>& meshlets);
+    // Reads the meshlets and writes the culled indices through the storage buffer array, the index counts go in the commands of the object culling
+    // found through its draw slots
+    void registerBuffers(DescriptorTable& descriptorTable, const GeometryArena& geometryArena, const GpuCulling& gpuCulling);
+    void createPipeline(RenderContext& renderContext, VkPipelineLayout pipelineLayout);
+    void destroyPipeline(RenderContext& renderContext);
+    // viewProj goes from the model space to clip space, nothing is dispatched without objects.
+    // The arena holds viewProj, the offset of the objects and the draw slots, the chunks then the objects
+    void update(const glm::mat4& viewProj, const std::vector<ClusterObject>& objects, UniformArena& uniformArena);
+    void dispatch(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable);
+    void cleanUp(RenderContext& renderContext);
+
+private:
+    VkShaderModule m_cullShader;
+    VkPipeline m_pipeline;
+    VkPipelineLayout m_pipelineLayout;
+    uint32_t m_meshletCount;
+    uint32_t m_chunkCount;
+    uint32_t m_uniformOffset;
+    // rebuilt every frame, kept to reuse its storage
+    std::vector<ClusterChunk> m_chunks;
+
+    VkBuffer m_meshletBuffer;
+    VkDeviceMemory m_meshletBufferMemory;
+    // storage slots of the meshlets, the geometry arena indices, the draw commands and the draw slots
+    uint32_t m_meshletIndex;
+    uint32_t m_indexBufferIndex;
+    uint32_t m_commandIndex;
+    uint32_t m_drawSlotIndex;
+};
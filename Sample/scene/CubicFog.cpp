@@ -5,7 +5,8 @@
 CubicFog::CubicFog(Cube& mesh, FogMaterial& material) :
     SceneObject(),
     m_mesh(mesh),
-    m_material(material)
+    m_material(material),
+    m_frameIndex(0)
 {
     auto& vertices = m_mesh.vertices();
     auto planeIndex = 0;
@@ -21,6 +22,8 @@ CubicFog::CubicFog(Cube& mesh, FogMaterial& material) :
     m_shaderData.densityTreshold = glm::vec4(0.6f);
     m_shaderData.phaseParams = glm::vec4(0.6f, 0.6f, 0.5f, 0.5f);
     m_shaderData.fogSpeed = glm::vec4(1.0f);
+    m_shaderData.raymarchParams = glm::vec4(128.0f, 0.0f, 0.0f, 0.0f);
+    m_shaderData.marchParams = glm::vec4(0.01f, 4.0f, 0.05f, 8.0f);
 }
 
 CubicFog::~CubicFog()
@@ -30,9 +33,8 @@ CubicFog::~CubicFog()
 
 /* -------------------------- Public methods -------------------------- */
 
-void CubicFog::update(RenderContext& renderContext, Camera& camera, const ViewParams& viewParams, const DescriptorEntry& descriptorEntry)
+void CubicFog::update(RenderContext& renderContext, Camera& camera, const ViewParams& viewParams, UniformArena& uniformArena)
 {
-    void* fogData;
     glm::mat3 rot = camera.arcBallModel();
     rot = glm::inverse(rot);
     auto worldEye = rot * camera.eye();
@@ -52,10 +54,18 @@ void CubicFog::update(RenderContext& renderContext, Camera& camera, const ViewPa
     m_shaderData.lightAbsorption = glm::vec4(viewParams.lightAbsorption());
     m_shaderData.densityTreshold = glm::vec4(viewParams.densityTreshold());
     m_shaderData.phaseParams = glm::vec4(viewParams.inScatering(), viewParams.outScatering(), viewParams.phaseFactor(), viewParams.phaseOffset());
+    // the frame only drives the golden ratio offset of the noise, it can wrap
+    bool jitter = viewParams.temporalFog();
+    float raymarchSteps = glm::max(static_cast<float>(viewParams.raymarchSteps()) * viewParams.stepScale(), 4.0f);
+    m_shaderData.raymarchParams = glm::vec4(raymarchSteps, static_cast<float>(m_material.blueNoiseIndex()),
+        static_cast<float>(m_frameIndex % 1024), jitter ? 1.0f : 0.0f);
+    m_frameIndex++;
+    // every tier is already built, the next recorded draw uses the new pipeline
+    m_material.setVariant(viewParams.fogQuality());
+    m_shaderData.marchParams = glm::vec4(viewParams.transmittanceCutoff(), viewParams.emptyStepScale(),
+        viewParams.emptyDensity(), static_cast<float>(viewParams.minLightSteps()));
 
-    vkMapMemory(renderContext.device(), descriptorEntry.memory, 0, sizeof(FogMaterial::CloudData), 0, &fogData);
-    memcpy(fogData, &m_shaderData, sizeof(FogMaterial::CloudData));
-    vkUnmapMemory(renderContext.device(), descriptorEntry.memory);
+    m_uniformOffset = uniformArena.push(m_shaderData);
 }
 
 void CubicFog::setFogDensity(float opacity)
@@ -68,6 +78,11 @@ float CubicFog::fogDensity() const
     return m_shaderData.fogDensity;
 }
 
+bool CubicFog::hasShaderData() const
+{
+    return true;
+}
+
 Mesh* CubicFog::getMesh()
 {
     return &m_mesh;
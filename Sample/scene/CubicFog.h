@@ -16,7 +16,8 @@ public:
     ~CubicFog();
 
 public:
-    void update(RenderContext& renderContex, Camera& camera, const ViewParams& viewParams, const DescriptorEntry& descriptorEntry) override;
+    void update(RenderContext& renderContex, Camera& camera, const ViewParams& viewParams, UniformArena& uniformArena) override;
+    bool hasShaderData() const override;
     Mesh* getMesh() override;
     Material* getMaterial() override;
     FogMaterial::CloudData* shaderData();
@@ -27,4 +28,5 @@ private:
     Cube& m_mesh;
     FogMaterial& m_material;
     FogMaterial::CloudData m_shaderData;
+    uint32_t m_frameIndex;
 };
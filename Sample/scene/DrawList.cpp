@@ -0,0 +1,126 @@
+#include "DrawList.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+static_assert(DrawList::passBits + 1 + DrawList::pipelineBits + DrawList::meshBits + DrawList::depthBits == 64, "the draw key fields fill 64 bits");
+
+// width of the radix digit, the sort makes 64 / radixBits passes at most
+static const uint32_t radixBits = 8;
+static const uint32_t radixSize = 1 << radixBits;
+
+static uint64_t field(uint64_t value, uint32_t bits)
+{
+    return value & ((uint64_t(1) << bits) - 1);
+}
+
+DrawList::DrawList()
+{
+
+}
+
+DrawList::~DrawList()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+uint32_t DrawList::pipelineId(uint32_t material, uint32_t variant)
+{
+    return (material << variantBits) | static_cast<uint32_t>(field(variant, variantBits));
+}
+
+uint64_t DrawList::opaqueKey(uint32_t pass, uint32_t pipeline, uint32_t mesh, float depth)
+{
+    uint64_t key = field(pass, passBits);
+    key = (key << 1);
+    key = (key << pipelineBits) | field(pipeline, pipelineBits);
+    key = (key << meshBits) | field(mesh, meshBits);
+    key = (key << depthBits) | depthKey(depth);
+    return key;
+}
+
+uint64_t DrawList::blendedKey(uint32_t pass, uint32_t pipeline, uint32_t mesh, float depth)
+{
+    // farthest first
+    uint64_t key = field(pass, passBits);
+    key = (key << 1) | 1;
+    key = (key << depthBits) | field(~depthKey(depth), depthBits);
+    key = (key << pipelineBits) | field(pipeline, pipelineBits);
+    key = (key << meshBits) | field(mesh, meshBits);
+    return key;
+}
+
+void DrawList::clear()
+{
+    m_entries.clear();
+}
+
+void DrawList::add(uint64_t key, uint32_t objectIndex)
+{
+    m_entries.push_back({ key, objectIndex });
+}
+
+/*
+    Least significant digit first radix sort, each pass is a stable counting sort on one byte
+    of the key. Most bytes are the same for every draw (unused pipeline or mesh bits, a single
+    pass), their pass is skipped after the histogram
+*/
+void DrawList::sort()
+{
+    if (m_entries.size() < 2) {
+        return;
+    }
+    m_sortBuffer.resize(m_entries.size());
+
+    for (uint32_t shift = 0; shift < 64; shift += radixBits) {
+        std::array<uint32_t, radixSize> offsets{};
+        for (const Entry& entry : m_entries) {
+            offsets[(entry.key >> shift) & (radixSize - 1)]++;
+        }
+        if (offsets[(m_entries[0].key >> shift) & (radixSize - 1)] == m_entries.size()) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t& count : offsets) {
+            uint32_t digitCount = count;
+            count = offset;
+            offset += digitCount;
+        }
+        for (const Entry& entry : m_entries) {
+            m_sortBuffer[offsets[(entry.key >> shift) & (radixSize - 1)]++] = entry;
+        }
+        m_entries.swap(m_sortBuffer);
+    }
+}
+
+std::pair<size_t, size_t> DrawList::passRange(uint32_t pass) const
+{
+    uint32_t passShift = 64 - passBits;
+    auto first = std::lower_bound(m_entries.begin(), m_entries.end(), pass, [passShift](const Entry& entry, uint32_t value) {
+        return (entry.key >> passShift) < value;
+    });
+    auto last = std::upper_bound(first, m_entries.end(), pass, [passShift](uint32_t value, const Entry& entry) {
+        return value < (entry.key >> passShift);
+    });
+    return { static_cast<size_t>(first - m_entries.begin()), static_cast<size_t>(last - m_entries.begin()) };
+}
+
+const std::vector<DrawList::Entry>& DrawList::entries() const
+{
+    return m_entries;
+}
+
+/* -------------------------- Private methods -------------------------- */
+
+// Positive floats sort like their bits, the high bits keep the exponent and most of the mantissa
+uint64_t DrawList::depthKey(float depth)
+{
+    depth = std::max(depth, 0.0f);
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return bits >> (32 - 1 - depthBits);
+}
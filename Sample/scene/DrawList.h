@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+
+/*
+    Draws of the frame sorted by a packed 64 bit key, the state that is the most expensive
+    to change sits in the high bits:
+        - depth writing: pass | 0 | pipeline | mesh | depth front to back
+        - blended:       pass | 1 | depth back to front | pipeline | mesh
+    Consecutive draws of a pass then share their pipeline and mesh as often as possible,
+    blended draws keep the only order they can be composited in.
+*/
+class DrawList
+{
+public:
+    static constexpr uint32_t passBits = 2;
+    static constexpr uint32_t pipelineBits = 21;
+    static constexpr uint32_t meshBits = 16;
+    static constexpr uint32_t depthBits = 24;
+    // of the pipeline bits, the variants of a material are different pipelines
+    static constexpr uint32_t variantBits = 5;
+
+    struct Entry {
+        uint64_t key;
+        uint32_t objectIndex;
+    };
+
+public:
+    DrawList();
+    ~DrawList();
+
+public:
+    static uint32_t pipelineId(uint32_t material, uint32_t variant);
+    // depth is the view distance of the object
+    static uint64_t opaqueKey(uint32_t pass, uint32_t pipeline, uint32_t mesh, float depth);
+    static uint64_t blendedKey(uint32_t pass, uint32_t pipeline, uint32_t mesh, float depth);
+
+    void clear();
+    void add(uint64_t key, uint32_t objectIndex);
+    // Stable, equal keys keep the order they were added in
+    void sort();
+    // [first, last) of the draws of the pass, once sorted
+    std::pair<size_t, size_t> passRange(uint32_t pass) const;
+    const std::vector<Entry>& entries() const;
+
+private:
+    static uint64_t depthKey(float depth);
+
+private:
+    std::vector<Entry> m_entries;
+    // kept between frames, the sort never allocates once the scene is loaded
+    std::vector<Entry> m_sortBuffer;
+};
@@ -0,0 +1,140 @@
+#include "FogCompute.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// texels added around the projected box, the resolve and the upsample read the neighbours
+static const float tileMargin = 2.0f;
+
+FogCompute::FogCompute(VkShaderModule computeShader, CubicFog& fog, FogMaterial& material):
+    m_computeShader(computeShader),
+    m_fog(fog),
+    m_material(material),
+    m_pipelineLayout(VK_NULL_HANDLE),
+    m_uniformOffset(0),
+    m_targetIndex(0),
+    m_groupCountX(0),
+    m_groupCountY(0)
+{
+    static_assert(sizeof(FogMaterial::CloudData) % 16 == 0, "the march data is read as vec4 after the cloud data");
+}
+
+FogCompute::~FogCompute()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+void FogCompute::createPipelines(RenderContext& renderContext, VkPipelineLayout pipelineLayout)
+{
+    m_pipelineLayout = pipelineLayout;
+
+    uint32_t qualityCount = static_cast<uint32_t>(FogQuality::Count);
+    std::vector<VkSpecializationMapEntry> entries = FogMaterial::qualityEntries();
+    std::vector<FogMaterial::QualityConstants> constants(qualityCount);
+    std::vector<VkSpecializationInfo> specializationInfos(qualityCount);
+    std::vector<VkComputePipelineCreateInfo> pipelineInfos(qualityCount);
+
+    for (uint32_t quality = 0; quality < qualityCount; quality++) {
+        constants[quality] = FogMaterial::qualityConstants(quality);
+        specializationInfos[quality].mapEntryCount = static_cast<uint32_t>(entries.size());
+        specializationInfos[quality].pMapEntries = entries.data();
+        specializationInfos[quality].dataSize = sizeof(FogMaterial::QualityConstants);
+        specializationInfos[quality].pData = &constants[quality];
+
+        VkComputePipelineCreateInfo& pipelineInfo = pipelineInfos[quality];
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = m_computeShader;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.stage.pSpecializationInfo = &specializationInfos[quality];
+        pipelineInfo.layout = m_pipelineLayout;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+        pipelineInfo.basePipelineIndex = -1;
+    }
+
+    m_pipelines.resize(qualityCount, VK_NULL_HANDLE);
+    if (vkCreateComputePipelines(renderContext.device(), renderContext.pipelineCache(), qualityCount, pipelineInfos.data(), nullptr, m_pipelines.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create fog compute pipeline!");
+    }
+}
+
+void FogCompute::destroyPipelines(RenderContext& renderContext)
+{
+    for (auto pipeline : m_pipelines) {
+        vkDestroyPipeline(renderContext.device(), pipeline, nullptr);
+    }
+    m_pipelines.clear();
+}
+
+/*
+    The tiles only cover the projected corners of the box, with the whole target as soon as
+    a corner is behind the camera
+*/
+void FogCompute::update(RenderContext& renderContext, const ViewParams& viewParams, const glm::mat4& viewProj, UniformArena& uniformArena)
+{
+    const FogMaterial::CloudData* cloudData = m_fog.shaderData();
+    float divisor = static_cast<float>(viewParams.volumetricDivisor());
+    glm::vec2 viewport = glm::vec2(renderContext.width(), renderContext.height()) / divisor * viewParams.renderScale();
+    glm::vec2 targetSize = glm::ceil(viewport);
+
+    glm::vec2 boundsMin = targetSize;
+    glm::vec2 boundsMax = glm::vec2(0.0f);
+    bool behindCamera = false;
+    for (uint32_t corner = 0; corner < 8; corner++) {
+        glm::vec3 position = glm::vec3(
+            (corner & 1) ? cloudData->bboxMax.x : cloudData->bboxMin.x,
+            (corner & 2) ? cloudData->bboxMax.y : cloudData->bboxMin.y,
+            (corner & 4) ? cloudData->bboxMax.z : cloudData->bboxMin.z);
+        glm::vec4 clip = viewProj * glm::vec4(position, 1.0f);
+        if (clip.w <= 1e-4f) {
+            behindCamera = true;
+            break;
+        }
+        glm::vec2 texel = (glm::vec2(clip) / clip.w * 0.5f + 0.5f) * viewport;
+        boundsMin = glm::min(boundsMin, texel);
+        boundsMax = glm::max(boundsMax, texel);
+    }
+    if (behindCamera) {
+        boundsMin = glm::vec2(0.0f);
+        boundsMax = targetSize;
+    }
+    boundsMin = glm::clamp(glm::floor(boundsMin) - tileMargin, glm::vec2(0.0f), targetSize);
+    boundsMax = glm::clamp(glm::ceil(boundsMax) + tileMargin, glm::vec2(0.0f), targetSize);
+
+    glm::vec2 boundsSize = glm::max(boundsMax - boundsMin, glm::vec2(0.0f));
+    m_groupCountX = static_cast<uint32_t>(std::ceil(boundsSize.x / tileSize));
+    m_groupCountY = static_cast<uint32_t>(std::ceil(boundsSize.y / tileSize));
+
+    m_shaderData.cloud = *cloudData;
+    m_shaderData.inverseViewProj = glm::inverse(viewProj);
+    m_shaderData.viewport = glm::vec4(viewport, boundsMin);
+    m_uniformOffset = uniformArena.push(m_shaderData);
+}
+
+void FogCompute::setTargetIndex(uint32_t storageIndex)
+{
+    m_targetIndex = storageIndex;
+}
+
+void FogCompute::dispatch(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable)
+{
+    if (m_groupCountX == 0 || m_groupCountY == 0) {
+        return;
+    }
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[std::min<size_t>(m_material.variant(), m_pipelines.size() - 1)]);
+    descriptorTable.bindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+    // the noise textures of the fog material, the output is a storage image slot
+    DrawConstants drawConstants{ m_uniformOffset / 16, m_material.textureIndex(), m_material.samplerIndex(), m_targetIndex };
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DrawConstants), &drawConstants);
+    vkCmdDispatch(commandBuffer, m_groupCountX, m_groupCountY, 1);
+}
+
+void FogCompute::cleanUp(RenderContext& renderContext)
+{
+    vkDestroyShaderModule(renderContext.device(), m_computeShader, nullptr);
+}
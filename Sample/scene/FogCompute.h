@@ -0,0 +1,57 @@
+#pragma once
+
+#include "CubicFog.h"
+#include "FogMaterial.h"
+
+#include <core/DescriptorTable.h>
+#include <ui/ViewParams.h>
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+/*
+    Compute alternative to the rasterized fog box, writes the same color + entry distance
+    into the fog target through a storage image. 8x8 tiles are dispatched over the screen
+    bounds of the box only, the texels around them are never read by the resolve.
+*/
+class FogCompute
+{
+public:
+    static constexpr uint32_t tileSize = 8;
+
+    // Same layout as MarchData in cloud_march.comp, the cloud data comes first
+    struct MarchData {
+        FogMaterial::CloudData cloud;
+        // volumetric target pixel to the space of the fog box
+        glm::mat4 inverseViewProj;
+        // xy: texels covered by the fog at the current scale, zw: texel of the first tile
+        glm::vec4 viewport;
+    };
+
+public:
+    FogCompute(VkShaderModule computeShader, CubicFog& fog, FogMaterial& material);
+    ~FogCompute();
+
+public:
+    // One pipeline per quality tier of the fog material
+    void createPipelines(RenderContext& renderContext, VkPipelineLayout pipelineLayout);
+    void destroyPipelines(RenderContext& renderContext);
+    // After the fog update, viewProj goes from the box space to clip space
+    void update(RenderContext& renderContext, const ViewParams& viewParams, const glm::mat4& viewProj, UniformArena& uniformArena);
+    void setTargetIndex(uint32_t storageIndex);
+    void dispatch(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable);
+    void cleanUp(RenderContext& renderContext);
+
+private:
+    VkShaderModule m_computeShader;
+    CubicFog& m_fog;
+    FogMaterial& m_material;
+    std::vector<VkPipeline> m_pipelines;
+    VkPipelineLayout m_pipelineLayout;
+    MarchData m_shaderData;
+    uint32_t m_uniformOffset;
+    uint32_t m_targetIndex;
+    // tiles covering the screen bounds of the box
+    uint32_t m_groupCountX;
+    uint32_t m_groupCountY;
+};
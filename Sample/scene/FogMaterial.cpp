@@ -1,28 +1,29 @@
 #include "FogMaterial.h"
+#include <core/DescriptorTable.h>
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
 #include <glm/gtx/string_cast.hpp>
 
+// Low, medium, high, ultra
+static const FogMaterial::QualityConstants qualityTiers[] = {
+    { 32, 16.0f, 0.1f },
+    { 64, 32.0f, 0.07f },
+    { 128, 58.0f, 0.05f },
+    { 256, 96.0f, 0.03f }
+};
+
 FogMaterial::FogMaterial(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader):
-    Material(device, vertexShader, fragmentShader)
+    Material(device, vertexShader, fragmentShader, MaterialPass::Volumetric),
+    m_blueNoiseIndex(0)
 {
-    /* ------------------ Descriptor Binding ------------------ */
-
-    VkDescriptorSetLayoutBinding textureDataBinding;
-    textureDataBinding.binding = 1;
-    textureDataBinding.descriptorCount = 1;
-    textureDataBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    textureDataBinding.pImmutableSamplers = nullptr;
-    textureDataBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    VkDescriptorSetLayoutBinding fogDataBinding;
-    fogDataBinding.binding = 3;
-    fogDataBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    fogDataBinding.descriptorCount = 1;
-    fogDataBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    fogDataBinding.pImmutableSamplers = nullptr; // Optional
-
-    m_descriptorBindings.push_back(textureDataBinding);
-    m_descriptorBindings.push_back(fogDataBinding);
+    setSpecializationEntries(qualityEntries());
+    for (uint32_t quality = 0; quality < static_cast<uint32_t>(FogQuality::Count); quality++) {
+        addVariant(qualityConstants(quality));
+    }
+    setVariant(static_cast<uint32_t>(FogQuality::High));
+    // back faces cover the box on screen, with the camera inside too
+    setCullMode(VK_CULL_MODE_FRONT_BIT);
 }
 
 FogMaterial::~FogMaterial()
@@ -30,13 +31,6 @@ FogMaterial::~FogMaterial()
 
 }
 
-void FogMaterial::createDescriptorBuffer(RenderContext& renderContext, VkBuffer& buffer, VkDeviceMemory& memory)
-{
-    VkDeviceSize fogBufferSize = sizeof(CloudData);
-    VkMemoryPropertyFlags memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    renderContext.createBuffer(fogBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, memoryPropertyFlags, buffer, memory);
-}
-
 void FogMaterial::createTextureSampler(RenderContext& renderContext, const ImageView& imageView)
 {
     m_noiseTexture3D = imageView;
@@ -67,45 +61,50 @@ void FogMaterial::createTextureSampler(RenderContext& renderContext, const Image
     }
 }
 
-void FogMaterial::updateDescriptorSet(RenderContext& renderContext, VkDescriptorSet descriptorSet, VkBuffer buffer)
+std::vector<VkSpecializationMapEntry> FogMaterial::qualityEntries()
+{
+    return {
+        { 0, offsetof(QualityConstants, nbSamples), sizeof(int32_t) },
+        { 1, offsetof(QualityConstants, nbLightSamples), sizeof(float) },
+        { 2, offsetof(QualityConstants, darknessThreshold), sizeof(float) }
+    };
+}
+
+FogMaterial::QualityConstants FogMaterial::qualityConstants(uint32_t quality)
+{
+    return qualityTiers[std::min(quality, static_cast<uint32_t>(FogQuality::Count) - 1)];
+}
+
+void FogMaterial::setBlueNoise(const ImageView& imageView)
+{
+    m_blueNoiseTexture = imageView;
+}
+
+uint32_t FogMaterial::blueNoiseIndex() const
+{
+    return m_blueNoiseIndex;
+}
+
+uint32_t FogMaterial::textureIndex() const
+{
+    return m_textureIndex;
+}
+
+uint32_t FogMaterial::samplerIndex() const
+{
+    return m_samplerIndex;
+}
+
+const char* FogMaterial::name() const
+{
+    return "Fog";
+}
+
+void FogMaterial::registerResources(DescriptorTable& descriptorTable)
 {
-    std::vector<VkWriteDescriptorSet> descriptorWrites;
-
-    VkDescriptorBufferInfo fogInfo;
-    fogInfo.buffer = buffer;
-    fogInfo.offset = 0;
-    fogInfo.range = sizeof(CloudData);
-
-    VkDescriptorImageInfo imageInfo;
-    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    //imageInfo.imageView = m_textureImageView.view();
-    imageInfo.imageView = m_noiseTexture3D.view();
-    imageInfo.sampler = m_textureSampler;
-
-    VkWriteDescriptorSet imageSampler;
-    imageSampler.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    imageSampler.dstSet = descriptorSet;
-    imageSampler.dstBinding = 1;
-    imageSampler.dstArrayElement = 0;
-    imageSampler.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    imageSampler.descriptorCount = 1;
-    imageSampler.pImageInfo = &imageInfo;
-    imageSampler.pNext = nullptr;
-
-    VkWriteDescriptorSet cloudBuffer;
-    cloudBuffer.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    cloudBuffer.dstSet = descriptorSet;
-    cloudBuffer.dstBinding = 3;
-    cloudBuffer.dstArrayElement = 0;
-    cloudBuffer.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    cloudBuffer.descriptorCount = 1;
-    cloudBuffer.pBufferInfo = &fogInfo;
-    cloudBuffer.pNext = nullptr;
-
-    descriptorWrites.push_back(imageSampler);
-    descriptorWrites.push_back(cloudBuffer);
-
-    vkUpdateDescriptorSets(renderContext.device(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    m_textureIndex = descriptorTable.addTexture3D(m_noiseTexture3D.view());
+    m_samplerIndex = descriptorTable.addSampler(m_textureSampler);
+    m_blueNoiseIndex = descriptorTable.addTexture2D(m_blueNoiseTexture.view());
 }
 
 void FogMaterial::cleanUp(RenderContext& renderContext)
@@ -4,6 +4,15 @@
 #include <utils/ImageView.h>
 #include <glm/glm.hpp>
 
+// Pipeline variants of the fog, in the order of the material variants
+enum class FogQuality : uint32_t {
+    Low,
+    Medium,
+    High,
+    Ultra,
+    Count
+};
+
 class FogMaterial : public Material
 {
 public:
@@ -21,16 +30,41 @@ public:
         glm::vec4 densityTreshold;
         glm::vec4 phaseParams;
         glm::vec4 fogSpeed;
+        // x: primary steps across the box, y: blue noise slot, z: frame index, w: jitter enabled
+        glm::vec4 raymarchParams;
+        // x: transmittance cutoff, y: empty space step scale, z: empty density, w: minimum light steps
+        glm::vec4 marchParams;
         alignas(16) float fogDensity;
     };
 
+    // Specialization constants of cloud_shader.frag, constant_id in declaration order
+    struct QualityConstants {
+        // most samples taken by a primary ray
+        int32_t nbSamples;
+        // light samples across the box for a fully visible sample
+        float nbLightSamples;
+        // lowest shadow term, keeps the core of the cloud from going black
+        float darknessThreshold;
+    };
+
 public:
-    void createDescriptorBuffer(RenderContext& renderContext, VkBuffer& buffer, VkDeviceMemory& memory) override;
-    void updateDescriptorSet(RenderContext& renderContext, VkDescriptorSet descriptorSet, VkBuffer buffer) override;
+    // Shared with the compute path, which builds the same tiers
+    static std::vector<VkSpecializationMapEntry> qualityEntries();
+    static QualityConstants qualityConstants(uint32_t quality);
+
+    void registerResources(DescriptorTable& descriptorTable) override;
+    const char* name() const override;
     void createTextureSampler(RenderContext& renderContext, const ImageView& imageView);
+    // Offsets the first step of every ray, owned by the scene
+    void setBlueNoise(const ImageView& imageView);
+    uint32_t blueNoiseIndex() const;
+    uint32_t textureIndex() const;
+    uint32_t samplerIndex() const;
     void cleanUp(RenderContext& renderContext) override;
 
 private:
     ImageView m_noiseTexture3D;
+    ImageView m_blueNoiseTexture;
+    uint32_t m_blueNoiseIndex;
     VkSampler m_textureSampler;
 };
@@ -0,0 +1,58 @@
+#include "FogResolve.h"
+
+// Exponential moving average, about the last 10 frames contribute to the history
+static const float currentFrameWeight = 0.1f;
+
+FogResolve::FogResolve(Cube& mesh, FogResolveMaterial& material, CubicFog& fog) :
+    SceneObject(),
+    m_mesh(mesh),
+    m_material(material),
+    m_fog(fog),
+    m_historyValid(false),
+    m_previousViewport(0.0f)
+{
+    m_shaderData.params = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+}
+
+FogResolve::~FogResolve()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+void FogResolve::update(RenderContext& renderContext, Camera& camera, const ViewParams& viewParams, UniformArena& uniformArena)
+{
+    bool useHistory = m_historyValid && viewParams.temporalFog();
+    m_shaderData.worldCamera = m_fog.shaderData()->worldCamera;
+    m_shaderData.params = glm::vec4(static_cast<float>(m_material.historyIndex()), useHistory ? currentFrameWeight : 1.0f, useHistory ? 1.0f : 0.0f, 0.0f);
+    // same fraction of the screen as the viewport of the volumetric pass
+    float divisor = static_cast<float>(viewParams.volumetricDivisor());
+    glm::vec2 viewport = glm::vec2(renderContext.width(), renderContext.height()) / divisor * viewParams.renderScale();
+    m_shaderData.viewport = glm::vec4(viewport, m_historyValid ? m_previousViewport : viewport);
+    m_previousViewport = viewport;
+    // written by this frame, readable by the next one
+    m_historyValid = true;
+
+    m_uniformOffset = uniformArena.push(m_shaderData);
+}
+
+void FogResolve::resetHistory()
+{
+    m_historyValid = false;
+}
+
+bool FogResolve::hasShaderData() const
+{
+    return true;
+}
+
+Mesh* FogResolve::getMesh()
+{
+    return &m_mesh;
+}
+
+Material* FogResolve::getMaterial()
+{
+    return &m_material;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <utils/Cube.h>
+#include "SceneObject.h"
+#include "CubicFog.h"
+#include "FogResolveMaterial.h"
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+// Draw the fog box in the resolve pass, covers the same pixels as the raymarch
+class FogResolve : public SceneObject
+{
+public:
+    FogResolve(Cube& mesh, FogResolveMaterial& material, CubicFog& fog);
+    ~FogResolve();
+
+public:
+    void update(RenderContext& renderContex, Camera& camera, const ViewParams& viewParams, UniformArena& uniformArena) override;
+    bool hasShaderData() const override;
+    Mesh* getMesh() override;
+    Material* getMaterial() override;
+    // The history images were recreated, their content can't be reprojected
+    void resetHistory();
+
+private:
+    Cube& m_mesh;
+    FogResolveMaterial& m_material;
+    CubicFog& m_fog;
+    FogResolveMaterial::ResolveData m_shaderData;
+    bool m_historyValid;
+    glm::vec2 m_previousViewport;
+};
@@ -0,0 +1,69 @@
+#include "FogResolveMaterial.h"
+#include <core/DescriptorTable.h>
+
+FogResolveMaterial::FogResolveMaterial(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader):
+    Material(device, vertexShader, fragmentShader, MaterialPass::Resolve),
+    m_textureSampler(VK_NULL_HANDLE),
+    m_historyIndex(0)
+{
+    // same coverage as the fog, the back faces
+    setCullMode(VK_CULL_MODE_FRONT_BIT);
+}
+
+FogResolveMaterial::~FogResolveMaterial()
+{
+
+}
+
+void FogResolveMaterial::createTextureSampler(RenderContext& renderContext)
+{
+    // the reprojected position falls between texels
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy = 1.0f;
+    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(renderContext.device(), &samplerInfo, nullptr, &m_textureSampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create texture sampler!");
+    }
+}
+
+const char* FogResolveMaterial::name() const
+{
+    return "Fog resolve";
+}
+
+void FogResolveMaterial::registerResources(DescriptorTable& descriptorTable)
+{
+    m_samplerIndex = descriptorTable.addSampler(m_textureSampler);
+}
+
+void FogResolveMaterial::setTargetIndices(uint32_t currentIndex, uint32_t historyIndex)
+{
+    m_textureIndex = currentIndex;
+    m_historyIndex = historyIndex;
+}
+
+uint32_t FogResolveMaterial::historyIndex() const
+{
+    return m_historyIndex;
+}
+
+void FogResolveMaterial::cleanUp(RenderContext& renderContext)
+{
+    Material::cleanUp(renderContext);
+    vkDestroySampler(renderContext.device(), m_textureSampler, nullptr);
+}
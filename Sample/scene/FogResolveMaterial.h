@@ -0,0 +1,37 @@
+#pragma once
+
+#include <utils/Material.h>
+#include <glm/glm.hpp>
+
+/*
+    Temporal resolve of the fog, blends the raymarch of the frame with the reprojected history
+    at the reduced resolution. The history is read with a bilinear sampler
+*/
+class FogResolveMaterial : public Material
+{
+public:
+    FogResolveMaterial(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader);
+    ~FogResolveMaterial();
+
+public:
+    struct ResolveData {
+        glm::vec4 worldCamera;
+        // x: history slot, y: weight of the current frame, z: history valid, w: unused
+        glm::vec4 params;
+        // xy: texels covered by the fog this frame, zw: last frame, the render scale can change in between
+        glm::vec4 viewport;
+    };
+
+public:
+    void registerResources(DescriptorTable& descriptorTable) override;
+    const char* name() const override;
+    void createTextureSampler(RenderContext& renderContext);
+    // Slots of the raw fog target and of the history written last frame
+    void setTargetIndices(uint32_t currentIndex, uint32_t historyIndex);
+    uint32_t historyIndex() const;
+    void cleanUp(RenderContext& renderContext) override;
+
+private:
+    VkSampler m_textureSampler;
+    uint32_t m_historyIndex;
+};
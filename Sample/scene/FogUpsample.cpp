@@ -0,0 +1,56 @@
+#include "FogUpsample.h"
+
+#include <cmath>
+
+// distance difference in box units where a low resolution tap loses most of its weight
+static const float depthSigma = 0.05f;
+
+FogUpsample::FogUpsample(Cube& mesh, FogUpsampleMaterial& material, CubicFog& fog) :
+    SceneObject(),
+    m_mesh(mesh),
+    m_material(material),
+    m_fog(fog)
+{
+    m_shaderData.params = glm::vec4(2.0f, depthSigma, 0.0f, 0.0f);
+}
+
+FogUpsample::~FogUpsample()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+/*
+    Updated after the fog, the full resolution entry distance is recomputed with the same
+    camera and box so it matches the one stored in the volumetric target
+*/
+void FogUpsample::update(RenderContext& renderContext, Camera& camera, const ViewParams& viewParams, UniformArena& uniformArena)
+{
+    const FogMaterial::CloudData* cloudData = m_fog.shaderData();
+    m_shaderData.worldCamera = cloudData->worldCamera;
+    m_shaderData.bboxMin = cloudData->bboxMin;
+    m_shaderData.bboxMax = cloudData->bboxMax;
+    // screen pixels per texel, the dynamic resolution only renders a corner of the target
+    float divisor = static_cast<float>(viewParams.volumetricDivisor()) / viewParams.renderScale();
+    m_shaderData.params.x = divisor;
+    m_shaderData.params.z = std::ceil(renderContext.width() / divisor);
+    m_shaderData.params.w = std::ceil(renderContext.height() / divisor);
+
+    m_uniformOffset = uniformArena.push(m_shaderData);
+}
+
+bool FogUpsample::hasShaderData() const
+{
+    return true;
+}
+
+Mesh* FogUpsample::getMesh()
+{
+    return &m_mesh;
+}
+
+Material* FogUpsample::getMaterial()
+{
+    return &m_material;
+}
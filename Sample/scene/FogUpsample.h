@@ -0,0 +1,29 @@
+#pragma once
+
+#include <utils/Cube.h>
+#include "SceneObject.h"
+#include "CubicFog.h"
+#include "FogUpsampleMaterial.h"
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+// Draw the fog box a second time in the main pass to upsample the volumetric target
+class FogUpsample : public SceneObject
+{
+public:
+    FogUpsample(Cube& mesh, FogUpsampleMaterial& material, CubicFog& fog);
+    ~FogUpsample();
+
+public:
+    void update(RenderContext& renderContex, Camera& camera, const ViewParams& viewParams, UniformArena& uniformArena) override;
+    bool hasShaderData() const override;
+    Mesh* getMesh() override;
+    Material* getMaterial() override;
+
+private:
+    Cube& m_mesh;
+    FogUpsampleMaterial& m_material;
+    CubicFog& m_fog;
+    FogUpsampleMaterial::UpsampleData m_shaderData;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <utils/Material.h>
+#include <glm/glm.hpp>
+
+/*
+    Composite the reduced resolution fog into the main pass, the volumetric target is
+    read with texelFetch and filtered in the shader
+*/
+class FogUpsampleMaterial : public Material
+{
+public:
+    FogUpsampleMaterial(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader);
+    ~FogUpsampleMaterial();
+
+public:
+    struct UpsampleData {
+        glm::vec4 worldCamera;
+        glm::vec4 bboxMin;
+        glm::vec4 bboxMax;
+        // x: screen pixels per texel, y: depth sigma of the bilateral weight, zw: texels rendered this frame
+        glm::vec4 params;
+    };
+
+public:
+    void registerResources(DescriptorTable& descriptorTable) override;
+    const char* name() const override;
+    void createTextureSampler(RenderContext& renderContext);
+    // Slot of the resolved fog history written this frame
+    void setTargetIndex(uint32_t textureIndex);
+    void cleanUp(RenderContext& renderContext) override;
+
+private:
+    VkSampler m_textureSampler;
+};
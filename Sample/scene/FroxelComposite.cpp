@@ -0,0 +1,47 @@
+#include "FroxelComposite.h"
+#include "FroxelFog.h"
+
+FroxelComposite::FroxelComposite(Cube& mesh, FroxelCompositeMaterial& material, CubicFog& fog) :
+    SceneObject(),
+    m_mesh(mesh),
+    m_material(material),
+    m_fog(fog)
+{
+
+}
+
+FroxelComposite::~FroxelComposite()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+// Updated after the fog, the slices are placed like the ones of the froxel passes
+void FroxelComposite::update(RenderContext& renderContext, Camera& camera, const ViewParams& viewParams, UniformArena& uniformArena)
+{
+    const FogMaterial::CloudData* cloudData = m_fog.shaderData();
+    glm::vec2 range = FroxelFog::sliceRange(*cloudData);
+    m_shaderData.worldCamera = cloudData->worldCamera;
+    m_shaderData.bboxMin = cloudData->bboxMin;
+    m_shaderData.bboxMax = cloudData->bboxMax;
+    m_shaderData.depthRange = glm::vec4(range, FroxelFog::gridDepth, 0.0f);
+    m_shaderData.screen = glm::vec4(renderContext.width(), renderContext.height(), 0.0f, 0.0f);
+
+    m_uniformOffset = uniformArena.push(m_shaderData);
+}
+
+bool FroxelComposite::hasShaderData() const
+{
+    return true;
+}
+
+Mesh* FroxelComposite::getMesh()
+{
+    return &m_mesh;
+}
+
+Material* FroxelComposite::getMaterial()
+{
+    return &m_material;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <utils/Cube.h>
+#include "SceneObject.h"
+#include "CubicFog.h"
+#include "FroxelCompositeMaterial.h"
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+// Draw the fog box in the main pass to shade it from the froxel volume
+class FroxelComposite : public SceneObject
+{
+public:
+    FroxelComposite(Cube& mesh, FroxelCompositeMaterial& material, CubicFog& fog);
+    ~FroxelComposite();
+
+public:
+    void update(RenderContext& renderContex, Camera& camera, const ViewParams& viewParams, UniformArena& uniformArena) override;
+    bool hasShaderData() const override;
+    Mesh* getMesh() override;
+    Material* getMaterial() override;
+
+private:
+    Cube& m_mesh;
+    FroxelCompositeMaterial& m_material;
+    CubicFog& m_fog;
+    FroxelCompositeMaterial::CompositeData m_shaderData;
+};
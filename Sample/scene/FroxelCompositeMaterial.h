@@ -0,0 +1,37 @@
+#pragma once
+
+#include <utils/Material.h>
+#include <glm/glm.hpp>
+
+/*
+    Shade the froxel fog in the main pass, one filtered fetch of the integrated volume
+    where the ray leaves the box
+*/
+class FroxelCompositeMaterial : public Material
+{
+public:
+    FroxelCompositeMaterial(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader);
+    ~FroxelCompositeMaterial();
+
+public:
+    struct CompositeData {
+        glm::vec4 worldCamera;
+        glm::vec4 bboxMin;
+        glm::vec4 bboxMax;
+        // x: first slice distance, y: last slice distance, z: slice count
+        glm::vec4 depthRange;
+        // xy: screen size in pixels
+        glm::vec4 screen;
+    };
+
+public:
+    void registerResources(DescriptorTable& descriptorTable) override;
+    const char* name() const override;
+    void createTextureSampler(RenderContext& renderContext);
+    // 3D slot of the integrated volume
+    void setVolumeIndex(uint32_t textureIndex);
+    void cleanUp(RenderContext& renderContext) override;
+
+private:
+    VkSampler m_textureSampler;
+};
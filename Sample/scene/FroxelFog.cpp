@@ -0,0 +1,128 @@
+#include "FroxelFog.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// thinnest slice range, when the camera is on a face of a flat box
+static const float minSliceRange = 1e-3f;
+
+FroxelFog::FroxelFog(VkShaderModule injectShader, VkShaderModule integrateShader, CubicFog& fog, FogMaterial& material):
+    m_injectShader(injectShader),
+    m_integrateShader(integrateShader),
+    m_fog(fog),
+    m_material(material),
+    m_injectPipeline(VK_NULL_HANDLE),
+    m_integratePipeline(VK_NULL_HANDLE),
+    m_pipelineLayout(VK_NULL_HANDLE),
+    m_uniformOffset(0),
+    m_scatteringIndex(0),
+    m_integratedIndex(0)
+{
+    static_assert(sizeof(FogMaterial::CloudData) % 16 == 0, "the froxel data is read as vec4 after the cloud data");
+}
+
+FroxelFog::~FroxelFog()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+glm::vec2 FroxelFog::sliceRange(const FogMaterial::CloudData& cloudData)
+{
+    glm::vec3 camera = glm::vec3(cloudData.worldCamera);
+    glm::vec3 bboxMin = glm::vec3(cloudData.bboxMin);
+    glm::vec3 bboxMax = glm::vec3(cloudData.bboxMax);
+
+    // 0 inside the box
+    float nearDistance = glm::length(glm::max(glm::max(bboxMin - camera, camera - bboxMax), glm::vec3(0.0f)));
+    float farDistance = glm::length(glm::max(glm::abs(bboxMin - camera), glm::abs(bboxMax - camera)));
+    return glm::vec2(nearDistance, std::max(farDistance, nearDistance + minSliceRange));
+}
+
+void FroxelFog::createPipelines(RenderContext& renderContext, VkPipelineLayout pipelineLayout)
+{
+    m_pipelineLayout = pipelineLayout;
+    m_injectPipeline = createPipeline(renderContext, m_injectShader);
+    m_integratePipeline = createPipeline(renderContext, m_integrateShader);
+}
+
+void FroxelFog::destroyPipelines(RenderContext& renderContext)
+{
+    vkDestroyPipeline(renderContext.device(), m_injectPipeline, nullptr);
+    vkDestroyPipeline(renderContext.device(), m_integratePipeline, nullptr);
+    m_injectPipeline = VK_NULL_HANDLE;
+    m_integratePipeline = VK_NULL_HANDLE;
+}
+
+/*
+    The light march of the froxels uses the light samples of the fog quality, their
+    count doesn't change the cost of the shading
+*/
+void FroxelFog::update(const glm::mat4& viewProj, UniformArena& uniformArena)
+{
+    const FogMaterial::CloudData* cloudData = m_fog.shaderData();
+    FogMaterial::QualityConstants quality = FogMaterial::qualityConstants(m_material.variant());
+    glm::vec2 range = sliceRange(*cloudData);
+
+    m_shaderData.cloud = *cloudData;
+    m_shaderData.inverseViewProj = glm::inverse(viewProj);
+    m_shaderData.grid = glm::vec4(gridWidth, gridHeight, gridDepth, (range.y - range.x) / gridDepth);
+    m_shaderData.depthRange = glm::vec4(range, quality.nbLightSamples, quality.darknessThreshold);
+    m_uniformOffset = uniformArena.push(m_shaderData);
+}
+
+void FroxelFog::setTargetIndices(uint32_t scatteringIndex, uint32_t integratedIndex)
+{
+    m_scatteringIndex = scatteringIndex;
+    m_integratedIndex = integratedIndex;
+}
+
+void FroxelFog::dispatchInject(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_injectPipeline);
+    descriptorTable.bindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+    // the noise textures of the fog material, the output is a storage image slot
+    DrawConstants drawConstants{ m_uniformOffset / 16, m_material.textureIndex(), m_material.samplerIndex(), m_scatteringIndex };
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DrawConstants), &drawConstants);
+    vkCmdDispatch(commandBuffer, (gridWidth + groupSize - 1) / groupSize, (gridHeight + groupSize - 1) / groupSize, gridDepth);
+}
+
+void FroxelFog::dispatchIntegrate(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_integratePipeline);
+    descriptorTable.bindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+    // both volumes are storage slots, one thread walks a whole column
+    DrawConstants drawConstants{ m_uniformOffset / 16, m_scatteringIndex, 0, m_integratedIndex };
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DrawConstants), &drawConstants);
+    vkCmdDispatch(commandBuffer, (gridWidth + groupSize - 1) / groupSize, (gridHeight + groupSize - 1) / groupSize, 1);
+}
+
+void FroxelFog::cleanUp(RenderContext& renderContext)
+{
+    vkDestroyShaderModule(renderContext.device(), m_injectShader, nullptr);
+    vkDestroyShaderModule(renderContext.device(), m_integrateShader, nullptr);
+}
+
+/* -------------------------- Private methods -------------------------- */
+
+VkPipeline FroxelFog::createPipeline(RenderContext& renderContext, VkShaderModule shader)
+{
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shader;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_pipelineLayout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    pipelineInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateComputePipelines(renderContext.device(), renderContext.pipelineCache(), 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create froxel fog pipeline!");
+    }
+    return pipeline;
+}
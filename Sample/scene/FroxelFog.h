@@ -0,0 +1,70 @@
+#pragma once
+
+#include "CubicFog.h"
+#include "FogMaterial.h"
+
+#include <core/DescriptorTable.h>
+#include <ui/ViewParams.h>
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+/*
+    Fog in a 3D grid aligned on the camera frustum. The inject pass fills every froxel with the
+    scattered light and the extinction of the noise volume, the integrate pass accumulates them
+    front to back along each column. Shading the fog is then one 3D fetch per pixel, the cost
+    follows the grid and not the screen resolution.
+*/
+class FroxelFog
+{
+public:
+    static constexpr uint32_t gridWidth = 160;
+    static constexpr uint32_t gridHeight = 90;
+    static constexpr uint32_t gridDepth = 64;
+    static constexpr VkFormat gridFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr uint32_t groupSize = 8;
+
+    // Same layout as FroxelData in froxel_inject.comp and froxel_integrate.comp
+    struct FroxelData {
+        FogMaterial::CloudData cloud;
+        // froxel column to the space of the fog box
+        glm::mat4 inverseViewProj;
+        // xyz: froxel count, w: slice length
+        glm::vec4 grid;
+        // x: first slice distance, y: last slice distance, z: light samples, w: darkness threshold
+        glm::vec4 depthRange;
+    };
+
+public:
+    FroxelFog(VkShaderModule injectShader, VkShaderModule integrateShader, CubicFog& fog, FogMaterial& material);
+    ~FroxelFog();
+
+public:
+    // Slices cover the box only, from its closest point to its farthest corner
+    static glm::vec2 sliceRange(const FogMaterial::CloudData& cloudData);
+
+    void createPipelines(RenderContext& renderContext, VkPipelineLayout pipelineLayout);
+    void destroyPipelines(RenderContext& renderContext);
+    // After the fog update, viewProj goes from the box space to clip space
+    void update(const glm::mat4& viewProj, UniformArena& uniformArena);
+    // Storage slots of the two volumes
+    void setTargetIndices(uint32_t scatteringIndex, uint32_t integratedIndex);
+    void dispatchInject(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable);
+    void dispatchIntegrate(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable);
+    void cleanUp(RenderContext& renderContext);
+
+private:
+    VkPipeline createPipeline(RenderContext& renderContext, VkShaderModule shader);
+
+private:
+    VkShaderModule m_injectShader;
+    VkShaderModule m_integrateShader;
+    CubicFog& m_fog;
+    FogMaterial& m_material;
+    VkPipeline m_injectPipeline;
+    VkPipeline m_integratePipeline;
+    VkPipelineLayout m_pipelineLayout;
+    FroxelData m_shaderData;
+    uint32_t m_uniformOffset;
+    uint32_t m_scatteringIndex;
+    uint32_t m_integratedIndex;
+};
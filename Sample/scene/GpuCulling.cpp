@@ -0,0 +1,302 @@
+#include "GpuCulling.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+GpuCulling::GpuCulling(VkShaderModule cullShader):
+    m_cullShader(cullShader),
+    m_pipelineLayout(VK_NULL_HANDLE),
+    m_objectCount(0),
+    m_instanceCount(0),
+    m_instanceCullCount(0),
+    m_bucketCount(0),
+    m_uniformOffset(0),
+    m_stagingBuffer(VK_NULL_HANDLE),
+    m_objectBuffer(VK_NULL_HANDLE),
+    m_objectBufferMemory(VK_NULL_HANDLE),
+    m_instanceCountBuffer(VK_NULL_HANDLE),
+    m_instanceCountBufferMemory(VK_NULL_HANDLE),
+    m_commandBuffer(VK_NULL_HANDLE),
+    m_commandBufferMemory(VK_NULL_HANDLE),
+    m_countBuffer(VK_NULL_HANDLE),
+    m_countBufferMemory(VK_NULL_HANDLE),
+    m_drawSlotBuffer(VK_NULL_HANDLE),
+    m_drawSlotBufferMemory(VK_NULL_HANDLE),
+    m_visibleInstanceBuffer(VK_NULL_HANDLE),
+    m_visibleInstanceBufferMemory(VK_NULL_HANDLE),
+    m_objectIndex(0),
+    m_instanceCountIndex(0),
+    m_commandIndex(0),
+    m_countIndex(0),
+    m_drawSlotIndex(0),
+    m_visibleInstanceIndex(0)
+{
+    static_assert(sizeof(CullObject) % 16 == 0, "the cull objects are read as vec4");
+}
+
+GpuCulling::~GpuCulling()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+// Alignment of the allocation, the header, then at most one instance cull, bucket, draw and staged object per object
+VkDeviceSize GpuCulling::uniformSize(uint32_t objectCount)
+{
+    VkDeviceSize headerSize = sizeof(glm::mat4) + 3 * sizeof(glm::uvec4);
+    VkDeviceSize drawSize = sizeof(glm::uvec4) * ((objectCount + 3) / 4);
+    return 256 + headerSize + (2 * sizeof(glm::uvec4) + sizeof(CullObject)) * objectCount + drawSize;
+}
+
+void GpuCulling::createBuffers(RenderContext& renderContext, uint32_t objectCount, uint32_t instanceCount)
+{
+    m_objectCount = objectCount;
+    m_instanceCount = instanceCount;
+    // the objects are only written by the copies of the updated ones, the other buffers by the cull steps.
+    // A bucket holds at least one draw, the bucket counts fit in objectCount and the counts of every command follow them
+    VkDeviceSize objectCapacity = std::max(objectCount, 1u);
+    VkBufferUsageFlags indirectUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    renderContext.createBuffer(sizeof(CullObject) * objectCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        m_objectBuffer, m_objectBufferMemory);
+    renderContext.createBuffer(sizeof(uint32_t) * objectCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_instanceCountBuffer, m_instanceCountBufferMemory);
+    renderContext.createBuffer(commandStride * objectCapacity, indirectUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_commandBuffer, m_commandBufferMemory);
+    renderContext.createBuffer(2 * sizeof(uint32_t) * objectCapacity, indirectUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_countBuffer, m_countBufferMemory);
+    renderContext.createBuffer(sizeof(uint32_t) * objectCapacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_drawSlotBuffer, m_drawSlotBufferMemory);
+    renderContext.createBuffer(sizeof(uint32_t) * std::max(instanceCount, 1u), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        m_visibleInstanceBuffer, m_visibleInstanceBufferMemory);
+}
+
+void GpuCulling::registerBuffers(DescriptorTable& descriptorTable)
+{
+    VkDeviceSize objectCapacity = std::max(m_objectCount, 1u);
+    m_objectIndex = descriptorTable.addStorageBuffer(m_objectBuffer, sizeof(CullObject) * objectCapacity);
+    m_instanceCountIndex = descriptorTable.addStorageBuffer(m_instanceCountBuffer, sizeof(uint32_t) * objectCapacity);
+    m_commandIndex = descriptorTable.addStorageBuffer(m_commandBuffer, commandStride * objectCapacity);
+    m_countIndex = descriptorTable.addStorageBuffer(m_countBuffer, 2 * sizeof(uint32_t) * objectCapacity);
+    m_drawSlotIndex = descriptorTable.addStorageBuffer(m_drawSlotBuffer, sizeof(uint32_t) * objectCapacity);
+    m_visibleInstanceIndex = descriptorTable.addStorageBuffer(m_visibleInstanceBuffer, sizeof(uint32_t) * std::max(m_instanceCount, 1u));
+}
+
+// The step is the first specialization constant of the shader
+void GpuCulling::createPipelines(RenderContext& renderContext, VkPipelineLayout pipelineLayout)
+{
+    m_pipelineLayout = pipelineLayout;
+
+    VkSpecializationMapEntry entry{ 0, 0, sizeof(uint32_t) };
+    std::vector<uint32_t> steps(StepCount);
+    std::vector<VkSpecializationInfo> specializationInfos(StepCount);
+    std::vector<VkComputePipelineCreateInfo> pipelineInfos(StepCount);
+
+    for (uint32_t step = 0; step < StepCount; step++) {
+        steps[step] = step;
+        specializationInfos[step].mapEntryCount = 1;
+        specializationInfos[step].pMapEntries = &entry;
+        specializationInfos[step].dataSize = sizeof(uint32_t);
+        specializationInfos[step].pData = &steps[step];
+
+        VkComputePipelineCreateInfo& pipelineInfo = pipelineInfos[step];
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = m_cullShader;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.stage.pSpecializationInfo = &specializationInfos[step];
+        pipelineInfo.layout = m_pipelineLayout;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+        pipelineInfo.basePipelineIndex = -1;
+    }
+
+    m_pipelines.resize(StepCount, VK_NULL_HANDLE);
+    if (vkCreateComputePipelines(renderContext.device(), renderContext.pipelineCache(), StepCount, pipelineInfos.data(), nullptr, m_pipelines.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create culling pipeline!");
+    }
+}
+
+void GpuCulling::destroyPipelines(RenderContext& renderContext)
+{
+    for (auto pipeline : m_pipelines) {
+        vkDestroyPipeline(renderContext.device(), pipeline, nullptr);
+    }
+    m_pipelines.clear();
+}
+
+/*
+    One allocation per frame: the view projection, the counts, the storage slots, the instance
+    culls, the buckets, the object of every draw packed 4 per vec4, then the updated objects the
+    copies read. Consecutive updated objects are copied together
+*/
+void GpuCulling::update(const glm::mat4& viewProj, const std::vector<CullObject>& objects, const std::vector<uint32_t>& updatedObjects,
+    const std::vector<glm::uvec4>& instanceCulls, const std::vector<DrawList::Entry>& draws, const std::vector<DrawBucket>& buckets, UniformArena& uniformArena)
+{
+    if (objects.size() != m_objectCount) {
+        throw std::runtime_error("failed to update culling, the object count changed!");
+    }
+
+    m_instanceCullCount = static_cast<uint32_t>(instanceCulls.size());
+    m_bucketCount = static_cast<uint32_t>(buckets.size());
+    size_t headerSize = sizeof(viewProj) + 3 * sizeof(glm::uvec4);
+    size_t cullSize = sizeof(glm::uvec4) * instanceCulls.size();
+    size_t bucketSize = sizeof(glm::uvec4) * buckets.size();
+    size_t drawSize = sizeof(glm::uvec4) * ((draws.size() + 3) / 4);
+    size_t stagingOffset = headerSize + cullSize + bucketSize + drawSize;
+
+    void* data;
+    m_uniformOffset = uniformArena.allocate(stagingOffset + sizeof(CullObject) * updatedObjects.size(), &data);
+    unsigned char* bytes = static_cast<unsigned char*>(data);
+    glm::uvec4 header[3] = {
+        glm::uvec4(m_objectCount, m_instanceCullCount, m_bucketCount, 0),
+        glm::uvec4(m_objectIndex, m_instanceCountIndex, m_visibleInstanceIndex, m_drawSlotIndex),
+        glm::uvec4(m_commandIndex, m_countIndex, 0, 0)
+    };
+    memcpy(bytes, &viewProj, sizeof(viewProj));
+    memcpy(bytes + sizeof(viewProj), header, sizeof(header));
+    memcpy(bytes + headerSize, instanceCulls.data(), cullSize);
+
+    glm::uvec4* bucketData = reinterpret_cast<glm::uvec4*>(bytes + headerSize + cullSize);
+    for (size_t bucket = 0; bucket < buckets.size(); bucket++) {
+        bucketData[bucket] = glm::uvec4(buckets[bucket].firstDraw, buckets[bucket].drawCount, 0, 0);
+    }
+    uint32_t* drawData = reinterpret_cast<uint32_t*>(bytes + headerSize + cullSize + bucketSize);
+    for (size_t draw = 0; draw < draws.size(); draw++) {
+        drawData[draw] = draws[draw].objectIndex;
+    }
+
+    m_stagingBuffer = uniformArena.buffer();
+    m_objectCopies.clear();
+    CullObject* staged = reinterpret_cast<CullObject*>(bytes + stagingOffset);
+    for (size_t i = 0; i < updatedObjects.size(); i++) {
+        uint32_t object = updatedObjects[i];
+        staged[i] = objects[object];
+        VkDeviceSize dstOffset = sizeof(CullObject) * object;
+        if (!m_objectCopies.empty() && m_objectCopies.back().dstOffset + m_objectCopies.back().size == dstOffset) {
+            m_objectCopies.back().size += sizeof(CullObject);
+        }
+        else {
+            m_objectCopies.push_back({ m_uniformOffset + stagingOffset + sizeof(CullObject) * i, dstOffset, sizeof(CullObject) });
+        }
+    }
+}
+
+void GpuCulling::uploadObjects(VkCommandBuffer commandBuffer)
+{
+    if (m_objectCopies.empty()) {
+        return;
+    }
+    vkCmdCopyBuffer(commandBuffer, m_stagingBuffer, m_objectBuffer, static_cast<uint32_t>(m_objectCopies.size()), m_objectCopies.data());
+}
+
+// Both steps write different objects, the instance step only gets the instanced ones
+void GpuCulling::dispatch(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable)
+{
+    bindStep(commandBuffer, descriptorTable, ObjectStep);
+    vkCmdDispatch(commandBuffer, (m_objectCount + groupSize - 1) / groupSize, 1, 1);
+    if (m_instanceCullCount > 0) {
+        bindStep(commandBuffer, descriptorTable, InstanceStep);
+        vkCmdDispatch(commandBuffer, m_instanceCullCount, 1, 1);
+    }
+}
+
+void GpuCulling::dispatchCompaction(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable)
+{
+    if (m_bucketCount == 0) {
+        return;
+    }
+    bindStep(commandBuffer, descriptorTable, CompactionStep);
+    vkCmdDispatch(commandBuffer, m_bucketCount, 1, 1);
+}
+
+// The commands of the bucket start at its first draw, they are at most as many as its draws
+void GpuCulling::drawBucket(VkCommandBuffer commandBuffer, uint32_t bucketIndex, const DrawBucket& bucket)
+{
+    vkCmdDrawIndexedIndirectCount(commandBuffer, m_commandBuffer, commandStride * bucket.firstDraw, m_countBuffer, sizeof(uint32_t) * bucketIndex,
+        bucket.drawCount, static_cast<uint32_t>(commandStride));
+}
+
+// The count of the command follows the bucket counts
+void GpuCulling::drawCommand(VkCommandBuffer commandBuffer, uint32_t commandIndex)
+{
+    vkCmdDrawIndexedIndirectCount(commandBuffer, m_commandBuffer, commandStride * commandIndex, m_countBuffer, sizeof(uint32_t) * (m_objectCount + commandIndex),
+        1, static_cast<uint32_t>(commandStride));
+}
+
+void GpuCulling::cleanUp(RenderContext& renderContext)
+{
+    vkDestroyShaderModule(renderContext.device(), m_cullShader, nullptr);
+
+    vkDestroyBuffer(renderContext.device(), m_objectBuffer, nullptr);
+    vkFreeMemory(renderContext.device(), m_objectBufferMemory, nullptr);
+    vkDestroyBuffer(renderContext.device(), m_instanceCountBuffer, nullptr);
+    vkFreeMemory(renderContext.device(), m_instanceCountBufferMemory, nullptr);
+    vkDestroyBuffer(renderContext.device(), m_commandBuffer, nullptr);
+    vkFreeMemory(renderContext.device(), m_commandBufferMemory, nullptr);
+    vkDestroyBuffer(renderContext.device(), m_countBuffer, nullptr);
+    vkFreeMemory(renderContext.device(), m_countBufferMemory, nullptr);
+    vkDestroyBuffer(renderContext.device(), m_drawSlotBuffer, nullptr);
+    vkFreeMemory(renderContext.device(), m_drawSlotBufferMemory, nullptr);
+    vkDestroyBuffer(renderContext.device(), m_visibleInstanceBuffer, nullptr);
+    vkFreeMemory(renderContext.device(), m_visibleInstanceBufferMemory, nullptr);
+    m_objectBuffer = VK_NULL_HANDLE;
+    m_instanceCountBuffer = VK_NULL_HANDLE;
+    m_commandBuffer = VK_NULL_HANDLE;
+    m_countBuffer = VK_NULL_HANDLE;
+    m_drawSlotBuffer = VK_NULL_HANDLE;
+    m_visibleInstanceBuffer = VK_NULL_HANDLE;
+}
+
+VkBuffer GpuCulling::objectBuffer() const
+{
+    return m_objectBuffer;
+}
+
+VkBuffer GpuCulling::instanceCountBuffer() const
+{
+    return m_instanceCountBuffer;
+}
+
+VkBuffer GpuCulling::commandBuffer() const
+{
+    return m_commandBuffer;
+}
+
+VkBuffer GpuCulling::countBuffer() const
+{
+    return m_countBuffer;
+}
+
+VkBuffer GpuCulling::drawSlotBuffer() const
+{
+    return m_drawSlotBuffer;
+}
+
+VkBuffer GpuCulling::visibleInstanceBuffer() const
+{
+    return m_visibleInstanceBuffer;
+}
+
+uint32_t GpuCulling::commandIndex() const
+{
+    return m_commandIndex;
+}
+
+uint32_t GpuCulling::drawSlotIndex() const
+{
+    return m_drawSlotIndex;
+}
+
+uint32_t GpuCulling::visibleInstanceIndex() const
+{
+    return m_visibleInstanceIndex;
+}
+
+/* -------------------------- Private methods -------------------------- */
+
+// The storage slots are in the frame data, only its offset is pushed
+void GpuCulling::bindStep(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable, CullStep step)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[step]);
+    descriptorTable.bindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+    DrawConstants drawConstants{ m_uniformOffset / 16, 0, 0, 0 };
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DrawConstants), &drawConstants);
+}
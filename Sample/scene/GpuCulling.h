@@ -0,0 +1,134 @@
+#pragma once
+
+#include <core/DescriptorTable.h>
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "DrawList.h"
+
+/*
+    Frustum culling of the scene objects on the gpu, in three steps:
+        - the cull objects stay in a device local buffer, only the ones changed since the
+          previous frame are copied from the arena
+        - one thread per object tests its bounds and writes its visible instance count. Instanced
+          objects are culled instance by instance by a workgroup each, their visible instances
+          compacted in draw order in the visible instance list
+        - one workgroup per bucket, a run of draws sharing a material in the draw list, compacts
+          the commands of its visible objects in draw order and writes the draw count of the bucket
+    A bucket is then drawn with a single indirect count call, the first instance of each command
+    is the handle of its object.
+*/
+class GpuCulling
+{
+public:
+    static constexpr uint32_t groupSize = 64;
+    static constexpr VkDeviceSize commandStride = sizeof(VkDrawIndexedIndirectCommand);
+    // draw slot of an object without command this frame
+    static constexpr uint32_t noDrawSlot = ~0u;
+
+    // Same layout as CullObject in scene_cull.comp
+    struct CullObject {
+        // xyz: bounds of the mesh in the space of the model matrix
+        glm::vec4 bboxMin;
+        glm::vec4 bboxMax;
+        // x: index count, y: instance count, 0 hides the object, z: first entry in the visible instance list,
+        // w: 1 when the instances are culled one by one
+        glm::uvec4 draw;
+        // x: storage slot of the instance transforms, y: unused, the draw order comes with every frame,
+        // z: first index of the level of detail drawn, w: vertex offset of the mesh, both in the geometry arena
+        glm::uvec4 instances;
+    };
+
+    // A run of draws sharing a material in the draw list, its commands take the same range
+    struct DrawBucket {
+        uint32_t firstDraw;
+        uint32_t drawCount;
+    };
+
+public:
+    GpuCulling(VkShaderModule cullShader);
+    ~GpuCulling();
+
+public:
+    // Arena space of a frame where every object changed
+    static VkDeviceSize uniformSize(uint32_t objectCount);
+
+    // Objects, commands and draw counts for every object. instanceCount sizes the visible instance list,
+    // the sum of the ranges of the objects culled instance by instance
+    void createBuffers(RenderContext& renderContext, uint32_t objectCount, uint32_t instanceCount);
+    // After the descriptor sets, the steps read and write the buffers through the storage buffer array
+    void registerBuffers(DescriptorTable& descriptorTable);
+    // One pipeline per step, from the same shader
+    void createPipelines(RenderContext& renderContext, VkPipelineLayout pipelineLayout);
+    void destroyPipelines(RenderContext& renderContext);
+    // The objects follow the scene order, only the updated ones are copied. viewProj goes from the model space to clip space.
+    // instanceCulls x: object culled instance by instance, y: vec4 index of its draw order in the arena.
+    // draws is the sorted draw list, cut in buckets
+    void update(const glm::mat4& viewProj, const std::vector<CullObject>& objects, const std::vector<uint32_t>& updatedObjects,
+        const std::vector<glm::uvec4>& instanceCulls, const std::vector<DrawList::Entry>& draws, const std::vector<DrawBucket>& buckets, UniformArena& uniformArena);
+    // Copies the updated objects to the device local buffer
+    void uploadObjects(VkCommandBuffer commandBuffer);
+    // Writes the visible instance count of every object and the visible instances of the instanced ones
+    void dispatch(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable);
+    // Writes the commands and the draw count of every bucket, after dispatch
+    void dispatchCompaction(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable);
+    // Draws the visible objects of the bucket, bucketIndex is its place in the buckets of the frame
+    void drawBucket(VkCommandBuffer commandBuffer, uint32_t bucketIndex, const DrawBucket& bucket);
+    // Debug only, a single command of a bucket, nothing when it is past the draw count of the bucket
+    void drawCommand(VkCommandBuffer commandBuffer, uint32_t commandIndex);
+    void cleanUp(RenderContext& renderContext);
+
+    VkBuffer objectBuffer() const;
+    VkBuffer instanceCountBuffer() const;
+    VkBuffer commandBuffer() const;
+    VkBuffer countBuffer() const;
+    VkBuffer drawSlotBuffer() const;
+    VkBuffer visibleInstanceBuffer() const;
+    uint32_t commandIndex() const;
+    uint32_t drawSlotIndex() const;
+    uint32_t visibleInstanceIndex() const;
+
+private:
+    enum CullStep {
+        ObjectStep,
+        InstanceStep,
+        CompactionStep,
+        StepCount
+    };
+
+    void bindStep(VkCommandBuffer commandBuffer, DescriptorTable& descriptorTable, CullStep step);
+
+private:
+    VkShaderModule m_cullShader;
+    std::vector<VkPipeline> m_pipelines;
+    VkPipelineLayout m_pipelineLayout;
+    uint32_t m_objectCount;
+    uint32_t m_instanceCount;
+    uint32_t m_instanceCullCount;
+    uint32_t m_bucketCount;
+    uint32_t m_uniformOffset;
+    // the updated objects staged in the arena, rebuilt every frame and kept to reuse their storage
+    VkBuffer m_stagingBuffer;
+    std::vector<VkBufferCopy> m_objectCopies;
+
+    VkBuffer m_objectBuffer;
+    VkDeviceMemory m_objectBufferMemory;
+    VkBuffer m_instanceCountBuffer;
+    VkDeviceMemory m_instanceCountBufferMemory;
+    VkBuffer m_commandBuffer;
+    VkDeviceMemory m_commandBufferMemory;
+    VkBuffer m_countBuffer;
+    VkDeviceMemory m_countBufferMemory;
+    VkBuffer m_drawSlotBuffer;
+    VkDeviceMemory m_drawSlotBufferMemory;
+    VkBuffer m_visibleInstanceBuffer;
+    VkDeviceMemory m_visibleInstanceBufferMemory;
+    // storage slots of the objects, the instance counts, the commands, the draw counts, the draw slots and the visible instances
+    uint32_t m_objectIndex;
+    uint32_t m_instanceCountIndex;
+    uint32_t m_commandIndex;
+    uint32_t m_countIndex;
+    uint32_t m_drawSlotIndex;
+    uint32_t m_visibleInstanceIndex;
+};
@@ -17,11 +17,6 @@ QuadTexture::~QuadTexture()
 
 /* -------------------------- Public methods -------------------------- */
 
-void QuadTexture::update(RenderContext& renderContext, Camera& camera, const ViewParams& viewParams, const DescriptorEntry& descriptorEntry)
-{
-
-}
-
 Mesh* QuadTexture::getMesh()
 {
     return &m_mesh;
@@ -16,8 +16,6 @@ public:
     ~QuadTexture();
 
 public:
-    void update(RenderContext& renderContex, Camera& camera, const ViewParams& viewParams, const DescriptorEntry& descriptorEntry) override;
-
     Mesh* getMesh() override;
     Material* getMaterial() override;
 
@@ -3,13 +3,58 @@
 #include "QuadTexture.h"
 
 #include <iostream>
+#include <future>
+#include <thread>
+#include <algorithm>
+#include <unordered_map>
+#include <stdexcept>
 #include <glm/gtx/string_cast.hpp>
 #include <utils/MatrixBuffer.h>
 #include <utils/ShaderLoader.h>
 #include <utils/Quad.h>
 
+// Same binding stride and attributes, the pipelines only depend on those
+static bool sameVertexInput(Mesh& mesh, Mesh& other)
+{
+    if (mesh.getBindingDescription().stride != other.getBindingDescription().stride) {
+        return false;
+    }
+    std::vector<VkVertexInputAttributeDescription> attributes = mesh.getAttributeDescriptions();
+    std::vector<VkVertexInputAttributeDescription> otherAttributes = other.getAttributeDescriptions();
+    return std::equal(attributes.begin(), attributes.end(), otherAttributes.begin(), otherAttributes.end(),
+        [](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b) {
+            return a.location == b.location && a.binding == b.binding && a.format == b.format && a.offset == b.offset;
+        });
+}
+
 RenderScene::RenderScene():
-    m_textureLoader(nullptr)
+    m_textureLoader(nullptr),
+    m_geometryArena(nullptr),
+    m_fogResolveMaterial(nullptr),
+    m_fogUpsampleMaterial(nullptr),
+    m_froxelCompositeMaterial(nullptr),
+    m_fogResolve(nullptr),
+    m_fogUpsample(nullptr),
+    m_froxelComposite(nullptr),
+    m_cloudField(nullptr),
+    m_cloudFieldMaterial(nullptr),
+    m_fogUpsampleHandle(0),
+    m_froxelCompositeHandle(0),
+    m_cloudFieldHandle(0),
+    m_vikingRoomHandle(0),
+    m_fogCompute(nullptr),
+    m_froxelFog(nullptr),
+    m_gpuCulling(nullptr),
+    m_clusterCulling(nullptr),
+    m_froxelStorageSlots({ 0, 0 }),
+    m_froxelVolumeSlot(0),
+    m_froxelTargetsBound(false),
+    m_fogStorageSlot(0),
+    m_fogStorageBound(false),
+    m_fogTargetSlots({ 0, 0, 0 }),
+    m_fogTargetsBound(false),
+    m_previousViewProj(1.0f),
+    m_hasPreviousFrame(false)
 {
     
 }
@@ -23,20 +68,32 @@ RenderScene::~RenderScene()
 void RenderScene::initialize(RenderContext& renderContext, DescriptorTable& descriptorTable, ViewParams& viewParams)
 {
     m_textureLoader = std::make_unique<TextureLoader>(&renderContext);
+    m_geometryArena = std::make_unique<GeometryArena>(renderContext);
     /* -------------- Init Meshes -------------- */
     glm::mat3 vertexTransfo = glm::mat3(1.0f);
     vertexTransfo[1][1] = 1.0f;
 
+    // the corners and texture coordinates of both are exact once packed
     auto cube = std::make_unique<Cube>(vertexTransfo);
-    cube->createBuffers(renderContext);
+    cube->setVertexLayout(VertexLayout::Packed);
+    cube->createBuffers(*m_geometryArena);
     Cube* cubePtr = cube.get();
 
     auto quad = std::make_unique<Quad>();
-    quad->createBuffers(renderContext);
+    quad->setVertexLayout(VertexLayout::Packed);
+    quad->createBuffers(*m_geometryArena);
     Quad* quadPtr = quad.get();
 
+    // parsed, optimized, simplified and split in meshlets on the first run, read back from its cache afterwards
+    auto vikingRoom = std::make_unique<SkinMesh>();
+    vikingRoom->load("ressources/models/viking_room.obj");
+    vikingRoom->setVertexLayout(VertexLayout::Packed);
+    vikingRoom->createBuffers(*m_geometryArena);
+    SkinMesh* vikingRoomPtr = vikingRoom.get();
+
     m_meshes.push_back(std::move(cube));
     m_meshes.push_back(std::move(quad));
+    m_meshes.push_back(std::move(vikingRoom));
 
     /* -------------- Textures -------------- */
     VkExtent2D dimension = VkExtent2D({ 512, 512 });
@@ -44,7 +101,8 @@ void RenderScene::initialize(RenderContext& renderContext, DescriptorTable& desc
 
     m_cloudTexture = m_textureLoader->load3DCloudTexture(dimension3D, VK_IMAGE_ASPECT_COLOR_BIT, viewParams.noiseSize(), viewParams.randomSeed());
     m_noiseTexture = m_textureLoader->loadWorleyNoiseTexture(dimension, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
-    //m_textures.push_back(m_textureLoader->loadTexture("ressources/textures/viking_room.png", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT));
+    m_blueNoiseTexture = m_textureLoader->loadBlueNoiseTexture(64);
+    m_vikingRoomTexture = m_textureLoader->loadTexture("ressources/textures/viking_room.png", VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
 
     /* -------------- Init Materials -------------- */
     VkShaderModule fogVertexTextureShader = ShaderLoader::loadShader("shaders/cloud_vert.spv", renderContext.device());
@@ -52,6 +110,7 @@ void RenderScene::initialize(RenderContext& renderContext, DescriptorTable& desc
     auto fogMaterial = std::make_unique<FogMaterial>(renderContext.device(), fogVertexTextureShader, fogFragmentTextureShader);
     FogMaterial* fogMaterialPtr = fogMaterial.get();
     fogMaterialPtr->createTextureSampler(renderContext, m_cloudTexture);
+    fogMaterialPtr->setBlueNoise(m_blueNoiseTexture);
 
     VkShaderModule textureVertexTextureShader = ShaderLoader::loadShader("shaders/texture_vert.spv", renderContext.device());
     VkShaderModule textureFragmentTextureShader = ShaderLoader::loadShader("shaders/texture_frag.spv", renderContext.device());
@@ -59,38 +118,159 @@ void RenderScene::initialize(RenderContext& renderContext, DescriptorTable& desc
     TextureMaterial* quadMaterialPtr = quadMaterial.get();
     quadMaterialPtr->createTextureSampler(renderContext, m_noiseTexture);
 
+    VkShaderModule modelVertexShader = ShaderLoader::loadShader("shaders/texture_vert.spv", renderContext.device());
+    VkShaderModule modelFragmentShader = ShaderLoader::loadShader("shaders/texture_frag.spv", renderContext.device());
+    auto modelMaterial = std::make_unique<TextureMaterial>(renderContext.device(), modelVertexShader, modelFragmentShader, VK_FRONT_FACE_COUNTER_CLOCKWISE);
+    TextureMaterial* modelMaterialPtr = modelMaterial.get();
+    modelMaterialPtr->createTextureSampler(renderContext, m_vikingRoomTexture);
+
+    // Fog history and composite, share the vertex shader of the fog to get the same rays
+    VkShaderModule resolveVertexShader = ShaderLoader::loadShader("shaders/cloud_vert.spv", renderContext.device());
+    VkShaderModule resolveFragmentShader = ShaderLoader::loadShader("shaders/cloud_resolve_frag.spv", renderContext.device());
+    auto resolveMaterial = std::make_unique<FogResolveMaterial>(renderContext.device(), resolveVertexShader, resolveFragmentShader);
+    m_fogResolveMaterial = resolveMaterial.get();
+    m_fogResolveMaterial->createTextureSampler(renderContext);
+
+    VkShaderModule upsampleVertexShader = ShaderLoader::loadShader("shaders/cloud_vert.spv", renderContext.device());
+    VkShaderModule upsampleFragmentShader = ShaderLoader::loadShader("shaders/cloud_upsample_frag.spv", renderContext.device());
+    auto upsampleMaterial = std::make_unique<FogUpsampleMaterial>(renderContext.device(), upsampleVertexShader, upsampleFragmentShader);
+    m_fogUpsampleMaterial = upsampleMaterial.get();
+    m_fogUpsampleMaterial->createTextureSampler(renderContext);
+
+    VkShaderModule froxelVertexShader = ShaderLoader::loadShader("shaders/cloud_vert.spv", renderContext.device());
+    VkShaderModule froxelFragmentShader = ShaderLoader::loadShader("shaders/froxel_composite_frag.spv", renderContext.device());
+    auto froxelMaterial = std::make_unique<FroxelCompositeMaterial>(renderContext.device(), froxelVertexShader, froxelFragmentShader);
+    m_froxelCompositeMaterial = froxelMaterial.get();
+    m_froxelCompositeMaterial->createTextureSampler(renderContext);
+
+    // instanced boxes sampling the noise of the fog, registered after it
+    VkShaderModule fieldVertexShader = ShaderLoader::loadShader("shaders/cloud_field_vert.spv", renderContext.device());
+    VkShaderModule fieldFragmentShader = ShaderLoader::loadShader("shaders/cloud_field_frag.spv", renderContext.device());
+    auto fieldMaterial = std::make_unique<CloudFieldMaterial>(renderContext.device(), fieldVertexShader, fieldFragmentShader, *fogMaterialPtr);
+    m_cloudFieldMaterial = fieldMaterial.get();
+
     m_materials.push_back(std::move(fogMaterial));
     m_materials.push_back(std::move(quadMaterial));
+    m_materials.push_back(std::move(modelMaterial));
+    m_materials.push_back(std::move(resolveMaterial));
+    m_materials.push_back(std::move(upsampleMaterial));
+    m_materials.push_back(std::move(froxelMaterial));
+    m_materials.push_back(std::move(fieldMaterial));
     descriptorTable.addMaterial(fogMaterialPtr);
     descriptorTable.addMaterial(quadMaterialPtr);
+    descriptorTable.addMaterial(modelMaterialPtr);
+    descriptorTable.addMaterial(m_fogResolveMaterial);
+    descriptorTable.addMaterial(m_fogUpsampleMaterial);
+    descriptorTable.addMaterial(m_froxelCompositeMaterial);
+    descriptorTable.addMaterial(m_cloudFieldMaterial);
 
     /* -------------- Init SceneObjects -------------- */
     auto fogObject = std::make_unique<CubicFog>(*cubePtr, *fogMaterialPtr);
+    // after the fog, they read the camera and box the fog computed this frame
+    auto resolveObject = std::make_unique<FogResolve>(*cubePtr, *m_fogResolveMaterial, *fogObject);
+    m_fogResolve = resolveObject.get();
+    auto upsampleObject = std::make_unique<FogUpsample>(*cubePtr, *m_fogUpsampleMaterial, *fogObject);
+    m_fogUpsample = upsampleObject.get();
+    auto froxelObject = std::make_unique<FroxelComposite>(*cubePtr, *m_froxelCompositeMaterial, *fogObject);
+    m_froxelComposite = froxelObject.get();
+    auto fieldObject = std::make_unique<CloudField>(*cubePtr, *m_cloudFieldMaterial, *fogObject, 256, 7);
+    m_cloudField = fieldObject.get();
+    m_cloudField->createInstanceBuffer(renderContext);
+    m_cloudFieldMaterial->setInstanceBuffer(m_cloudField->instanceBuffer(), m_cloudField->instanceBufferSize());
     auto quadObject = std::make_unique<QuadTexture>(*quadPtr, *quadMaterialPtr);
-    m_sceneObjects.push_back(std::move(fogObject));
-    //m_sceneObjects.push_back(std::move(quadObject));
+    // around the fog, it shares its model matrix
+    auto vikingRoomObject = std::make_unique<TexturedModel>(*vikingRoomPtr, *modelMaterialPtr);
+    VkShaderModule fogComputeShader = ShaderLoader::loadShader("shaders/cloud_march_comp.spv", renderContext.device());
+    m_fogCompute = std::make_unique<FogCompute>(fogComputeShader, *fogObject, *fogMaterialPtr);
+    VkShaderModule froxelInjectShader = ShaderLoader::loadShader("shaders/froxel_inject_comp.spv", renderContext.device());
+    VkShaderModule froxelIntegrateShader = ShaderLoader::loadShader("shaders/froxel_integrate_comp.spv", renderContext.device());
+    m_froxelFog = std::make_unique<FroxelFog>(froxelInjectShader, froxelIntegrateShader, *fogObject, *fogMaterialPtr);
+    addSceneObject(std::move(fogObject));
+    addSceneObject(std::move(resolveObject));
+    m_fogUpsampleHandle = addSceneObject(std::move(upsampleObject));
+    m_froxelCompositeHandle = addSceneObject(std::move(froxelObject));
+    m_cloudFieldHandle = addSceneObject(std::move(fieldObject));
+    //addSceneObject(std::move(quadObject));
+    m_vikingRoomHandle = addSceneObject(std::move(vikingRoomObject));
+    // every mesh and cluster range is added
+    m_geometryArena->upload();
+
+    // only the boxes of the cloud field are culled one by one, the visible instance list holds a range per culled object.
+    // The instance slot and the draw order are only known later, they are set again every frame
+    m_sceneStore.setCulledInstances(m_cloudFieldHandle, 0, 0);
+    uint32_t objectCount = static_cast<uint32_t>(m_sceneStore.size());
+    VkShaderModule cullShader = ShaderLoader::loadShader("shaders/scene_cull_comp.spv", renderContext.device());
+    m_gpuCulling = std::make_unique<GpuCulling>(cullShader);
+    m_gpuCulling->createBuffers(renderContext, objectCount, m_sceneStore.visibleInstanceCount());
+    m_cullObjects.resize(m_sceneStore.size());
+    // the culling data and the draw objects grow with the scene, the arena is sized for a frame where every object changed
+    descriptorTable.reserveUniformData(GpuCulling::uniformSize(objectCount) + 256 + sizeof(SceneStore::DrawObject) * objectCount);
+
+    // the large meshes are drawn from their visible meshlets
+    VkShaderModule clusterShader = ShaderLoader::loadShader("shaders/cluster_cull_comp.spv", renderContext.device());
+    m_clusterCulling = std::make_unique<ClusterCulling>(clusterShader);
+    m_clusterCulling->createBuffers(renderContext, m_sceneStore.meshlets());
 }
 
-void RenderScene::createGraphicPipelines(RenderContext& renderContext, VkRenderPass renderPass, DescriptorTable& descriptorTable)
+void RenderScene::createGraphicPipelines(RenderContext& renderContext, VkRenderPass mainRenderPass, VkRenderPass volumetricRenderPass, DescriptorTable& descriptorTable)
 {
-    auto globalDescriptorLayout = descriptorTable.globalDescriptorLayout();
-    for (auto& sceneObject : m_sceneObjects) {
-        auto* material = sceneObject->getMaterial();
-        auto* mesh = sceneObject->getMesh();
-        material->createPipeline(renderContext, renderPass, mesh->getBindingDescription(), mesh->getAttributeDescriptions(), globalDescriptorLayout);
+    auto pipelineLayout = descriptorTable.pipelineLayout();
+
+    // One pipeline per material, several objects can share the same material as long as their meshes
+    // have the same vertex layout, the decode of the packed positions is pushed with each draw
+    std::vector<SceneHandle> pipelineObjects;
+    std::unordered_map<Material*, Mesh*> materialMeshes;
+    for (SceneHandle object = 0; object < m_sceneStore.size(); object++) {
+        auto inserted = materialMeshes.emplace(m_sceneStore.material(object), m_sceneStore.mesh(object));
+        if (inserted.second) {
+            pipelineObjects.push_back(object);
+        }
+        else if (!sameVertexInput(*inserted.first->second, *m_sceneStore.mesh(object))) {
+            throw std::runtime_error("failed to create graphics pipelines, meshes sharing a material have different vertex layouts!");
+        }
+    }
+
+    // Compile on worker threads, the pipeline cache is internally synchronized
+    size_t workerCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), pipelineObjects.size());
+    std::vector<std::future<void>> workers;
+    for (size_t worker = 0; worker < workerCount; worker++) {
+        workers.push_back(std::async(std::launch::async, [&, worker]() {
+            CPU_ZONE("Build pipelines");
+            for (size_t i = worker; i < pipelineObjects.size(); i += workerCount) {
+                auto* material = m_sceneStore.material(pipelineObjects[i]);
+                auto* mesh = m_sceneStore.mesh(pipelineObjects[i]);
+                // the resolve pass writes the same target format as the volumetric one
+                VkRenderPass renderPass = material->pass() == MaterialPass::Main ? mainRenderPass : volumetricRenderPass;
+                material->createPipeline(renderContext, renderPass, *mesh, pipelineLayout);
+            }
+        }));
+    }
+    // the compute paths are independent of the render passes, built meanwhile
+    m_fogCompute->createPipelines(renderContext, pipelineLayout);
+    m_froxelFog->createPipelines(renderContext, pipelineLayout);
+    m_gpuCulling->createPipelines(renderContext, pipelineLayout);
+    m_clusterCulling->createPipeline(renderContext, pipelineLayout);
+
+    // rethrow the first failure
+    for (auto& worker : workers) {
+        worker.get();
     }
 }
 
 void RenderScene::destroyGraphicPipelines(RenderContext& renderContext)
 {
-    for (auto& sceneObject : m_sceneObjects) {
-        auto* material = sceneObject->getMaterial();
+    for (Material* material : m_sceneStore.materials()) {
         material->destroyPipeline(renderContext);
     }
+    m_fogCompute->destroyPipelines(renderContext);
+    m_froxelFog->destroyPipelines(renderContext);
+    m_gpuCulling->destroyPipelines(renderContext);
+    m_clusterCulling->destroyPipeline(renderContext);
 }
 
-void RenderScene::updateUniforms(RenderContext& renderContext, Camera& camera, ViewParams& viewParams, DescriptorTable& descriptorTable, FrameDescriptor& currentDescriptor, DescriptorEntry& golbalDescriptor)
+void RenderScene::updateUniforms(RenderContext& renderContext, Camera& camera, ViewParams& viewParams, DescriptorTable& descriptorTable)
 {
+    CPU_ZONE("RenderScene::updateUniforms");
     static auto startTime = std::chrono::high_resolution_clock::now();
 
     auto currentTime = std::chrono::high_resolution_clock::now();
@@ -104,11 +284,13 @@ void RenderScene::updateUniforms(RenderContext& renderContext, Camera& camera, V
     matrixBuffer.buffer.view = camera.viewMatrix();
     matrixBuffer.buffer.proj = camera.projectionMatrix();
     matrixBuffer.buffer.time = time;
+    glm::mat4 viewProj = matrixBuffer.buffer.proj * matrixBuffer.buffer.view * matrixBuffer.buffer.model;
+    matrixBuffer.buffer.previousViewProj = m_hasPreviousFrame ? m_previousViewProj : viewProj;
+    m_previousViewProj = viewProj;
+    m_hasPreviousFrame = true;
 
-    void* matrixData;
-    vkMapMemory(renderContext.device(), golbalDescriptor.memory, 0, sizeof(MatrixBuffer::BufferData), 0, &matrixData);
-    memcpy(matrixData, &matrixBuffer.buffer, sizeof(MatrixBuffer::BufferData));
-    vkUnmapMemory(renderContext.device(), golbalDescriptor.memory);
+    UniformArena& uniformArena = descriptorTable.uniformArena();
+    descriptorTable.getGlobalDescriptor().dynamicOffset = uniformArena.push(matrixBuffer.buffer);
 
     // ------------------- Textures
 
@@ -120,46 +302,198 @@ void RenderScene::updateUniforms(RenderContext& renderContext, Camera& camera, V
 
     // ------------------ SceneObjects
 
-    for (auto& sceneObject : m_sceneObjects) {
-        auto* material = sceneObject->getMaterial();
-        auto& descriptorEntry = currentDescriptor.getDescriptorEntry(material->materialId());
-        sceneObject->update(renderContext, camera, viewParams, descriptorEntry);
+    FogPath fogPath = viewParams.fogPath();
+    m_sceneStore.setVisible(m_fogUpsampleHandle, fogPath != FogPath::Froxel);
+    m_sceneStore.setVisible(m_froxelCompositeHandle, fogPath == FogPath::Froxel);
+    m_sceneStore.setVisible(m_cloudFieldHandle, viewParams.cloudField());
+    m_sceneStore.setVisible(m_vikingRoomHandle, viewParams.vikingRoom());
+    // only the fog objects have shader data of their own, in scene order the cloud field follows the fog it copies.
+    // Their offset goes back in the store, the draw objects of the whole scene are written after the culling
+    for (SceneHandle object : m_shaderDataObjects) {
+        auto& sceneObject = m_sceneObjects[object];
+        sceneObject->update(renderContext, camera, viewParams, uniformArena);
+        m_sceneStore.setUniformOffset(object, sceneObject->uniformOffset());
+    }
+    // copies the cloud data of the fog updated above
+    if (fogPath == FogPath::Compute) {
+        m_fogCompute->update(renderContext, viewParams, viewProj, uniformArena);
+    }
+    else if (fogPath == FogPath::Froxel) {
+        m_froxelFog->update(viewProj, uniformArena);
     }
+
+    // ------------------ Culling
+
+    // every object is drawn with the model matrix, hidden ones get no instance.
+    // the boxes of the field are tested in the order sorted by its update, alone in the visible list
+    m_sceneStore.setCulledInstances(m_cloudFieldHandle, m_cloudFieldMaterial->instanceBufferIndex(), m_cloudField->drawOrderIndex());
+    m_sceneStore.updateBounds();
+    // the levels of detail follow the projected error of the bounds
+    m_sceneStore.selectLods(matrixBuffer.buffer.view * matrixBuffer.buffer.model, matrixBuffer.buffer.proj[1][1]);
+    // only the objects changed since the previous frame are copied to the gpu
+    m_sceneStore.buildCullObjects(m_cullObjects, m_updatedObjects);
+    m_sceneStore.buildInstanceCulls(m_instanceCulls);
+    m_sceneStore.buildClusterObjects(matrixBuffer.buffer.view * matrixBuffer.buffer.model, m_clusterObjects);
+    m_clusterCulling->update(viewProj, m_clusterObjects, uniformArena);
+
+    // ------------------ Draw order
+
+    // depth of the bounds center, the draws of the three passes are sorted together
+    m_sceneStore.buildDrawList(matrixBuffer.buffer.view * matrixBuffer.buffer.model, m_drawList);
+    // the culling packs the visible draws of every bucket, drawn with one call each
+    buildDrawBuckets();
+    m_gpuCulling->update(viewProj, m_cullObjects, m_updatedObjects, m_instanceCulls, m_drawList.entries(), m_drawBuckets, uniformArena);
+    // the draws find their object through their first instance, in a single block for the frame
+    void* drawObjects;
+    m_drawObjectOffset = uniformArena.allocate(sizeof(SceneStore::DrawObject) * m_sceneStore.size(), &drawObjects);
+    m_sceneStore.buildDrawObjects(static_cast<SceneStore::DrawObject*>(drawObjects));
 }
 
-void RenderScene::fillCommandBuffer(RenderContext& renderContext, VkCommandBuffer cmdBuffer, FrameDescriptor frameDescriptor, VkDescriptorSet globalDescriptor)
+void RenderScene::fillCommandBuffer(RenderContext& renderContext, VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, MaterialPass pass, GpuProfiler* profiler)
 {
-    Mesh* lastMesh = nullptr;
-    Material* currentMaterial = nullptr;
+    // Frame data and bindless arrays, every pipeline share the same layout
+    descriptorTable.bindDescriptorSets(cmdBuffer);
+    // every mesh lives in the arena, the draws only differ by their vertex offset and first index
+    m_geometryArena->bind(cmdBuffer);
+
+    // One indirect count draw per bucket of the pass, timed under the name of its material.
+    // The draws share the push constants of the material, each finds its draw object through its first instance
+    const auto& draws = m_drawList.entries();
+    auto range = m_drawList.passRange(static_cast<uint32_t>(pass));
+    bool drawScopes = profiler && profiler->drawScopes();
+    for (uint32_t bucketIndex = 0; bucketIndex < m_drawBuckets.size(); bucketIndex++) {
+        const GpuCulling::DrawBucket& bucket = m_drawBuckets[bucketIndex];
+        if (bucket.firstDraw < range.first || bucket.firstDraw >= range.second) {
+            continue;
+        }
+        Material* material = m_sceneStore.material(draws[bucket.firstDraw].objectIndex);
+        GpuScope materialScope(profiler, cmdBuffer, material->name(), true);
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material->pipeline());
+        DrawConstants drawConstants = material->drawConstants(m_drawObjectOffset);
+        vkCmdPushConstants(cmdBuffer, descriptorTable.pipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DrawConstants), &drawConstants);
+
+        if (!drawScopes) {
+            m_gpuCulling->drawBucket(cmdBuffer, bucketIndex, bucket);
+            continue;
+        }
+        // debug only, the commands of the bucket one by one, each timed without statistics
+        for (uint32_t draw = 0; draw < bucket.drawCount; draw++) {
+            GpuScope drawScope(profiler, cmdBuffer, "Draw " + std::to_string(draw));
+            m_gpuCulling->drawCommand(cmdBuffer, bucket.firstDraw + draw);
+        }
+    }
+}
+
+void RenderScene::uploadCullObjects(VkCommandBuffer cmdBuffer, GpuProfiler* profiler)
+{
+    GpuScope scope(profiler, cmdBuffer, "Cull objects upload");
+    m_gpuCulling->uploadObjects(cmdBuffer);
+}
+
+void RenderScene::dispatchCulling(VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, GpuProfiler* profiler)
+{
+    GpuScope scope(profiler, cmdBuffer, "Scene culling", true);
+    m_gpuCulling->dispatch(cmdBuffer, descriptorTable);
+}
+
+void RenderScene::dispatchDrawCompaction(VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, GpuProfiler* profiler)
+{
+    GpuScope scope(profiler, cmdBuffer, "Draw compaction", true);
+    m_gpuCulling->dispatchCompaction(cmdBuffer, descriptorTable);
+}
+
+void RenderScene::dispatchClusterCulling(VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, GpuProfiler* profiler)
+{
+    GpuScope scope(profiler, cmdBuffer, "Cluster culling", true);
+    m_clusterCulling->dispatch(cmdBuffer, descriptorTable);
+}
+
+void RenderScene::dispatchFogCompute(VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, GpuProfiler* profiler)
+{
+    GpuScope scope(profiler, cmdBuffer, "Fog compute", true);
+    m_fogCompute->dispatch(cmdBuffer, descriptorTable);
+}
+
+void RenderScene::dispatchFroxelInject(VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, GpuProfiler* profiler)
+{
+    GpuScope scope(profiler, cmdBuffer, "Froxel inject", true);
+    m_froxelFog->dispatchInject(cmdBuffer, descriptorTable);
+}
 
-    for (auto& sceneObject : m_sceneObjects)
-    {
-        //only bind the pipeline if it doesn't match with the already bound one
-        Material* material = sceneObject->getMaterial();
-        if (material != currentMaterial) {
-            currentMaterial = material;
-            vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentMaterial->pipeline());
+void RenderScene::dispatchFroxelIntegrate(VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, GpuProfiler* profiler)
+{
+    GpuScope scope(profiler, cmdBuffer, "Froxel integrate", true);
+    m_froxelFog->dispatchIntegrate(cmdBuffer, descriptorTable);
+}
+
+void RenderScene::setFroxelTargets(DescriptorTable& descriptorTable, VkImageView scatteringView, VkImageView integratedView)
+{
+    // the slots are kept, the views change whenever the graph is rebuilt
+    if (m_froxelTargetsBound) {
+        descriptorTable.updateStorageImage(m_froxelStorageSlots[0], scatteringView);
+        descriptorTable.updateStorageImage(m_froxelStorageSlots[1], integratedView);
+        descriptorTable.updateTexture3D(m_froxelVolumeSlot, integratedView);
+    }
+    else {
+        m_froxelStorageSlots[0] = descriptorTable.addStorageImage(scatteringView);
+        m_froxelStorageSlots[1] = descriptorTable.addStorageImage(integratedView);
+        m_froxelVolumeSlot = descriptorTable.addTexture3D(integratedView);
+        m_froxelTargetsBound = true;
+    }
+    m_froxelFog->setTargetIndices(m_froxelStorageSlots[0], m_froxelStorageSlots[1]);
+    m_froxelCompositeMaterial->setVolumeIndex(m_froxelVolumeSlot);
+}
+
+void RenderScene::setFogTargets(DescriptorTable& descriptorTable, VkImageView currentView, VkImageView historyView0, VkImageView historyView1, VkImageView storageView)
+{
+    // a view without storage usage can't be written in the storage array, the slot waits for the compute path
+    if (storageView != VK_NULL_HANDLE) {
+        if (m_fogStorageBound) {
+            descriptorTable.updateStorageImage(m_fogStorageSlot, storageView);
         }
+        else {
+            m_fogStorageSlot = descriptorTable.addStorageImage(storageView);
+            m_fogStorageBound = true;
+        }
+        m_fogCompute->setTargetIndex(m_fogStorageSlot);
+    }
 
-        //only bind the mesh if it's a different one from last bind
-        if (sceneObject->getMesh() != lastMesh) {
-            Mesh* currentMesh = sceneObject->getMesh();
-            VkBuffer vertexBuffers[] = { currentMesh->vertexBuffer() };
-            VkDeviceSize offsets[] = { 0 };
-            vkCmdBindVertexBuffers(cmdBuffer, 0, 1, vertexBuffers, offsets);
-            vkCmdBindIndexBuffer(cmdBuffer, currentMesh->indexBuffer(), 0, VK_INDEX_TYPE_UINT32);
-            lastMesh = currentMesh;
+    std::array<VkImageView, 3> views = { currentView, historyView0, historyView1 };
+    for (size_t i = 0; i < views.size(); i++) {
+        // the slots are kept, only the views change with the resolution
+        if (m_fogTargetsBound) {
+            descriptorTable.updateTexture2D(m_fogTargetSlots[i], views[i]);
+        }
+        else {
+            m_fogTargetSlots[i] = descriptorTable.addTexture2D(views[i]);
         }
+    }
+    m_fogTargetsBound = true;
+    m_fogResolve->resetHistory();
+}
 
-        // Global Matrix Buffer
-        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, sceneObject->getMaterial()->pipelineLayout(), 0, 1, &globalDescriptor, 0, nullptr);
-        // Material Descriptor
-        VkDescriptorSet materialDescriptor = frameDescriptor.getDescriptorEntry(currentMaterial->materialId()).descriptorSet;
-        vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, sceneObject->getMaterial()->pipelineLayout(), 1, 1, &materialDescriptor, 0, nullptr);
+void RenderScene::setFogHistoryIndex(uint32_t writeIndex)
+{
+    uint32_t readIndex = 1 - writeIndex;
+    m_fogResolveMaterial->setTargetIndices(m_fogTargetSlots[0], m_fogTargetSlots[1 + readIndex]);
+    m_fogUpsampleMaterial->setTargetIndex(m_fogTargetSlots[1 + writeIndex]);
+}
 
-        //we can now draw
-        vkCmdDrawIndexed(cmdBuffer, static_cast<uint32_t>(sceneObject->getMesh()->indices().size()), 1, 0, 0, 0);
-    }
+void RenderScene::registerCullingBuffers(DescriptorTable& descriptorTable)
+{
+    m_gpuCulling->registerBuffers(descriptorTable);
+    m_clusterCulling->registerBuffers(descriptorTable, *m_geometryArena, *m_gpuCulling);
+    m_cloudField->setVisibleInstances(m_gpuCulling->visibleInstanceIndex());
+}
+
+const GpuCulling& RenderScene::gpuCulling() const
+{
+    return *m_gpuCulling;
+}
+
+const GeometryArena& RenderScene::geometryArena() const
+{
+    return *m_geometryArena;
 }
 
 void RenderScene::cleanUp(RenderContext& renderContext)
@@ -170,14 +504,53 @@ void RenderScene::cleanUp(RenderContext& renderContext)
 
     m_cloudTexture.cleanUp(renderContext.device());
     m_noiseTexture.cleanUp(renderContext.device());
+    m_blueNoiseTexture.cleanUp(renderContext.device());
+    m_vikingRoomTexture.cleanUp(renderContext.device());
 
-    for (auto& mesh : m_meshes) {
-        mesh->cleanUp(renderContext);
-    }
+    m_geometryArena->cleanUp();
 
     for (auto& material : m_materials) {
         material->cleanUp(renderContext);
     }
+    m_fogCompute->cleanUp(renderContext);
+    m_froxelFog->cleanUp(renderContext);
+    m_cloudField->cleanUp(renderContext);
+    m_gpuCulling->cleanUp(renderContext);
+    m_clusterCulling->cleanUp(renderContext);
 
     m_sceneObjects.clear();
+    m_shaderDataObjects.clear();
+}
+
+/* -------------------------- Private methods -------------------------- */
+
+// Runs of draws sharing a material in the sorted list, a material belongs to a single pass
+void RenderScene::buildDrawBuckets()
+{
+    m_drawBuckets.clear();
+    Material* lastMaterial = nullptr;
+    const auto& draws = m_drawList.entries();
+    for (size_t drawIndex = 0; drawIndex < draws.size(); drawIndex++) {
+        Material* material = m_sceneStore.material(draws[drawIndex].objectIndex);
+        if (material != lastMaterial) {
+            m_drawBuckets.push_back({ static_cast<uint32_t>(drawIndex), 0 });
+            lastMaterial = material;
+        }
+        m_drawBuckets.back().drawCount++;
+    }
+}
+
+// A single instance of a mesh with meshlets gets its own range for the culled indices, before the arena upload
+SceneHandle RenderScene::addSceneObject(std::unique_ptr<SceneObject> sceneObject)
+{
+    Mesh* mesh = sceneObject->getMesh();
+    SceneHandle object = m_sceneStore.add(*sceneObject->getMaterial(), *mesh, sceneObject->transform(), sceneObject->instanceCount());
+    if (!mesh->meshlets().empty() && sceneObject->instanceCount() == 1) {
+        m_sceneStore.setClusterRange(object, m_geometryArena->reserveIndices(mesh->indices().size()));
+    }
+    if (sceneObject->hasShaderData()) {
+        m_shaderDataObjects.push_back(object);
+    }
+    m_sceneObjects.push_back(std::move(sceneObject));
+    return object;
 }
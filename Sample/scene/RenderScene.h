@@ -3,6 +3,9 @@
 #include "SceneObject.h"
 
 #include <core/DescriptorTable.h>
+#include <core/GeometryArena.h>
+#include <core/GpuProfiler.h>
+#include <core/CpuProfiler.h>
 #include <ui/ViewParams.h>
 #include <utils/Camera.h>
 #include <utils/TextureLoader.h>
@@ -13,6 +16,17 @@
 #include <array>
 
 #include "CubicFog.h"
+#include "FogResolve.h"
+#include "FogUpsample.h"
+#include "FogCompute.h"
+#include "FroxelFog.h"
+#include "FroxelComposite.h"
+#include "CloudField.h"
+#include "GpuCulling.h"
+#include "ClusterCulling.h"
+#include "DrawList.h"
+#include "SceneStore.h"
+#include "TexturedModel.h"
 
 class RenderScene
 {
@@ -22,18 +36,97 @@ public:
 
 public:
     void initialize(RenderContext& renderContext, DescriptorTable& descriptorTable, ViewParams& viewParams);
-    void createGraphicPipelines(RenderContext& renderContext, VkRenderPass renderPass, DescriptorTable& descriptorTable);
+    // Each material is built against the render pass it is drawn in
+    void createGraphicPipelines(RenderContext& renderContext, VkRenderPass mainRenderPass, VkRenderPass volumetricRenderPass, DescriptorTable& descriptorTable);
     void destroyGraphicPipelines(RenderContext& renderContext);
-    void updateUniforms(RenderContext& renderContext, Camera& camera, ViewParams& viewParams, DescriptorTable& descriptorTable, FrameDescriptor& currentDescriptor, DescriptorEntry& golbalDescriptor);
-    void fillCommandBuffer(RenderContext& renderContext, VkCommandBuffer cmdBuffer, FrameDescriptor frameDescriptor, VkDescriptorSet globalDescriptor);
+    void updateUniforms(RenderContext& renderContext, Camera& camera, ViewParams& viewParams, DescriptorTable& descriptorTable);
+    // Copies the cull objects changed this frame, before dispatchCulling
+    void uploadCullObjects(VkCommandBuffer cmdBuffer, GpuProfiler* profiler = nullptr);
+    // Frustum culling of every object, writes the visible instance counts and the visible instances
+    void dispatchCulling(VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, GpuProfiler* profiler = nullptr);
+    // Packs the commands of the visible draws of every bucket and writes their draw counts, the draws of all passes read them
+    void dispatchDrawCompaction(VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, GpuProfiler* profiler = nullptr);
+    // Meshlet culling of the large meshes, after dispatchDrawCompaction. Writes their indices in the geometry arena and their index counts in the commands
+    void dispatchClusterCulling(VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, GpuProfiler* profiler = nullptr);
+    // Draw the buckets whose material belongs to the pass, in the order of the draw list
+    void fillCommandBuffer(RenderContext& renderContext, VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, MaterialPass pass, GpuProfiler* profiler = nullptr);
+    // Compute path of the fog, writes the raw fog target instead of the volumetric pass
+    void dispatchFogCompute(VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, GpuProfiler* profiler = nullptr);
+    // Froxel path of the fog, fills the scattering volume then integrates it into the shaded one
+    void dispatchFroxelInject(VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, GpuProfiler* profiler = nullptr);
+    void dispatchFroxelIntegrate(VkCommandBuffer cmdBuffer, DescriptorTable& descriptorTable, GpuProfiler* profiler = nullptr);
+    // Both froxel volumes, to call again whenever they are recreated
+    void setFroxelTargets(DescriptorTable& descriptorTable, VkImageView scatteringView, VkImageView integratedView);
+    // Raw fog target and the two history images, to call again whenever they are recreated.
+    // storageView is the fog target again when the compute path writes it, VK_NULL_HANDLE otherwise
+    void setFogTargets(DescriptorTable& descriptorTable, VkImageView currentView, VkImageView historyView0, VkImageView historyView1, VkImageView storageView = VK_NULL_HANDLE);
+    // The resolve writes history[writeIndex] and reads the other one
+    void setFogHistoryIndex(uint32_t writeIndex);
+    // After the descriptor sets, the cull pass writes its outputs through the storage buffer array
+    void registerCullingBuffers(DescriptorTable& descriptorTable);
+    const GpuCulling& gpuCulling() const;
+    const GeometryArena& geometryArena() const;
     void cleanUp(RenderContext& renderContext);
 
+private:
+    // Owned by the scene, its render state goes in the store under the returned handle
+    SceneHandle addSceneObject(std::unique_ptr<SceneObject> sceneObject);
+    void buildDrawBuckets();
+
 private:
     std::unique_ptr<TextureLoader> m_textureLoader;
+    // vertices and indices of every mesh, bound once for all the draws
+    std::unique_ptr<GeometryArena> m_geometryArena;
     std::vector<std::unique_ptr<Mesh>> m_meshes;
     std::vector<std::unique_ptr<Material>> m_materials;
     std::vector<std::unique_ptr<SceneObject>> m_sceneObjects;
+    // the few objects updated one by one, the fog passes and the cloud field
+    std::vector<SceneHandle> m_shaderDataObjects;
+    // render state of the scene objects, the handles follow m_sceneObjects
+    SceneStore m_sceneStore;
+    FogResolveMaterial* m_fogResolveMaterial;
+    FogUpsampleMaterial* m_fogUpsampleMaterial;
+    FroxelCompositeMaterial* m_froxelCompositeMaterial;
+    FogResolve* m_fogResolve;
+    // only one of them composites the fog, depending on the path
+    FogUpsample* m_fogUpsample;
+    FroxelComposite* m_froxelComposite;
+    CloudField* m_cloudField;
+    CloudFieldMaterial* m_cloudFieldMaterial;
+    SceneHandle m_fogUpsampleHandle;
+    SceneHandle m_froxelCompositeHandle;
+    SceneHandle m_cloudFieldHandle;
+    SceneHandle m_vikingRoomHandle;
+    std::unique_ptr<FogCompute> m_fogCompute;
+    std::unique_ptr<FroxelFog> m_froxelFog;
+    // the cull objects of every scene object, in the same order. Only the updated ones are copied
+    std::unique_ptr<GpuCulling> m_gpuCulling;
+    std::vector<GpuCulling::CullObject> m_cullObjects;
+    std::vector<uint32_t> m_updatedObjects;
+    std::vector<glm::uvec4> m_instanceCulls;
+    // only the objects drawn from their meshlets this frame
+    std::unique_ptr<ClusterCulling> m_clusterCulling;
+    std::vector<ClusterCulling::ClusterObject> m_clusterObjects;
+    // visible objects of every pass, sorted once per frame, and its runs drawn with one call each
+    DrawList m_drawList;
+    std::vector<GpuCulling::DrawBucket> m_drawBuckets;
+    // arena offset of the draw objects of the frame
+    uint32_t m_drawObjectOffset;
+    // storage slots of the scattering and integrated volumes, and the sampled slot of the integrated one
+    std::array<uint32_t, 2> m_froxelStorageSlots;
+    uint32_t m_froxelVolumeSlot;
+    bool m_froxelTargetsBound;
+    // storage slot of the fog target, only added once the compute path is used
+    uint32_t m_fogStorageSlot;
+    bool m_fogStorageBound;
+    // bindless slots of the raw target, history 0 and history 1
+    std::array<uint32_t, 3> m_fogTargetSlots;
+    bool m_fogTargetsBound;
 
     ImageView m_cloudTexture;
     ImageView m_noiseTexture;
+    ImageView m_blueNoiseTexture;
+    ImageView m_vikingRoomTexture;
+    glm::mat4 m_previousViewProj;
+    bool m_hasPreviousFrame;
 };
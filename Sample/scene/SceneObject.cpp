@@ -2,7 +2,9 @@
 #include <iostream>
 #include <glm/gtx/string_cast.hpp>
 
-SceneObject::SceneObject()
+SceneObject::SceneObject():
+    m_transform(1.0f),
+    m_uniformOffset(0)
 {
 
 }
@@ -12,4 +14,24 @@ SceneObject::SceneObject()
 glm::mat4 SceneObject::transform() const
 {
     return m_transform;
-}
\ No newline at end of file
+}
+
+uint32_t SceneObject::uniformOffset() const
+{
+    return m_uniformOffset;
+}
+
+void SceneObject::update(RenderContext& renderContext, Camera& camera, const ViewParams& viewParams, UniformArena& uniformArena)
+{
+
+}
+
+bool SceneObject::hasShaderData() const
+{
+    return false;
+}
+
+uint32_t SceneObject::instanceCount() const
+{
+    return 1;
+}
@@ -14,12 +14,19 @@ public:
     virtual ~SceneObject() = default;
 
 public:
-    virtual void update(RenderContext& renderContext, Camera& camera, const ViewParams& viewParams, const DescriptorEntry& descriptorEntry) = 0;
+    // Only called on the objects with shader data of their own, the transform and the mesh data of every object
+    // are written by the scene store. Push the data of the frame into the arena and keep its offset for the draw
+    virtual void update(RenderContext& renderContext, Camera& camera, const ViewParams& viewParams, UniformArena& uniformArena);
+    virtual bool hasShaderData() const;
     virtual Mesh* getMesh() = 0;
     virtual Material* getMaterial() = 0;
 
     glm::mat4 transform() const;
+    uint32_t uniformOffset() const;
+    // drawn with a single instanced call
+    virtual uint32_t instanceCount() const;
 
 protected:
     glm::mat4 m_transform;
+    uint32_t m_uniformOffset;
 };
@@ -0,0 +1,356 @@
+#include "SceneStore.h"
+
+#include <core/CpuProfiler.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+SceneStore::SceneStore():
+    m_visibleInstanceCount(0),
+    m_workerPool(std::make_unique<WorkerPool>(std::max(1u, std::thread::hardware_concurrency())))
+{
+
+}
+
+SceneStore::~SceneStore()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+SceneHandle SceneStore::add(Material& material, Mesh& mesh, const glm::mat4& transform, uint32_t instanceCount)
+{
+    SceneHandle object = static_cast<SceneHandle>(m_materialIndices.size());
+    m_materialIndices.push_back(tableIndex(m_materials, &material));
+    uint32_t meshIndex = tableIndex(m_meshes, &mesh);
+    if (meshIndex == m_meshLodOffsets.size()) {
+        std::vector<MeshLod> lods = mesh.lods();
+        m_meshLodOffsets.push_back(static_cast<uint32_t>(m_meshLods.size()));
+        m_meshLodCounts.push_back(static_cast<uint32_t>(lods.size()));
+        m_meshVertexOffsets.push_back(mesh.vertexOffset());
+        m_meshPositionDecodes.push_back(mesh.positionDecode());
+        for (MeshLod lod : lods) {
+            lod.firstIndex += mesh.firstIndex();
+            m_meshLods.push_back(lod);
+        }
+        m_meshMeshletOffsets.push_back(static_cast<uint32_t>(m_meshlets.size()));
+        m_meshMeshletCounts.push_back(static_cast<uint32_t>(mesh.meshlets().size()));
+        for (Meshlet meshlet : mesh.meshlets()) {
+            meshlet.range.x += mesh.firstIndex();
+            m_meshlets.push_back(meshlet);
+        }
+    }
+    m_meshIndices.push_back(meshIndex);
+    m_transforms.push_back(transform);
+    m_localMin.push_back(mesh.bboxMin());
+    m_localMax.push_back(mesh.bboxMax());
+    m_lodLevels.push_back(0);
+    m_boundsMin.push_back(mesh.bboxMin());
+    m_boundsMax.push_back(mesh.bboxMax());
+    m_instanceCounts.push_back(instanceCount);
+    m_cullInstances.push_back(glm::uvec4(0));
+    m_clusterFirstIndices.push_back(noClusterRange);
+    m_uniformOffsets.push_back(0);
+    m_visible.push_back(1);
+    m_updated.push_back(1);
+    m_drawKeys.push_back(0);
+    return object;
+}
+
+size_t SceneStore::size() const
+{
+    return m_materialIndices.size();
+}
+
+void SceneStore::setTransform(SceneHandle object, const glm::mat4& transform)
+{
+    m_transforms[object] = transform;
+    m_updated[object] = 1;
+}
+
+void SceneStore::setUniformOffset(SceneHandle object, uint32_t uniformOffset)
+{
+    m_uniformOffsets[object] = uniformOffset;
+}
+
+void SceneStore::setVisible(SceneHandle object, bool visible)
+{
+    uint8_t value = visible ? 1 : 0;
+    if (m_visible[object] != value) {
+        m_visible[object] = value;
+        m_updated[object] = 1;
+    }
+}
+
+// Only the draw order changes between frames, it goes with the instance culls and leaves the cull object as is.
+// The ranges in the visible instance list follow each other in the order the objects were set
+void SceneStore::setCulledInstances(SceneHandle object, uint32_t instanceBufferIndex, uint32_t orderIndex)
+{
+    glm::uvec4& cullInstances = m_cullInstances[object];
+    if (cullInstances.w == 0) {
+        m_instanceCulled.push_back(object);
+        cullInstances.z = m_visibleInstanceCount;
+        m_visibleInstanceCount += m_instanceCounts[object];
+        m_updated[object] = 1;
+    }
+    if (cullInstances.x != instanceBufferIndex) {
+        m_updated[object] = 1;
+    }
+    cullInstances = glm::uvec4(instanceBufferIndex, orderIndex, cullInstances.z, 1);
+}
+
+void SceneStore::setClusterRange(SceneHandle object, uint32_t firstIndex)
+{
+    m_clusterFirstIndices[object] = firstIndex;
+    m_updated[object] = 1;
+}
+
+Material* SceneStore::material(SceneHandle object) const
+{
+    return m_materials[m_materialIndices[object]];
+}
+
+Mesh* SceneStore::mesh(SceneHandle object) const
+{
+    return m_meshes[m_meshIndices[object]];
+}
+
+uint32_t SceneStore::uniformOffset(SceneHandle object) const
+{
+    return m_uniformOffsets[object];
+}
+
+bool SceneStore::isVisible(SceneHandle object) const
+{
+    return m_visible[object] != 0;
+}
+
+const std::vector<Material*>& SceneStore::materials() const
+{
+    return m_materials;
+}
+
+const std::vector<Meshlet>& SceneStore::meshlets() const
+{
+    return m_meshlets;
+}
+
+uint32_t SceneStore::visibleInstanceCount() const
+{
+    return m_visibleInstanceCount;
+}
+
+/* -------------------------- Systems -------------------------- */
+
+// Box of the transformed mesh bounds, from the transformed center and the absolute extents.
+// Only the updated objects can have moved
+void SceneStore::updateBounds()
+{
+    CPU_ZONE("SceneStore::updateBounds");
+    runBatches([this](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            if (!m_updated[i]) {
+                continue;
+            }
+            const glm::mat4& transform = m_transforms[i];
+            glm::vec3 center = glm::vec3(transform * glm::vec4(0.5f * (m_localMin[i] + m_localMax[i]), 1.0f));
+            glm::vec3 extent = 0.5f * (m_localMax[i] - m_localMin[i]);
+            glm::mat3 absolute = glm::mat3(glm::vec3(glm::abs(transform[0])), glm::vec3(glm::abs(transform[1])), glm::vec3(glm::abs(transform[2])));
+            glm::vec3 worldExtent = absolute * extent;
+            m_boundsMin[i] = center - worldExtent;
+            m_boundsMax[i] = center + worldExtent;
+        }
+    });
+}
+
+/*
+    The error of a level is in mesh space, scaled by the largest axis of the model view then
+    divided by the view distance of the bounds. Inside the bounds the full detail is kept
+*/
+void SceneStore::selectLods(const glm::mat4& modelView, float projectionScale)
+{
+    CPU_ZONE("SceneStore::selectLods");
+    float viewScale = std::max(glm::length(glm::vec3(modelView[0])), std::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+    float errorScale = std::abs(projectionScale) * viewScale;
+    // a new level changes the range of the cull object
+    runBatches([this, &modelView, errorScale, viewScale](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            uint32_t lodCount = m_meshLodCounts[m_meshIndices[i]];
+            uint32_t level = 0;
+            glm::vec3 center = 0.5f * (m_boundsMin[i] + m_boundsMax[i]);
+            float radius = 0.5f * glm::length(m_boundsMax[i] - m_boundsMin[i]) * viewScale;
+            float distance = -(modelView * glm::vec4(center, 1.0f)).z - radius;
+            if (lodCount >= 2 && m_cullInstances[i].w == 0 && distance > 0.0f) {
+                const MeshLod* lods = &m_meshLods[m_meshLodOffsets[m_meshIndices[i]]];
+                while (level + 1 < lodCount && lods[level + 1].error * errorScale / distance <= lodErrorThreshold) {
+                    level++;
+                }
+            }
+            if (m_lodLevels[i] != level) {
+                m_lodLevels[i] = level;
+                m_updated[i] = 1;
+            }
+        }
+    });
+}
+
+void SceneStore::buildCullObjects(std::vector<GpuCulling::CullObject>& cullObjects, std::vector<uint32_t>& updatedObjects)
+{
+    CPU_ZONE("SceneStore::buildCullObjects");
+    cullObjects.resize(size());
+    runBatches([this, &cullObjects](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            if (!m_updated[i]) {
+                continue;
+            }
+            GpuCulling::CullObject& cullObject = cullObjects[i];
+            const MeshLod& lod = m_meshLods[m_meshLodOffsets[m_meshIndices[i]] + m_lodLevels[i]];
+            // the cluster culling writes the index count of its range afterwards
+            bool clusters = usesClusters(i);
+            cullObject.bboxMin = glm::vec4(m_boundsMin[i], 0.0f);
+            cullObject.bboxMax = glm::vec4(m_boundsMax[i], 0.0f);
+            cullObject.draw = glm::uvec4(clusters ? 0u : lod.indexCount, m_visible[i] ? m_instanceCounts[i] : 0, m_cullInstances[i].z, m_cullInstances[i].w);
+            cullObject.instances = glm::uvec4(m_cullInstances[i].x, 0, clusters ? m_clusterFirstIndices[i] : lod.firstIndex,
+                static_cast<uint32_t>(m_meshVertexOffsets[m_meshIndices[i]]));
+        }
+    });
+
+    // a scan of one byte per object, the copies only cover the listed ones
+    updatedObjects.clear();
+    for (size_t i = 0; i < size(); i++) {
+        if (m_updated[i]) {
+            updatedObjects.push_back(static_cast<uint32_t>(i));
+            m_updated[i] = 0;
+        }
+    }
+}
+
+void SceneStore::buildInstanceCulls(std::vector<glm::uvec4>& instanceCulls) const
+{
+    instanceCulls.clear();
+    for (SceneHandle object : m_instanceCulled) {
+        instanceCulls.push_back(glm::uvec4(object, m_cullInstances[object].y, 0, 0));
+    }
+}
+
+// The shader data shared by every object, the objects with data of their own add its offset. Written straight in the arena
+void SceneStore::buildDrawObjects(DrawObject* drawObjects) const
+{
+    CPU_ZONE("SceneStore::buildDrawObjects");
+    runBatches([this, drawObjects](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            const PositionDecode& positionDecode = m_meshPositionDecodes[m_meshIndices[i]];
+            DrawObject& drawObject = drawObjects[i];
+            drawObject.data = glm::uvec4(m_uniformOffsets[i] / 16, m_cullInstances[i].z, 0, 0);
+            drawObject.positionOffset = glm::vec4(positionDecode.offset, 0.0f);
+            drawObject.positionScale = glm::vec4(positionDecode.scale, 0.0f);
+            drawObject.transform = m_transforms[i];
+        }
+    });
+}
+
+/*
+    A handful of large meshes, no batches. The normal cones are only tested when the pipeline
+    drops the back faces of a counter clockwise mesh and the transform keeps the angles and the winding of the mesh
+*/
+void SceneStore::buildClusterObjects(const glm::mat4& modelView, std::vector<ClusterCulling::ClusterObject>& clusterObjects) const
+{
+    CPU_ZONE("SceneStore::buildClusterObjects");
+    clusterObjects.clear();
+    for (size_t i = 0; i < size(); i++) {
+        if (!m_visible[i] || !usesClusters(i)) {
+            continue;
+        }
+        glm::mat4 meshView = modelView * m_transforms[i];
+        glm::vec3 scale(glm::length(glm::vec3(meshView[0])), glm::length(glm::vec3(meshView[1])), glm::length(glm::vec3(meshView[2])));
+        bool uniformScale = std::abs(scale.x - scale.y) <= 1e-3f * scale.x && std::abs(scale.x - scale.z) <= 1e-3f * scale.x;
+        const Material* material = m_materials[m_materialIndices[i]];
+        bool backFaceCulling = material->cullMode() == VK_CULL_MODE_BACK_BIT && material->frontFace() == VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        bool coneCulling = backFaceCulling && uniformScale && glm::determinant(glm::mat3(meshView)) > 0.0f;
+
+        ClusterCulling::ClusterObject clusterObject;
+        uint32_t meshIndex = m_meshIndices[i];
+        clusterObject.transform = m_transforms[i];
+        clusterObject.camera = glm::vec4(glm::vec3(glm::inverse(meshView)[3]), coneCulling ? 1.0f : 0.0f);
+        clusterObject.meshlets = glm::uvec4(m_meshMeshletOffsets[meshIndex], m_meshMeshletCounts[meshIndex], static_cast<uint32_t>(i), m_clusterFirstIndices[i]);
+        clusterObjects.push_back(clusterObject);
+    }
+}
+
+void SceneStore::buildDrawList(const glm::mat4& modelView, DrawList& drawList)
+{
+    CPU_ZONE("SceneStore::buildDrawList");
+    // a handful of materials, their variant can change between frames
+    m_materialKeys.resize(m_materials.size());
+    for (size_t i = 0; i < m_materials.size(); i++) {
+        Material* material = m_materials[i];
+        uint32_t pipeline = DrawList::pipelineId(static_cast<uint32_t>(material->materialId()), material->variant());
+        m_materialKeys[i] = { static_cast<uint32_t>(material->pass()), pipeline, material->depthWrite() };
+    }
+
+    // the mesh table index stands for the mesh in the key
+    runBatches([this, &modelView](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            if (!m_visible[i]) {
+                continue;
+            }
+            const MaterialKey& materialKey = m_materialKeys[m_materialIndices[i]];
+            glm::vec3 center = 0.5f * (m_boundsMin[i] + m_boundsMax[i]);
+            float depth = -(modelView * glm::vec4(center, 1.0f)).z;
+            m_drawKeys[i] = materialKey.depthWrite ? DrawList::opaqueKey(materialKey.pass, materialKey.pipeline, m_meshIndices[i], depth)
+                : DrawList::blendedKey(materialKey.pass, materialKey.pipeline, m_meshIndices[i], depth);
+        }
+    });
+
+    drawList.clear();
+    for (size_t i = 0; i < size(); i++) {
+        if (m_visible[i]) {
+            drawList.add(m_drawKeys[i], static_cast<uint32_t>(i));
+        }
+    }
+    drawList.sort();
+}
+
+/* -------------------------- Private methods -------------------------- */
+
+bool SceneStore::usesClusters(size_t object) const
+{
+    return m_clusterFirstIndices[object] != noClusterRange && m_lodLevels[object] == 0 && m_meshMeshletCounts[m_meshIndices[object]] > 0;
+}
+
+/*
+    Calls function(first, last) on every batch of objects. The batches are spread over at most
+    one worker per core, the calling thread takes its share. Every batch writes its own range
+    of the arrays, nothing is shared between them
+*/
+template<typename Function>
+void SceneStore::runBatches(Function function) const
+{
+    size_t count = size();
+    size_t batchCount = (count + batchSize - 1) / batchSize;
+    if (batchCount <= 1) {
+        function(size_t(0), count);
+        return;
+    }
+
+    // the workers past the batch count have nothing to do, the pool rethrows the first failure
+    size_t workerCount = std::min(m_workerPool->workerCount(), batchCount);
+    m_workerPool->run([&](size_t worker) {
+        for (size_t batch = worker; batch < batchCount; batch += workerCount) {
+            size_t first = batch * batchSize;
+            function(first, std::min(first + batchSize, count));
+        }
+    });
+}
+
+template<typename T>
+uint32_t SceneStore::tableIndex(std::vector<T*>& table, T* entry)
+{
+    auto it = std::find(table.begin(), table.end(), entry);
+    if (it != table.end()) {
+        return static_cast<uint32_t>(it - table.begin());
+    }
+    table.push_back(entry);
+    return static_cast<uint32_t>(table.size() - 1);
+}
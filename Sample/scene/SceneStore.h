@@ -0,0 +1,152 @@
+#pragma once
+
+#include <utils/Mesh.h>
+#include <utils/Material.h>
+#include <core/WorkerPool.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "GpuCulling.h"
+#include "ClusterCulling.h"
+#include "DrawList.h"
+
+using SceneHandle = uint32_t;
+
+/*
+    Render state of the scene objects as contiguous component arrays, one entry per object in
+    scene order. The per frame systems (bounds, cull objects, draw keys, draw objects) loop over
+    the arrays instead of asking every object through its virtual methods, and split them in
+    batches running on a pool of worker threads once the scene is large enough.
+    Materials and meshes are shared, the objects only keep an index into their tables.
+*/
+class SceneStore
+{
+public:
+    // objects per batch, a smaller scene runs on the calling thread
+    static constexpr size_t batchSize = 4096;
+    // largest error of a level of detail on screen, in half screen heights (about a pixel at 1080p)
+    static constexpr float lodErrorThreshold = 0.002f;
+    static constexpr uint32_t noClusterRange = ~0u;
+
+    // Same layout as DrawObject in draw_object.glsl, one per object in scene order
+    struct DrawObject {
+        // x: vec4 index of the shader data of the object in the arena, 0 without, y: first entry of its visible instances
+        glm::uvec4 data;
+        // Mesh::positionDecode of the mesh
+        glm::vec4 positionOffset;
+        glm::vec4 positionScale;
+        // placed under the model matrix
+        glm::mat4 transform;
+    };
+
+public:
+    SceneStore();
+    ~SceneStore();
+
+public:
+    // The handle is the index of the object, its cull object and draw object use the same one, its commands carry it as first instance
+    SceneHandle add(Material& material, Mesh& mesh, const glm::mat4& transform, uint32_t instanceCount);
+    size_t size() const;
+
+    // The setters changing the cull object mark it updated, it is copied to the gpu with the next cull objects
+    void setTransform(SceneHandle object, const glm::mat4& transform);
+    void setUniformOffset(SceneHandle object, uint32_t uniformOffset);
+    // hidden objects are kept but get no instance and no draw
+    void setVisible(SceneHandle object, bool visible);
+    // Culled instance by instance, orderIndex is the vec4 index of the draw order in the arena, set every frame.
+    // The first call gives the object its range in the visible instance list, before the culling buffers are created
+    void setCulledInstances(SceneHandle object, uint32_t instanceBufferIndex, uint32_t orderIndex);
+    // Drawn at full detail from the indices the cluster culling leaves at firstIndex in the geometry arena,
+    // the range holds as many indices as the mesh
+    void setClusterRange(SceneHandle object, uint32_t firstIndex);
+
+    Material* material(SceneHandle object) const;
+    Mesh* mesh(SceneHandle object) const;
+    uint32_t uniformOffset(SceneHandle object) const;
+    bool isVisible(SceneHandle object) const;
+    // Unique materials, in the order they were added
+    const std::vector<Material*>& materials() const;
+    // Meshlets of every mesh, their ranges in the whole geometry arena
+    const std::vector<Meshlet>& meshlets() const;
+    // Instances of every object culled instance by instance, the size of the visible instance list
+    uint32_t visibleInstanceCount() const;
+
+    /* ---------------- Systems ---------------- */
+
+    // Bounds of the meshes moved by the object transforms
+    void updateBounds();
+    // Coarsest level of detail whose error stays under the threshold once projected, projectionScale is proj[1][1].
+    // The objects culled instance by instance keep the full detail, their bounds don't cover the instances
+    void selectLods(const glm::mat4& modelView, float projectionScale);
+    // Rewrites the cull objects updated since the previous call and lists them, cullObjects keeps the others
+    void buildCullObjects(std::vector<GpuCulling::CullObject>& cullObjects, std::vector<uint32_t>& updatedObjects);
+    // x: object culled instance by instance, y: vec4 index of its draw order
+    void buildInstanceCulls(std::vector<glm::uvec4>& instanceCulls) const;
+    // Every object in scene order, drawObjects has room for all of them
+    void buildDrawObjects(DrawObject* drawObjects) const;
+    // The visible objects drawn from their meshlets, in the same frame as the cull objects
+    void buildClusterObjects(const glm::mat4& modelView, std::vector<ClusterCulling::ClusterObject>& clusterObjects) const;
+    // Keys of the visible objects, the depth is the view distance of their bounds center
+    void buildDrawList(const glm::mat4& modelView, DrawList& drawList);
+
+private:
+    template<typename Function>
+    void runBatches(Function function) const;
+    // cluster range set, a mesh with meshlets and the full detail selected
+    bool usesClusters(size_t object) const;
+    template<typename T>
+    static uint32_t tableIndex(std::vector<T*>& table, T* entry);
+
+private:
+    // pass, pipeline and depth write of a material, refreshed once per frame before the keys
+    struct MaterialKey {
+        uint32_t pass;
+        uint32_t pipeline;
+        bool depthWrite;
+    };
+
+    std::vector<Material*> m_materials;
+    std::vector<Mesh*> m_meshes;
+    // levels of detail of every mesh one after the other, the first level of mesh i is m_meshLods[m_meshLodOffsets[i]].
+    // their first index is in the whole geometry arena
+    std::vector<MeshLod> m_meshLods;
+    std::vector<uint32_t> m_meshLodOffsets;
+    std::vector<uint32_t> m_meshLodCounts;
+    std::vector<int32_t> m_meshVertexOffsets;
+    std::vector<PositionDecode> m_meshPositionDecodes;
+    // same for the meshlets
+    std::vector<Meshlet> m_meshlets;
+    std::vector<uint32_t> m_meshMeshletOffsets;
+    std::vector<uint32_t> m_meshMeshletCounts;
+
+    // components, indexed by the scene handle
+    std::vector<uint32_t> m_materialIndices;
+    std::vector<uint32_t> m_meshIndices;
+    std::vector<glm::mat4> m_transforms;
+    // mesh bounds copied at creation, the systems never read the meshes
+    std::vector<glm::vec3> m_localMin;
+    std::vector<glm::vec3> m_localMax;
+    // selected level of detail, an index into the levels of the mesh
+    std::vector<uint32_t> m_lodLevels;
+    // bounds in the space of the model matrix, written by updateBounds
+    std::vector<glm::vec3> m_boundsMin;
+    std::vector<glm::vec3> m_boundsMax;
+    std::vector<uint32_t> m_instanceCounts;
+    // x: instance buffer slot, y: draw order index, z: first entry in the visible instance list, w: 1 when culled instance by instance
+    std::vector<glm::uvec4> m_cullInstances;
+    uint32_t m_visibleInstanceCount;
+    // first index of the culled meshlet indices in the geometry arena, noClusterRange without
+    std::vector<uint32_t> m_clusterFirstIndices;
+    std::vector<uint32_t> m_uniformOffsets;
+    std::vector<uint8_t> m_visible;
+    // 1 when the cull object changed since the last buildCullObjects
+    std::vector<uint8_t> m_updated;
+    // objects culled instance by instance, in the order they were set
+    std::vector<SceneHandle> m_instanceCulled;
+    std::vector<uint64_t> m_drawKeys;
+    // created once, runs the batches of every system
+    std::unique_ptr<WorkerPool> m_workerPool;
+    std::vector<MaterialKey> m_materialKeys;
+};
@@ -1,20 +1,12 @@
 #include "TextureMaterial.h"
+#include <core/DescriptorTable.h>
 #include <iostream>
 #include <glm/gtx/string_cast.hpp>
 
-TextureMaterial::TextureMaterial(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader):
+TextureMaterial::TextureMaterial(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader, VkFrontFace frontFace):
     Material(device, vertexShader, fragmentShader)
 {
-    /* ------------------ Descriptor Binding ------------------ */
-
-    VkDescriptorSetLayoutBinding textureDataBinding;
-    textureDataBinding.binding = 1;
-    textureDataBinding.descriptorCount = 1;
-    textureDataBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    textureDataBinding.pImmutableSamplers = nullptr;
-    textureDataBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-    m_descriptorBindings.push_back(textureDataBinding);
+    setFrontFace(frontFace);
 }
 
 TextureMaterial::~TextureMaterial()
@@ -22,13 +14,6 @@ TextureMaterial::~TextureMaterial()
 
 }
 
-void TextureMaterial::createDescriptorBuffer(RenderContext& renderContext, VkBuffer& buffer, VkDeviceMemory& memory)
-{
-    //VkDeviceSize fogBufferSize = sizeof(CloudData);
-    //VkMemoryPropertyFlags memoryPropertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-    //renderContext.createBuffer(fogBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, memoryPropertyFlags, buffer, memory);
-}
-
 void TextureMaterial::createTextureSampler(RenderContext& renderContext, const ImageView& imageView)
 {
     m_noiseTexture2D = imageView;
@@ -59,28 +44,15 @@ void TextureMaterial::createTextureSampler(RenderContext& renderContext, const I
     }
 }
 
-void TextureMaterial::updateDescriptorSet(RenderContext& renderContext, VkDescriptorSet descriptorSet, VkBuffer buffer)
+const char* TextureMaterial::name() const
 {
-    std::vector<VkWriteDescriptorSet> descriptorWrites;
-
-    VkDescriptorImageInfo imageInfo;
-    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    //imageInfo.imageView = m_textureImageView.view();
-    imageInfo.imageView = m_noiseTexture2D.view();
-    imageInfo.sampler = m_textureSampler;
-
-    VkWriteDescriptorSet imageSampler;
-    imageSampler.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    imageSampler.dstSet = descriptorSet;
-    imageSampler.dstBinding = 1;
-    imageSampler.dstArrayElement = 0;
-    imageSampler.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    imageSampler.descriptorCount = 1;
-    imageSampler.pImageInfo = &imageInfo;
-    imageSampler.pNext = nullptr;
+    return "Textured";
+}
 
-    descriptorWrites.push_back(imageSampler);
-    vkUpdateDescriptorSets(renderContext.device(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+void TextureMaterial::registerResources(DescriptorTable& descriptorTable)
+{
+    m_textureIndex = descriptorTable.addTexture2D(m_noiseTexture2D.view());
+    m_samplerIndex = descriptorTable.addSampler(m_textureSampler);
 }
 
 void TextureMaterial::cleanUp(RenderContext& renderContext)
@@ -7,12 +7,13 @@
 class TextureMaterial : public Material
 {
 public:
-    TextureMaterial(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader);
+    // the meshes loaded from files wind their front faces counter clockwise
+    TextureMaterial(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader, VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE);
     ~TextureMaterial();
 
 public:
-    void createDescriptorBuffer(RenderContext& renderContext, VkBuffer& buffer, VkDeviceMemory& memory) override;
-    void updateDescriptorSet(RenderContext& renderContext, VkDescriptorSet descriptorSet, VkBuffer buffer) override;
+    void registerResources(DescriptorTable& descriptorTable) override;
+    const char* name() const override;
     void createTextureSampler(RenderContext& renderContext, const ImageView& imageView);
     void cleanUp(RenderContext& renderContext) override;
 
@@ -0,0 +1,26 @@
+#include "TexturedModel.h"
+
+TexturedModel::TexturedModel(SkinMesh& mesh, TextureMaterial& material) :
+    SceneObject(),
+    m_mesh(mesh),
+    m_material(material)
+{
+
+}
+
+TexturedModel::~TexturedModel()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+Mesh* TexturedModel::getMesh()
+{
+    return &m_mesh;
+}
+
+Material* TexturedModel::getMaterial()
+{
+    return &m_material;
+}
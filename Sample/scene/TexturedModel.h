@@ -0,0 +1,24 @@
+#pragma once
+
+#include <utils/SkinMesh.h>
+#include "SceneObject.h"
+#include "TextureMaterial.h"
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+// Large textured mesh loaded from a file, drawn from its meshlets or one of its levels of detail
+class TexturedModel : public SceneObject
+{
+public:
+    TexturedModel(SkinMesh& mesh, TextureMaterial& material);
+    ~TexturedModel();
+
+public:
+    Mesh* getMesh() override;
+    Material* getMaterial() override;
+
+private:
+    SkinMesh& m_mesh;
+    TextureMaterial& m_material;
+};
@@ -0,0 +1,109 @@
+/*
+    Cloud data and marching helpers shared by the fog shaders.
+    Included after the declarations of ubo, objects, textures3D, samplers and draw
+*/
+
+// Same layout as FogMaterial::CloudData, the passes owning more data store it after these 12 vec4
+struct CloudData {
+    vec4 worldCamera;
+    vec4 worldLightPos;
+    vec4 bboxMin;
+    vec4 bboxMax;
+    vec4 lightColor;
+    vec4 lightAbsorption;
+    vec4 densityTreshold;
+    vec4 phaseParams;
+    vec4 fogSpeed;
+    vec4 raymarchParams;
+    vec4 marchParams;
+    float fogDensity;
+};
+
+CloudData cloud;
+
+// Offset of the noise in xyz and scale of its scrolling in w, the cloud field sets it per instance
+vec4 noiseOffset = vec4(0.0, 0.0, 0.0, 1.0);
+
+CloudData loadCloudData(uint index)
+{
+    CloudData result;
+    result.worldCamera = objects.data[index];
+    result.worldLightPos = objects.data[index + 1];
+    result.bboxMin = objects.data[index + 2];
+    result.bboxMax = objects.data[index + 3];
+    result.lightColor = objects.data[index + 4];
+    result.lightAbsorption = objects.data[index + 5];
+    result.densityTreshold = objects.data[index + 6];
+    result.phaseParams = objects.data[index + 7];
+    result.fogSpeed = objects.data[index + 8];
+    result.raymarchParams = objects.data[index + 9];
+    result.marchParams = objects.data[index + 10];
+    result.fogDensity = objects.data[index + 11].x;
+    return result;
+}
+
+// Returns (dstToBox, dstInsideBox). If ray misses box, dstInsideBox will be zero
+vec2 rayBoxDist(vec3 bboxMin, vec3 bboxMax, vec3 origin, vec3 invRaydir) {
+    // Adapted from: http://jcgt.org/published/0007/03/04/
+    vec3 t0 = (bboxMin - origin) * invRaydir;
+    vec3 t1 = (bboxMax - origin) * invRaydir;
+    vec3 tmin = min(t0, t1);
+    vec3 tmax = max(t0, t1);
+
+    float dstA = max(max(tmin.x, tmin.y), tmin.z);
+    float dstB = min(tmax.x, min(tmax.y, tmax.z));
+
+    // CASE 1: ray intersects box from outside (0 <= dstA <= dstB)
+    // dstA is dst to nearest intersection, dstB dst to far intersection
+
+    // CASE 2: ray intersects box from inside (dstA < 0 < dstB)
+    // dstA is the dst to intersection behind the ray, dstB is dst to forward intersection
+
+    // CASE 3: ray misses box (dstA > dstB)
+
+    float dstToBox = max(0, dstA);
+    float dstInsideBox = max(0, dstB - dstToBox);
+    return vec2(dstToBox, dstInsideBox);
+}
+
+// The noise has a single mip, the explicit level lets the compute passes sample it as well
+float sample3DTexture(vec3 pos)
+{
+    //[-0.5, 0.5] -> [-1; 1]  -> [0; 2] -> [0; 1]
+    pos = (pos * 2.0 + 1.0) / 2.0 + noiseOffset.xyz;
+    // Change depth value for adding a scrolling effect
+    pos.z += cloud.fogSpeed.x * noiseOffset.w * ubo.time;
+    pos.z = mod(pos.z, 1.0);
+    return textureLod(sampler3D(textures3D[draw.textureIndex], samplers[draw.samplerIndex]), pos, 0.0).r;
+}
+
+/*
+    Optical depth toward the light, lightSamples steps per unit of distance each weighted by
+    sampleWeight. Outside of the noise the samples count as fully dense
+*/
+float lightMarch(vec3 position, vec3 lightPosition, float lightSamples, float sampleWeight)
+{
+    vec3 lightDir = normalize(lightPosition - position);
+    vec2 lightBoxDistance = rayBoxDist(cloud.bboxMin.xyz, cloud.bboxMax.xyz, position, 1.0 / lightDir);
+    float lightDistanceToTravel = lightBoxDistance.y;
+
+    float lightStepSize = 1.0 / lightSamples;
+    vec3 lightSamplePoint = position;
+    vec3 lightStepVector = lightDir * lightStepSize;
+    float lightDistanceTravelled = 0.0;
+    float shadowValue = 0.0;
+
+    // bounded by the distance to the edge of the box, whatever its size
+    int maxLightSteps = int(ceil(lightDistanceToTravel / lightStepSize)) + 1;
+    for (int i = 0; i < maxLightSteps && lightDistanceTravelled < lightDistanceToTravel; i++) {
+        float lsample = 1.0;
+        float maxCoord = max(max(abs(lightSamplePoint.x), abs(lightSamplePoint.y)), abs(lightSamplePoint.z));
+        if (maxCoord <= 1.0) {
+            lsample = sample3DTexture(lightSamplePoint);
+        }
+        shadowValue += lsample * sampleWeight;
+        lightDistanceTravelled += lightStepSize;
+        lightSamplePoint += lightStepVector;
+    }
+    return shadowValue;
+}
@@ -0,0 +1,119 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+#extension GL_GOOGLE_include_directive : require
+
+/* --------------------------- Varying --------------------------- */
+
+layout(location = 2) in vec3 worldPosition;
+layout(location = 3) flat in uint instanceIndex;
+// vec4 index of the field data, from the draw object
+layout(location = 4) flat in uint objectData;
+
+layout(location = 0) out vec4 outColor;
+
+/* --------------------------- Uniforms --------------------------- */
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    float time;
+} ubo;
+
+// Uniform arena, the field data starts at objectData
+layout(set = 0, binding = 1) readonly buffer ObjectData {
+    vec4 data[];
+} objects;
+
+// Bindless resources
+layout(set = 1, binding = 1) uniform texture3D textures3D[];
+layout(set = 1, binding = 2) uniform sampler samplers[];
+
+// Same layout as CloudFieldMaterial::InstanceData
+struct CloudInstance {
+    mat4 transform;
+    mat4 inverseTransform;
+    vec4 seedOffset;
+    vec4 motion;
+};
+
+layout(set = 1, binding = 3) readonly buffer InstanceBuffer {
+    CloudInstance instances[];
+} instanceBuffers[];
+
+// textureIndex: 3D noise shared with the fog, bufferIndex: storage slot of the instances
+layout(push_constant) uniform DrawConstants {
+    uint objectIndex;
+    uint textureIndex;
+    uint samplerIndex;
+    uint bufferIndex;
+} draw;
+
+#include "cloud_common.glsl"
+
+CloudInstance instance;
+
+/* --------------------------- Defines --------------------------- */
+
+// Quality tier, same constants as cloud_shader.frag
+layout(constant_id = 0) const int nbSamples = 128;
+layout(constant_id = 1) const float nbLightSamples = 58.0;
+layout(constant_id = 2) const float darknessThreshold = 0.05;
+
+// Same as the fog, the light position is already in the unit box of the instance
+float lightDepth(vec3 position, vec3 lightPosition, float transmittance)
+{
+    float lightSamples = max(nbLightSamples * transmittance, min(cloud.marchParams.w, nbLightSamples));
+    return lightMarch(position, lightPosition, lightSamples, instance.seedOffset.w * nbLightSamples / lightSamples);
+}
+
+/*
+    Fixed steps with early termination, the boxes are small on screen. The result is blended
+    over what is behind, so the color is divided by the opacity
+*/
+void main() {
+    cloud = loadCloudData(objectData);
+    instance = instanceBuffers[draw.bufferIndex].instances[instanceIndex];
+    // every instance reads its own part of the repeating noise and scrolls at its own speed
+    noiseOffset = vec4(instance.seedOffset.xyz, instance.motion.x);
+
+    vec3 origin = (instance.inverseTransform * vec4(cloud.worldCamera.xyz, 1.0)).xyz;
+    vec3 lightPosition = (instance.inverseTransform * vec4(cloud.worldLightPos.xyz, 1.0)).xyz;
+    vec3 rayDir = normalize(worldPosition - origin);
+    vec2 boxDistance = rayBoxDist(cloud.bboxMin.xyz, cloud.bboxMax.xyz, origin, vec3(1.0) / rayDir);
+    if (boxDistance.y <= 0) {
+        discard;
+    }
+
+    vec3 firstPoint = origin + rayDir * boxDistance.x;
+    float stepSize = 1.0 / min(cloud.raymarchParams.x, float(nbSamples));
+    float transmittance = 1.0;
+    float accumulation = 0.0;
+    float distTravelled = 0.5 * stepSize;
+
+    int maxSamples = int(ceil(boxDistance.y / stepSize)) + 1;
+    for (int i = 0; i < maxSamples && distTravelled < boxDistance.y; i++) {
+        vec3 currentPosition = firstPoint + rayDir * distTravelled;
+        float density = instance.seedOffset.w * cloud.phaseParams.x * sample3DTexture(currentPosition);
+        distTravelled += stepSize;
+        if (density <= cloud.marchParams.z) {
+            continue;
+        }
+
+        float shadowTerm = exp(-lightDepth(currentPosition, lightPosition, transmittance) * cloud.lightAbsorption.x);
+        shadowTerm = darknessThreshold + shadowTerm * (1.0 - darknessThreshold);
+        float curdensity = density * stepSize;
+        accumulation += shadowTerm * curdensity * transmittance;
+        transmittance *= max(1.0 - curdensity, 0.0);
+        if (transmittance < cloud.marchParams.x) {
+            break;
+        }
+    }
+
+    float opacity = 1.0 - transmittance;
+    if (opacity < 1e-3) {
+        discard;
+    }
+    outColor.rgb = cloud.lightColor.xyz * accumulation / opacity;
+    outColor.a = opacity;
+}
@@ -0,0 +1,67 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+#extension GL_ARB_shader_draw_parameters : require
+#extension GL_GOOGLE_include_directive : require
+
+// the color at location 1 is not read, meshes with a single color leave it out of the packed layout
+layout(location = 0) in vec3 inPosition;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 2) out vec3 worldPosition;
+layout(location = 3) flat out uint instanceIndex;
+// vec4 index of the field data, read by the fragment shader
+layout(location = 4) flat out uint objectData;
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    float time;
+} ubo;
+
+// Uniform arena, the draw objects start at draw.objectIndex
+layout(set = 0, binding = 1) readonly buffer ObjectData {
+    vec4 data[];
+} objects;
+
+// Same layout as CloudFieldMaterial::InstanceData
+struct CloudInstance {
+    mat4 transform;
+    mat4 inverseTransform;
+    vec4 seedOffset;
+    vec4 motion;
+};
+
+layout(set = 1, binding = 3) readonly buffer InstanceBuffer {
+    CloudInstance instances[];
+} instanceBuffers[];
+
+// Written by the cull pass, the visible instances in draw order
+layout(set = 1, binding = 3) readonly buffer VisibleInstances {
+    uint indices[];
+} visibleBuffers[];
+
+// bufferIndex: storage slot of the instances
+layout(push_constant) uniform DrawConstants {
+    uint objectIndex;
+    uint textureIndex;
+    uint samplerIndex;
+    uint bufferIndex;
+} draw;
+
+#include "draw_object.glsl"
+
+void main() {
+    DrawObject object = loadDrawObject();
+    objectData = object.data.x;
+    // the field params follow the 12 vec4 of the cloud data, y: slot of the visible list
+    vec4 field = objects.data[objectData + 12];
+    uint visibleEntry = object.data.y + drawInstanceIndex();
+    instanceIndex = visibleBuffers[uint(field.y)].indices[visibleEntry];
+    CloudInstance instance = instanceBuffers[draw.bufferIndex].instances[instanceIndex];
+
+    // the fragment marches in the unit box of the instance
+    vec3 position = decodePosition(object, inPosition);
+    worldPosition = position;
+    gl_Position = ubo.proj * ubo.view * ubo.model * object.transform * instance.transform * vec4(position, 1.0);
+}
@@ -0,0 +1,107 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+/* --------------------------- Varying --------------------------- */
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragTexCoord;
+layout(location = 2) in vec3 worldPosition;
+// vec4 index of the object data, from the draw object
+layout(location = 4) flat in uint objectData;
+
+layout(location = 0) out vec4 outColor;
+
+/* --------------------------- Uniforms --------------------------- */
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+    float time;
+    mat4 previousViewProj;
+} ubo;
+
+// Uniform arena, the object data starts at objectData
+layout(set = 0, binding = 1) readonly buffer ObjectData {
+    vec4 data[];
+} objects;
+
+// Bindless resources
+layout(set = 1, binding = 0) uniform texture2D textures2D[];
+layout(set = 1, binding = 2) uniform sampler samplers[];
+
+layout(push_constant) uniform DrawConstants {
+    uint objectIndex;
+    uint textureIndex;
+    uint samplerIndex;
+    uint bufferIndex;
+} draw;
+
+// Same layout as FogResolveMaterial::ResolveData
+struct ResolveData {
+    vec4 worldCamera;
+    vec4 params;
+    vec4 viewport;
+};
+
+ResolveData loadResolveData(uint index)
+{
+    ResolveData result;
+    result.worldCamera = objects.data[index];
+    result.params = objects.data[index + 1];
+    result.viewport = objects.data[index + 2];
+    return result;
+}
+
+/*
+    The raw target holds the fog color and the distance where the ray enters the box (-1 on a miss).
+    The entry point is projected with the matrices of the previous frame to find the history,
+    which is clamped to the colors around the pixel so disoccluded or changed fog doesn't ghost
+*/
+void main() {
+    ResolveData resolve = loadResolveData(objectData);
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 textureExtent = textureSize(sampler2D(textures2D[draw.textureIndex], samplers[draw.samplerIndex]), 0);
+    // texels rendered this frame, the rest of the target is stale
+    ivec2 size = min(ivec2(ceil(resolve.viewport.xy)), textureExtent);
+    vec4 current = texelFetch(sampler2D(textures2D[draw.textureIndex], samplers[draw.samplerIndex]), pixel, 0);
+    if (current.a < 0.0 || resolve.params.z == 0.0) {
+        outColor = current;
+        return;
+    }
+
+    // Neighbourhood of the current frame, misses don't bound the color
+    vec3 minColor = current.rgb;
+    vec3 maxColor = current.rgb;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            ivec2 coord = clamp(pixel + ivec2(x, y), ivec2(0), size - 1);
+            vec4 neighbour = texelFetch(sampler2D(textures2D[draw.textureIndex], samplers[draw.samplerIndex]), coord, 0);
+            if (neighbour.a >= 0.0) {
+                minColor = min(minColor, neighbour.rgb);
+                maxColor = max(maxColor, neighbour.rgb);
+            }
+        }
+    }
+
+    vec3 origin = resolve.worldCamera.xyz;
+    vec3 rayDir = normalize(worldPosition - origin);
+    vec3 entryPoint = origin + rayDir * current.a;
+    vec4 previousClip = ubo.previousViewProj * vec4(entryPoint, 1.0);
+    vec2 previousUv = previousClip.xy / previousClip.w * 0.5 + 0.5;
+
+    uint historyIndex = uint(resolve.params.x);
+    bool offScreen = previousClip.w <= 0.0 || any(lessThan(previousUv, vec2(0.0))) || any(greaterThan(previousUv, vec2(1.0)));
+    // the history was rendered at the scale of last frame, in the corner of the same size target
+    vec2 historyUv = min(previousUv * resolve.viewport.zw, resolve.viewport.zw - 0.5) / vec2(textureExtent);
+    vec4 history = texture(sampler2D(textures2D[historyIndex], samplers[draw.samplerIndex]), historyUv);
+    if (offScreen || history.a < 0.0) {
+        outColor = current;
+        return;
+    }
+
+    vec3 clampedHistory = clamp(history.rgb, minColor, maxColor);
+    outColor.rgb = mix(clampedHistory, current.rgb, resolve.params.y);
+    // the upsample needs the entry distance of this frame
+    outColor.a = current.a;
+}
@@ -1,10 +1,14 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
+#extension GL_GOOGLE_include_directive : require
 
 /* --------------------------- Varying --------------------------- */
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec3 fragTexCoord;
 layout(location = 2) in vec3 worldPosition;
+// vec4 index of the object data, from the draw object
+layout(location = 4) flat in uint objectData;
 
 layout(location = 0) out vec4 outColor;
 
@@ -17,65 +21,63 @@ layout(set = 0, binding = 0) uniform UniformBufferObject {
     float time;
 } ubo;
 
-layout(set = 1, binding = 1) uniform sampler3D texSampler3D;
-
-layout(set = 1, binding = 3) uniform CloudData {
-    vec4 worldCamera;
-    vec4 worldLightPos;
-    vec4 bboxMin;
-    vec4 bboxMax;
-    vec4 lightColor;
-    vec4 lightAbsorption;
-    vec4 densityTreshold;
-    vec4 phaseParams;
-    vec4 fogSpeed;
-    float fogDensity;
-} cloud;
+// Uniform arena, the object data starts at objectData
+layout(set = 0, binding = 1) readonly buffer ObjectData {
+    vec4 data[];
+} objects;
 
-/* --------------------------- Defines --------------------------- */
-
-float nbSamples = 128.0;
-float nbLightSamples = 58.0;
-float darknessThreshold = 0.05;
-
-// Returns (dstToBox, dstInsideBox). If ray misses box, dstInsideBox will be zero
-vec2 rayBoxDist(vec3 bboxMin, vec3 bboxMax, vec3 origin, vec3 invRaydir) {
-    // Adapted from: http://jcgt.org/published/0007/03/04/
-    vec3 t0 = (bboxMin - origin) * invRaydir;
-    vec3 t1 = (bboxMax - origin) * invRaydir;
-    vec3 tmin = min(t0, t1);
-    vec3 tmax = max(t0, t1);
-    
-    float dstA = max(max(tmin.x, tmin.y), tmin.z);
-    float dstB = min(tmax.x, min(tmax.y, tmax.z));
+// Bindless resources
+layout(set = 1, binding = 0) uniform texture2D textures2D[];
+layout(set = 1, binding = 1) uniform texture3D textures3D[];
+layout(set = 1, binding = 2) uniform sampler samplers[];
 
-    // CASE 1: ray intersects box from outside (0 <= dstA <= dstB)
-    // dstA is dst to nearest intersection, dstB dst to far intersection
+layout(push_constant) uniform DrawConstants {
+    uint objectIndex;
+    uint textureIndex;
+    uint samplerIndex;
+    uint bufferIndex;
+} draw;
 
-    // CASE 2: ray intersects box from inside (dstA < 0 < dstB)
-    // dstA is the dst to intersection behind the ray, dstB is dst to forward intersection
+#include "cloud_common.glsl"
 
-    // CASE 3: ray misses box (dstA > dstB)
+/* --------------------------- Defines --------------------------- */
 
-    float dstToBox = max(0, dstA);
-    float dstInsideBox = max(0, dstB - dstToBox);
-    return vec2(dstToBox, dstInsideBox);
+// Quality tier, specialized per pipeline variant by FogMaterial
+// most samples taken by a primary ray
+layout(constant_id = 0) const int nbSamples = 128;
+// light samples across the box for a fully visible sample
+layout(constant_id = 1) const float nbLightSamples = 58.0;
+// lowest shadow term, keeps the core of the cloud from going black
+layout(constant_id = 2) const float darknessThreshold = 0.05;
+
+// fine samples without density before going back to coarse steps
+const int emptySamplesBeforeCoarse = 3;
+
+/*
+    Start offset of the ray in [0, 1[ steps. The blue noise spreads the banding into a fine
+    pattern and the golden ratio sequence moves it every frame, the history averages it out
+*/
+float rayJitter()
+{
+    if (cloud.raymarchParams.w == 0.0) {
+        return 0.0;
+    }
+    uint blueNoiseIndex = uint(cloud.raymarchParams.y);
+    ivec2 pixel = ivec2(gl_FragCoord.xy) & 63;
+    float noise = texelFetch(sampler2D(textures2D[blueNoiseIndex], samplers[draw.samplerIndex]), pixel, 0).r;
+    return fract(noise + cloud.raymarchParams.z * 0.61803398875);
 }
 
-float sample3DTexture(vec3 pos)
+// the step grows as the transmittance of the primary ray drops, the weight keeps the optical depth
+float lightDepth(vec3 position, float transmittance)
 {
-    //[-0.5, 0.5] -> [-1; 1]  -> [0; 2] -> [0; 1]
-    pos = (pos * 2.0 + 1.0) / 2.0;
-    float speed = 0.12;
-    // Change depth value for adding a scrolling effect
-    pos.z += cloud.fogSpeed.x * ubo.time;
-    pos.z = mod(pos.z, 1.0);
-    float noiseValue = texture(texSampler3D, pos).r;
-    return noiseValue;
+    float lightSamples = max(nbLightSamples * transmittance, min(cloud.marchParams.w, nbLightSamples));
+    return lightMarch(position, cloud.worldLightPos.xyz, lightSamples, nbLightSamples / lightSamples);
 }
 
 void main() {
 
+    cloud = loadCloudData(objectData);
     vec3 origin = cloud.worldCamera.xyz;
     vec3 rayDir = worldPosition - origin;
     rayDir = normalize(rayDir);
@@ -97,57 +99,67 @@ void main() {
 
     // March through volume:
     vec3 currentPosition;
-    float distTravelled = 0.0;
     float transmittance = 1.0;
-    vec3 lightDir;
-    float stepSize = 1.0 / nbSamples;
+    // the tier caps the steps requested by the menu
+    float stepSize = 1.0 / min(cloud.raymarchParams.x, float(nbSamples));
     float accumulation = 0.0;
-    float lightStepSize = 1.0 / nbLightSamples; 
 
-    while (distTravelled < totalDistance) {
+    // Large steps until some density is found, then step back and march finely
+    float coarseStepSize = stepSize * max(cloud.marchParams.y, 1.0);
+    bool coarse = coarseStepSize > stepSize;
+    int emptySamples = 0;
+    float distTravelled = rayJitter() * (coarse ? coarseStepSize : stepSize);
+
+    // every fine step across the ray, and the ones marched again after stepping back from a coarse step
+    int maxSamples = (int(ceil(totalDistance / stepSize)) + 1) * (2 + int(ceil(cloud.marchParams.y)));
+    for (int i = 0; i < maxSamples && distTravelled < totalDistance; i++) {
         currentPosition = firstPoint + rayDir * distTravelled;
         float density = cloud.phaseParams.x * sample3DTexture(currentPosition);
-
-        float shadowValue = 0.0;
-        lightDir = normalize(cloud.worldLightPos.xyz - currentPosition);
-        vec3 invLightDir = 1.0 / lightDir;
-        vec2 lightBoxDistance = rayBoxDist(cloud.bboxMin.xyz, cloud.bboxMax.xyz, currentPosition, invLightDir);
-        vec3 lightSamplePoint = currentPosition;
-        vec3 lightStepVector = lightDir * lightStepSize;
-        vec3 lightLastPoint = currentPosition + lightDir * lightBoxDistance.y;
-        float lightDistanceToTravel = length(lightLastPoint - currentPosition);
-        float lightDistanceTravelled = 0.0;
-
-        //if (density > cloud.densityTreshold.x) {
-            while (lightDistanceTravelled < lightDistanceToTravel) {
-                float lsample = 1.0;
-                float maxCoord = max(max(abs(lightSamplePoint.x), abs(lightSamplePoint.y)), abs(lightSamplePoint.z));
-                bool outSideBox = (maxCoord > 1.0);
-                if(!outSideBox){
-                    //float lsample = cloud.phaseParams.x * sample3DTexture(lightSamplePoint);
-                    //shadowDist += lsample > cloud.phaseParams.y ? lsample : 0.0;
-
-                    lsample = sample3DTexture(lightSamplePoint);
-                }
-                shadowValue += lsample;
-                lightDistanceTravelled += lightStepSize;
-                lightSamplePoint += lightStepVector;
+        bool empty = density <= cloud.marchParams.z;
+
+        if (coarse) {
+            if (!empty) {
+                // the cloud started somewhere in the last coarse step
+                // the whole stepped back range is marched finely before going coarse again
+                coarse = false;
+                emptySamples = -int(ceil(cloud.marchParams.y));
+                distTravelled = max(distTravelled - coarseStepSize + stepSize, 0.0);
+                continue;
             }
-
-            float shadowTerm = exp(-shadowValue * cloud.lightAbsorption.x);
-            float curdensity = density * stepSize;
-            float absorbedLight = shadowTerm * curdensity;
-            accumulation += absorbedLight * transmittance;
-            //transmittance *= exp(-density * stepSize / cloud.fogDensity);
-            transmittance *= 1.0 - curdensity;
-        //}
-
+            distTravelled += coarseStepSize;
+            continue;
+        }
+
+        if (empty) {
+            // back to coarse steps after a few fine samples without density
+            emptySamples++;
+            if (emptySamples >= emptySamplesBeforeCoarse && coarseStepSize > stepSize) {
+                coarse = true;
+            }
+            distTravelled += stepSize;
+            continue;
+        }
+        emptySamples = 0;
+
+        float shadowTerm = exp(-lightDepth(currentPosition, transmittance) * cloud.lightAbsorption.x);
+        shadowTerm = darknessThreshold + shadowTerm * (1.0 - darknessThreshold);
+        float curdensity = density * stepSize;
+        float absorbedLight = shadowTerm * curdensity;
+        accumulation += absorbedLight * transmittance;
+        //transmittance *= exp(-density * stepSize / cloud.fogDensity);
+        transmittance *= max(1.0 - curdensity, 0.0);
+
+        // nothing behind can be seen anymore
+        if (transmittance < cloud.marchParams.x) {
+            break;
+        }
         distTravelled += stepSize;
     }
 
 
     outColor.xyz = cloud.lightColor.xyz * accumulation;
-    outColor.a = 1.0;
+    // entry distance, the depth guide of the upsample (cleared to -1 where the box is missed)
+    outColor.a = boxDistance.x;
 
     /*while (distTravelled < totalDistance) {
         currentPosition = firstPoint + rayDir * distTravelled;
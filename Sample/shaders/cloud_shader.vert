@@ -1,12 +1,16 @@
 #version 450
+#extension GL_ARB_shader_draw_parameters : require
+#extension GL_GOOGLE_include_directive : require
 
+// the color at location 1 is not read, meshes with a single color leave it out of the packed layout
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragTexCoord;
 layout(location = 2) out vec3 worldPosition;
+// vec4 index of the shader data of the object, read by the fragment shaders
+layout(location = 4) flat out uint objectData;
 
 layout(set = 0, binding = 0) uniform UniformBufferObject {
     mat4 model;
@@ -15,26 +19,32 @@ layout(set = 0, binding = 0) uniform UniformBufferObject {
     float time;
 } ubo;
 
-layout(set = 1, binding = 3) uniform CloudData {
-    vec4 worldCamera;
-    vec4 worldLightPos;
-    vec4 bboxMin;
-    vec4 bboxMax;
-    vec4 lightColor;
-    vec4 lightAbsorption;
-    vec4 densityTreshold;
-    vec4 phaseParams;
-    vec4 fogSpeed;
-    float fogDensity;
-} cloud;
+// Uniform arena, the draw objects start at draw.objectIndex
+layout(set = 0, binding = 1) readonly buffer ObjectData {
+    vec4 data[];
+} objects;
+
+// Same layout as DrawConstants
+layout(push_constant) uniform DrawConstants {
+    uint objectIndex;
+    uint textureIndex;
+    uint samplerIndex;
+    uint bufferIndex;
+} draw;
+
+#include "draw_object.glsl"
 
 void main() {
+    DrawObject object = loadDrawObject();
+    objectData = object.data.x;
+    vec3 position = decodePosition(object, inPosition);
 	//[-0.5, 0.5] -> [-1; 1]  -> [0; 2] -> [0; 1]
-	vec3 texturePos = (inPosition * 2.0 + 1.0) / 2.0;
-    fragColor = inColor;
+	vec3 texturePos = (position * 2.0 + 1.0) / 2.0;
+    fragColor = vec3(1.0);
     fragTexCoord = vec3(texturePos.x, texturePos.z, texturePos.y);
-    worldPosition = inPosition;
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    worldPosition = position;
+    // the marching stays in the space of the mesh, the transform only places the box
+    gl_Position = ubo.proj * ubo.view * ubo.model * object.transform * vec4(position, 1.0);
     // Vulkan window space y point downward
     //gl_Position.y = -gl_Position.y;
 }
\ No newline at end of file
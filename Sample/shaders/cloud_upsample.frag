@@ -0,0 +1,107 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+/* --------------------------- Varying --------------------------- */
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragTexCoord;
+layout(location = 2) in vec3 worldPosition;
+// vec4 index of the object data, from the draw object
+layout(location = 4) flat in uint objectData;
+
+layout(location = 0) out vec4 outColor;
+
+/* --------------------------- Uniforms --------------------------- */
+
+// Uniform arena, the object data starts at objectData
+layout(set = 0, binding = 1) readonly buffer ObjectData {
+    vec4 data[];
+} objects;
+
+// Bindless resources
+layout(set = 1, binding = 0) uniform texture2D textures2D[];
+layout(set = 1, binding = 2) uniform sampler samplers[];
+
+layout(push_constant) uniform DrawConstants {
+    uint objectIndex;
+    uint textureIndex;
+    uint samplerIndex;
+    uint bufferIndex;
+} draw;
+
+// Same layout as FogUpsampleMaterial::UpsampleData
+struct UpsampleData {
+    vec4 worldCamera;
+    vec4 bboxMin;
+    vec4 bboxMax;
+    vec4 params;
+};
+
+UpsampleData loadUpsampleData(uint index)
+{
+    UpsampleData result;
+    result.worldCamera = objects.data[index];
+    result.bboxMin = objects.data[index + 1];
+    result.bboxMax = objects.data[index + 2];
+    result.params = objects.data[index + 3];
+    return result;
+}
+
+// Returns (dstToBox, dstInsideBox), same as the fog shader
+vec2 rayBoxDist(vec3 bboxMin, vec3 bboxMax, vec3 origin, vec3 invRaydir) {
+    vec3 t0 = (bboxMin - origin) * invRaydir;
+    vec3 t1 = (bboxMax - origin) * invRaydir;
+    vec3 tmin = min(t0, t1);
+    vec3 tmax = max(t0, t1);
+
+    float dstA = max(max(tmin.x, tmin.y), tmin.z);
+    float dstB = min(tmax.x, min(tmax.y, tmax.z));
+
+    float dstToBox = max(0, dstA);
+    float dstInsideBox = max(0, dstB - dstToBox);
+    return vec2(dstToBox, dstInsideBox);
+}
+
+/*
+    Joint bilateral upsample: the 4 low resolution texels around the pixel are weighted
+    bilinearly and by how close their entry distance is to the one of the full resolution ray,
+    so the fog doesn't bleed over the edges of the box
+*/
+void main() {
+    UpsampleData upsample = loadUpsampleData(objectData);
+    vec3 origin = upsample.worldCamera.xyz;
+    vec3 rayDir = normalize(worldPosition - origin);
+    vec2 boxDistance = rayBoxDist(upsample.bboxMin.xyz, upsample.bboxMax.xyz, origin, vec3(1.0) / rayDir);
+    if (boxDistance.y <= 0) {
+        discard;
+    }
+
+    float divisor = upsample.params.x;
+    float depthSigma = upsample.params.y;
+    // only the corner rendered at the current scale holds fog
+    ivec2 lowSize = min(ivec2(upsample.params.zw), textureSize(sampler2D(textures2D[draw.textureIndex], samplers[draw.samplerIndex]), 0));
+
+    // texel centers of the low resolution target
+    vec2 lowPosition = gl_FragCoord.xy / divisor - 0.5;
+    ivec2 base = ivec2(floor(lowPosition));
+    vec2 f = fract(lowPosition);
+
+    vec3 color = vec3(0.0);
+    float totalWeight = 0.0;
+    for (int i = 0; i < 4; i++) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 coord = clamp(base + offset, ivec2(0), lowSize - 1);
+        vec4 lowSample = texelFetch(sampler2D(textures2D[draw.textureIndex], samplers[draw.samplerIndex]), coord, 0);
+        // missed the box at low resolution
+        if (lowSample.a < 0.0) {
+            continue;
+        }
+        vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+        float weight = bilinear.x * bilinear.y * exp(-abs(lowSample.a - boxDistance.x) / depthSigma) + 1e-4;
+        color += lowSample.rgb * weight;
+        totalWeight += weight;
+    }
+
+    outColor.rgb = totalWeight > 0.0 ? color / totalWeight : vec3(0.0);
+    outColor.a = 1.0;
+}
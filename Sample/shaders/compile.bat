@@ -2,4 +2,14 @@ C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe texture_shader.vert -o texture_vert.spv
 C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe texture_shader.frag -o texture_frag.spv
 C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe cloud_shader.vert -o cloud_vert.spv
 C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe cloud_shader.frag -o cloud_frag.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe cloud_upsample.frag -o cloud_upsample_frag.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe cloud_resolve.frag -o cloud_resolve_frag.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe cloud_march.comp -o cloud_march_comp.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe froxel_inject.comp -o froxel_inject_comp.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe froxel_integrate.comp -o froxel_integrate_comp.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe froxel_composite.frag -o froxel_composite_frag.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe cloud_field.vert -o cloud_field_vert.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe cloud_field.frag -o cloud_field_frag.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe scene_cull.comp -o scene_cull_comp.spv
+C:/VulkanSDK/1.2.189.2/Bin32/glslc.exe cluster_cull.comp -o cluster_cull_comp.spv
 pause
\ No newline at end of file
@@ -0,0 +1,40 @@
+/*
+    Per object data of the scene draws. The draws of a bucket share their push constants, each
+    indirect command carries its object as first instance and draw.objectIndex is the vec4 index
+    of the records of every object, in scene order.
+    Included after the declarations of objects and draw, with GL_ARB_shader_draw_parameters
+*/
+
+// Same layout as SceneStore::DrawObject
+struct DrawObject {
+    // x: vec4 index of the shader data of the object, y: first entry of its visible instances
+    uvec4 data;
+    // Mesh::positionDecode of the drawn mesh
+    vec4 positionOffset;
+    vec4 positionScale;
+    // placed under the model matrix
+    mat4 transform;
+};
+
+DrawObject loadDrawObject()
+{
+    uint index = draw.objectIndex + uint(gl_BaseInstanceARB) * 7;
+    DrawObject result;
+    result.data = floatBitsToUint(objects.data[index]);
+    result.positionOffset = objects.data[index + 1];
+    result.positionScale = objects.data[index + 2];
+    result.transform = mat4(objects.data[index + 3], objects.data[index + 4], objects.data[index + 5], objects.data[index + 6]);
+    return result;
+}
+
+// Instance inside the draw, gl_InstanceIndex starts at the first instance
+uint drawInstanceIndex()
+{
+    return uint(gl_InstanceIndex - gl_BaseInstanceARB);
+}
+
+// packed positions are stored inside the mesh bounds
+vec3 decodePosition(DrawObject object, vec3 position)
+{
+    return object.positionOffset.xyz + position * object.positionScale.xyz;
+}
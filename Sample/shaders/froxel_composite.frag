@@ -0,0 +1,90 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+/* --------------------------- Varying --------------------------- */
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragTexCoord;
+layout(location = 2) in vec3 worldPosition;
+// vec4 index of the object data, from the draw object
+layout(location = 4) flat in uint objectData;
+
+layout(location = 0) out vec4 outColor;
+
+/* --------------------------- Uniforms --------------------------- */
+
+// Uniform arena, the object data starts at objectData
+layout(set = 0, binding = 1) readonly buffer ObjectData {
+    vec4 data[];
+} objects;
+
+// Bindless resources
+layout(set = 1, binding = 1) uniform texture3D textures3D[];
+layout(set = 1, binding = 2) uniform sampler samplers[];
+
+layout(push_constant) uniform DrawConstants {
+    uint objectIndex;
+    uint textureIndex;
+    uint samplerIndex;
+    uint bufferIndex;
+} draw;
+
+// Same layout as FroxelCompositeMaterial::CompositeData
+struct CompositeData {
+    vec4 worldCamera;
+    vec4 bboxMin;
+    vec4 bboxMax;
+    vec4 depthRange;
+    vec4 screen;
+};
+
+CompositeData loadCompositeData(uint index)
+{
+    CompositeData result;
+    result.worldCamera = objects.data[index];
+    result.bboxMin = objects.data[index + 1];
+    result.bboxMax = objects.data[index + 2];
+    result.depthRange = objects.data[index + 3];
+    result.screen = objects.data[index + 4];
+    return result;
+}
+
+// Returns (dstToBox, dstInsideBox), same as the fog shader
+vec2 rayBoxDist(vec3 bboxMin, vec3 bboxMax, vec3 origin, vec3 invRaydir) {
+    vec3 t0 = (bboxMin - origin) * invRaydir;
+    vec3 t1 = (bboxMax - origin) * invRaydir;
+    vec3 tmin = min(t0, t1);
+    vec3 tmax = max(t0, t1);
+
+    float dstA = max(max(tmin.x, tmin.y), tmin.z);
+    float dstB = min(tmax.x, min(tmax.y, tmax.z));
+
+    float dstToBox = max(0, dstA);
+    float dstInsideBox = max(0, dstB - dstToBox);
+    return vec2(dstToBox, dstInsideBox);
+}
+
+/*
+    The integrated volume holds the fog from the camera to the far end of each slice,
+    the pixel only needs the value where its ray leaves the box
+*/
+void main() {
+    CompositeData composite = loadCompositeData(objectData);
+    vec3 origin = composite.worldCamera.xyz;
+    vec3 rayDir = normalize(worldPosition - origin);
+    vec2 boxDistance = rayBoxDist(composite.bboxMin.xyz, composite.bboxMax.xyz, origin, vec3(1.0) / rayDir);
+    if (boxDistance.y <= 0) {
+        discard;
+    }
+
+    // slice i ends at near + (i + 1) * length and its texel center is at (i + 0.5) / count
+    float exitDistance = boxDistance.x + boxDistance.y;
+    float sliceCount = composite.depthRange.z;
+    float slice = (exitDistance - composite.depthRange.x) / (composite.depthRange.y - composite.depthRange.x) * sliceCount;
+    vec3 uvw = vec3(gl_FragCoord.xy / composite.screen.xy, (slice - 0.5) / sliceCount);
+    vec4 integrated = texture(sampler3D(textures3D[draw.textureIndex], samplers[draw.samplerIndex]), uvw);
+
+    // opaque like the upsample of the raymarched fog
+    outColor.rgb = integrated.rgb;
+    outColor.a = 1.0;
+}
@@ -1,6 +1,16 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
-layout(set = 1, binding = 1) uniform sampler2D texSampler;
+// Bindless resources
+layout(set = 1, binding = 0) uniform texture2D textures2D[];
+layout(set = 1, binding = 2) uniform sampler samplers[];
+
+layout(push_constant) uniform DrawConstants {
+    uint objectIndex;
+    uint textureIndex;
+    uint samplerIndex;
+    uint bufferIndex;
+} draw;
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
@@ -8,6 +18,6 @@ layout(location = 1) in vec2 fragTexCoord;
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = texture(texSampler, fragTexCoord);
+    outColor = texture(sampler2D(textures2D[draw.textureIndex], samplers[draw.samplerIndex]), fragTexCoord);
     //outColor = vec4(fragTexCoord.x, fragTexCoord.y, 0.0, 1.0);
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #version 450
+#extension GL_ARB_shader_draw_parameters : require
+#extension GL_GOOGLE_include_directive : require
 
+// the color at location 1 is not read, meshes with a single color leave it out of the packed layout
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
 
 layout(location = 0) out vec3 fragColor;
@@ -14,8 +16,24 @@ layout(set = 0, binding = 0) uniform UniformBufferObject {
     float time;
 } ubo;
 
+// Uniform arena, the draw objects start at draw.objectIndex
+layout(set = 0, binding = 1) readonly buffer ObjectData {
+    vec4 data[];
+} objects;
+
+// Same layout as DrawConstants
+layout(push_constant) uniform DrawConstants {
+    uint objectIndex;
+    uint textureIndex;
+    uint samplerIndex;
+    uint bufferIndex;
+} draw;
+
+#include "draw_object.glsl"
+
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-    fragColor = inColor;
+    DrawObject object = loadDrawObject();
+    gl_Position = ubo.proj * ubo.view * ubo.model * object.transform * vec4(decodePosition(object, inPosition), 1.0);
+    fragColor = vec3(1.0);
     fragTexCoord = inTexCoord;
-}
\ No newline at end of file
+}
@@ -1,12 +1,15 @@
 #include "FogMenu.h"
 
 #include <iostream>
+#include <cstdio>
+#include <cfloat>
 #include <glm/gtc/quaternion.hpp> 
 
 /* --------------------------------- Constructors --------------------------------- */
 
 FogMenu::FogMenu(ViewParams& viewParams):
     m_viewParams(viewParams),
+    m_gpuProfiler(nullptr),
     m_fogScale(viewParams.fogScale()),
     m_noiseSize(viewParams.noiseSize()),
     m_randomSeed(viewParams.randomSeed()),
@@ -89,6 +92,7 @@ void FogMenu::initialize(Window* window, RenderContext& renderContext, VkRenderP
 
 void FogMenu::draw(RenderContext& renderContext)
 {
+    CPU_ZONE("FogMenu::draw");
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -113,12 +117,80 @@ void FogMenu::draw(RenderContext& renderContext)
     ImGui::SliderFloat("Phase Offset", &m_phaseOffset, 0.0f, 1.0f);
     ImGui::ColorEdit4("Sun color", (float*)&m_lightColor); // Edit 3 floats representing a color
 
+    // the engine rebuilds the volumetric target when the divisor changes
+    const char* resolutions[] = { "Full", "Half", "Quarter" };
+    const uint32_t divisors[] = { 1, 2, 4 };
+    int resolution = m_viewParams.volumetricDivisor() == 4 ? 2 : m_viewParams.volumetricDivisor() == 2 ? 1 : 0;
+    if (ImGui::Combo("Fog Resolution", &resolution, resolutions, IM_ARRAYSIZE(resolutions))) {
+        m_viewParams.setVolumetricDivisor(divisors[resolution]);
+    }
+    // the engine rebuilds the graph when the path changes
+    const char* fogPaths[] = { "Raster", "Compute Tiles", "Froxels" };
+    int fogPath = static_cast<int>(m_viewParams.fogPath());
+    if (ImGui::Combo("Fog Path", &fogPath, fogPaths, IM_ARRAYSIZE(fogPaths))) {
+        m_viewParams.setFogPath(static_cast<FogPath>(fogPath));
+    }
+    bool cloudField = m_viewParams.cloudField();
+    if (ImGui::Checkbox("Cloud Field", &cloudField)) {
+        m_viewParams.setCloudField(cloudField);
+    }
+    bool vikingRoom = m_viewParams.vikingRoom();
+    if (ImGui::Checkbox("Viking Room", &vikingRoom)) {
+        m_viewParams.setVikingRoom(vikingRoom);
+    }
+    bool dynamicResolution = m_viewParams.dynamicResolution();
+    if (ImGui::Checkbox("Dynamic Resolution", &dynamicResolution)) {
+        m_viewParams.setDynamicResolution(dynamicResolution);
+    }
+    if (dynamicResolution) {
+        float targetFrameTime = m_viewParams.targetFrameTime();
+        if (ImGui::SliderFloat("Target GPU ms", &targetFrameTime, 4.0f, 50.0f)) {
+            m_viewParams.setTargetFrameTime(targetFrameTime);
+        }
+        bool dynamicSteps = m_viewParams.dynamicSteps();
+        if (ImGui::Checkbox("Scale Ray Steps", &dynamicSteps)) {
+            m_viewParams.setDynamicSteps(dynamicSteps);
+        }
+        ImGui::Text("Render scale %.2f, step scale %.2f", m_viewParams.renderScale(), m_viewParams.stepScale());
+    }
+    bool temporalFog = m_viewParams.temporalFog();
+    if (ImGui::Checkbox("Temporal Accumulation", &temporalFog)) {
+        m_viewParams.setTemporalFog(temporalFog);
+    }
+    const char* qualities[] = { "Low", "Medium", "High", "Ultra" };
+    int quality = static_cast<int>(m_viewParams.fogQuality());
+    if (ImGui::Combo("Fog Quality", &quality, qualities, IM_ARRAYSIZE(qualities))) {
+        m_viewParams.setFogQuality(static_cast<uint32_t>(quality));
+    }
+    int raymarchSteps = static_cast<int>(m_viewParams.raymarchSteps());
+    if (ImGui::SliderInt("Ray Steps", &raymarchSteps, 8, 128)) {
+        m_viewParams.setRaymarchSteps(static_cast<uint32_t>(raymarchSteps));
+    }
+    float transmittanceCutoff = m_viewParams.transmittanceCutoff();
+    if (ImGui::SliderFloat("Transmittance Cutoff", &transmittanceCutoff, 0.0f, 0.2f)) {
+        m_viewParams.setTransmittanceCutoff(transmittanceCutoff);
+    }
+    float emptyStepScale = m_viewParams.emptyStepScale();
+    if (ImGui::SliderFloat("Empty Step Scale", &emptyStepScale, 1.0f, 8.0f)) {
+        m_viewParams.setEmptyStepScale(emptyStepScale);
+    }
+    float emptyDensity = m_viewParams.emptyDensity();
+    if (ImGui::SliderFloat("Empty Density", &emptyDensity, 0.0f, 0.3f)) {
+        m_viewParams.setEmptyDensity(emptyDensity);
+    }
+    int minLightSteps = static_cast<int>(m_viewParams.minLightSteps());
+    if (ImGui::SliderInt("Min Light Steps", &minLightSteps, 1, 58)) {
+        m_viewParams.setMinLightSteps(static_cast<uint32_t>(minLightSteps));
+    }
+
     //if (ImGui::Button("Button"))  // Buttons return true when clicked (most widgets return true when edited/activated)
     //    counter++;
     //ImGui::SameLine();
 
     ImGui::NewLine();
     ImGui::Text("Performance: %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    drawGpuProfiler();
+    drawCpuProfiler();
     ImGui::End();
 
     ImGui::Render();
@@ -139,4 +211,59 @@ void FogMenu::cleanUp(RenderContext& renderContext)
     vkDestroyDescriptorPool(renderContext.device(), m_imGUIPool, nullptr);
     ImGui_ImplVulkan_Shutdown();
     ImGui_ImplGlfw_Shutdown();
+}
+
+void FogMenu::setGpuProfiler(GpuProfiler* gpuProfiler)
+{
+    m_gpuProfiler = gpuProfiler;
+}
+
+/* --------------------------------- Private Methods --------------------------------- */
+
+void FogMenu::drawGpuProfiler()
+{
+    if (!m_gpuProfiler || !m_gpuProfiler->isEnabled()) {
+        return;
+    }
+    if (!ImGui::CollapsingHeader("GPU Profiler")) {
+        return;
+    }
+
+    for (auto& scopeHistory : m_gpuProfiler->histories()) {
+        if (scopeHistory.count == 0) {
+            continue;
+        }
+        // head is the oldest sample once the ring is full
+        uint32_t last = (scopeHistory.head + GpuProfiler::historySize - 1) % GpuProfiler::historySize;
+        const GpuProfiler::Sample& sample = scopeHistory.samples[last];
+        char overlay[32];
+        snprintf(overlay, sizeof(overlay), "%.3f ms", sample.milliseconds);
+        ImGui::PlotLines(scopeHistory.name.c_str(), scopeHistory.timings.data(), GpuProfiler::historySize, scopeHistory.head, overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+        if (sample.vertexInvocations > 0 || sample.fragmentInvocations > 0) {
+            ImGui::Text("  %llu vertex, %llu fragment invocations", (unsigned long long)sample.vertexInvocations, (unsigned long long)sample.fragmentInvocations);
+        }
+    }
+
+    bool drawScopes = m_gpuProfiler->drawScopes();
+    if (ImGui::Checkbox("Per-draw scopes", &drawScopes)) {
+        m_gpuProfiler->setDrawScopes(drawScopes);
+    }
+    if (ImGui::Button("Export CSV")) {
+        m_gpuProfiler->exportCSV("gpu_profile.csv");
+    }
+}
+
+void FogMenu::drawCpuProfiler()
+{
+    if (!ImGui::CollapsingHeader("CPU Profiler")) {
+        return;
+    }
+
+    bool enabled = CpuProfiler::isEnabled();
+    if (ImGui::Checkbox("Record zones", &enabled)) {
+        CpuProfiler::setEnabled(enabled);
+    }
+    if (ImGui::Button("Export Chrome trace")) {
+        CpuProfiler::exportChromeTrace("cpu_trace.json");
+    }
 }
\ No newline at end of file
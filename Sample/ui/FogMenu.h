@@ -9,6 +9,8 @@
 #include <imgui/imgui_impl_vulkan.h>
 
 #include <core/RenderContext.h>
+#include <core/GpuProfiler.h>
+#include <core/CpuProfiler.h>
 #include <core/Window.h>
 
 class FogMenu
@@ -22,10 +24,16 @@ public:
     void draw(RenderContext& renderContext);
     void fillCommandBuffer(VkCommandBuffer& cmdBuffer);
     void cleanUp(RenderContext& renderContext);
+    void setGpuProfiler(GpuProfiler* gpuProfiler);
+
+private:
+    void drawGpuProfiler();
+    void drawCpuProfiler();
 
 private:
     VkDescriptorPool m_imGUIPool;
     ViewParams& m_viewParams;
+    GpuProfiler* m_gpuProfiler;
 
 public:
     float m_fogScale;
@@ -15,6 +15,22 @@ ViewParams::ViewParams():
     m_outScatering(0.5f),
     m_phaseFactor(0.519f),
     m_phaseOffset(0.663f),
+    m_volumetricDivisor(2),
+    m_dynamicResolution(false),
+    m_targetFrameTime(16.6f),
+    m_dynamicSteps(false),
+    m_renderScale(1.0f),
+    m_stepScale(1.0f),
+    m_fogPath(FogPath::Raster),
+    m_cloudField(false),
+    m_vikingRoom(true),
+    m_temporalFog(true),
+    m_fogQuality(2),
+    m_raymarchSteps(16),
+    m_transmittanceCutoff(0.01f),
+    m_emptyStepScale(4.0f),
+    m_emptyDensity(0.05f),
+    m_minLightSteps(8),
     m_fogScaleChanged(false),
     m_noiseSizeChanged(false),
     m_randomSeedChanged(false),
@@ -163,6 +179,166 @@ float ViewParams::phaseOffset() const
     return m_phaseOffset;
 }
 
+uint32_t ViewParams::volumetricDivisor() const
+{
+    return m_volumetricDivisor;
+}
+
+void ViewParams::setVolumetricDivisor(uint32_t divisor)
+{
+    m_volumetricDivisor = divisor;
+}
+
+bool ViewParams::dynamicResolution() const
+{
+    return m_dynamicResolution;
+}
+
+void ViewParams::setDynamicResolution(bool enabled)
+{
+    m_dynamicResolution = enabled;
+}
+
+float ViewParams::targetFrameTime() const
+{
+    return m_targetFrameTime;
+}
+
+void ViewParams::setTargetFrameTime(float milliseconds)
+{
+    m_targetFrameTime = milliseconds;
+}
+
+bool ViewParams::dynamicSteps() const
+{
+    return m_dynamicSteps;
+}
+
+void ViewParams::setDynamicSteps(bool enabled)
+{
+    m_dynamicSteps = enabled;
+}
+
+float ViewParams::renderScale() const
+{
+    return m_renderScale;
+}
+
+void ViewParams::setRenderScale(float scale)
+{
+    m_renderScale = scale;
+}
+
+float ViewParams::stepScale() const
+{
+    return m_stepScale;
+}
+
+void ViewParams::setStepScale(float scale)
+{
+    m_stepScale = scale;
+}
+
+FogPath ViewParams::fogPath() const
+{
+    return m_fogPath;
+}
+
+void ViewParams::setFogPath(FogPath path)
+{
+    m_fogPath = path < FogPath::Count ? path : FogPath::Raster;
+}
+
+bool ViewParams::cloudField() const
+{
+    return m_cloudField;
+}
+
+void ViewParams::setCloudField(bool enabled)
+{
+    m_cloudField = enabled;
+}
+
+bool ViewParams::vikingRoom() const
+{
+    return m_vikingRoom;
+}
+
+void ViewParams::setVikingRoom(bool enabled)
+{
+    m_vikingRoom = enabled;
+}
+
+bool ViewParams::temporalFog() const
+{
+    return m_temporalFog;
+}
+
+void ViewParams::setTemporalFog(bool enabled)
+{
+    m_temporalFog = enabled;
+}
+
+uint32_t ViewParams::fogQuality() const
+{
+    return m_fogQuality;
+}
+
+void ViewParams::setFogQuality(uint32_t quality)
+{
+    m_fogQuality = quality;
+}
+
+uint32_t ViewParams::raymarchSteps() const
+{
+    return m_raymarchSteps;
+}
+
+void ViewParams::setRaymarchSteps(uint32_t steps)
+{
+    m_raymarchSteps = steps;
+}
+
+float ViewParams::transmittanceCutoff() const
+{
+    return m_transmittanceCutoff;
+}
+
+void ViewParams::setTransmittanceCutoff(float cutoff)
+{
+    m_transmittanceCutoff = cutoff;
+}
+
+float ViewParams::emptyStepScale() const
+{
+    return m_emptyStepScale;
+}
+
+void ViewParams::setEmptyStepScale(float scale)
+{
+    m_emptyStepScale = scale;
+}
+
+float ViewParams::emptyDensity() const
+{
+    return m_emptyDensity;
+}
+
+void ViewParams::setEmptyDensity(float density)
+{
+    m_emptyDensity = density;
+}
+
+uint32_t ViewParams::minLightSteps() const
+{
+    return m_minLightSteps;
+}
+
+void ViewParams::setMinLightSteps(uint32_t steps)
+{
+    m_minLightSteps = steps;
+}
+
 bool ViewParams::fogScaleChanged() const
 {
     return m_fogScaleChanged;
@@ -1,6 +1,16 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <cstdint>
+
+// How the fog is marched: rasterized box, compute tiles or the froxel volume of the camera
+enum class FogPath : uint32_t
+{
+    Raster,
+    Compute,
+    Froxel,
+    Count
+};
 
 class ViewParams
 {
@@ -25,6 +35,51 @@ public:
     float outScatering() const;
     float phaseFactor() const;
     float phaseOffset() const;
+    // the fog is raymarched at 1/divisor of the swapchain resolution
+    uint32_t volumetricDivisor() const;
+    void setVolumetricDivisor(uint32_t divisor);
+    // the engine scales the fog resolution down from 1/divisor to hold the target gpu frame time
+    bool dynamicResolution() const;
+    void setDynamicResolution(bool enabled);
+    float targetFrameTime() const;
+    void setTargetFrameTime(float milliseconds);
+    // also lower the ray steps once the resolution is at its minimum
+    bool dynamicSteps() const;
+    void setDynamicSteps(bool enabled);
+    // written by the engine every frame, 1 without dynamic resolution
+    float renderScale() const;
+    void setRenderScale(float scale);
+    float stepScale() const;
+    void setStepScale(float scale);
+    // the engine rebuilds the graph when the path changes
+    FogPath fogPath() const;
+    void setFogPath(FogPath path);
+    // layer of instanced cloud boxes around the fog
+    bool cloudField() const;
+    void setCloudField(bool enabled);
+    // large mesh drawn from its meshlets around the fog
+    bool vikingRoom() const;
+    void setVikingRoom(bool enabled);
+    // jittered rays accumulated over frames, lets the fog use far fewer steps
+    bool temporalFog() const;
+    void setTemporalFog(bool enabled);
+    // index of the fog pipeline variant, from low to ultra
+    uint32_t fogQuality() const;
+    void setFogQuality(uint32_t quality);
+    uint32_t raymarchSteps() const;
+    void setRaymarchSteps(uint32_t steps);
+    // adaptive marching, rays stop once the transmittance is below the cutoff
+    float transmittanceCutoff() const;
+    void setTransmittanceCutoff(float cutoff);
+    // empty space is crossed with steps this many times larger
+    float emptyStepScale() const;
+    void setEmptyStepScale(float scale);
+    // densities below this are treated as empty space
+    float emptyDensity() const;
+    void setEmptyDensity(float density);
+    // the light samples drop with the transmittance, down to this
+    uint32_t minLightSteps() const;
+    void setMinLightSteps(uint32_t steps);
 
     bool fogScaleChanged() const;
     bool noiseSizeChanged() const;
@@ -52,6 +107,22 @@ private:
     float m_outScatering;
     float m_phaseFactor;
     float m_phaseOffset;
+    uint32_t m_volumetricDivisor;
+    bool m_dynamicResolution;
+    float m_targetFrameTime;
+    bool m_dynamicSteps;
+    float m_renderScale;
+    float m_stepScale;
+    FogPath m_fogPath;
+    bool m_cloudField;
+    bool m_vikingRoom;
+    bool m_temporalFog;
+    uint32_t m_fogQuality;
+    uint32_t m_raymarchSteps;
+    float m_transmittanceCutoff;
+    float m_emptyStepScale;
+    float m_emptyDensity;
+    uint32_t m_minLightSteps;
 
     bool m_fogScaleChanged;
     bool m_noiseSizeChanged;
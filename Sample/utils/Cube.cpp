@@ -3,9 +3,7 @@
 
 Cube::Cube(const glm::mat3& transfo):
     Mesh::Mesh(),
-    m_vertexTransfo(transfo),
-    m_bboxMin(-0.5f, -0.5, -0.5f),
-    m_bboxMax(0.5f, 0.5f, 0.5f)
+    m_vertexTransfo(transfo)
 {
     glm::vec3 red = glm::vec3(1.0, 0.1, 0.1);
     glm::vec3 blue = glm::vec3(0.0, 0.6, 0.8);
@@ -20,8 +18,10 @@ Cube::Cube(const glm::mat3& transfo):
     addFaces(glm::vec3(0.0,  0.0, 0.5), glm::vec3(0.0, 0.5, 0.0), glm::vec3(0.5, 0.0, 0.0), grey);
     addFaces(glm::vec3(0.0, 0.0, -0.5), glm::vec3(0.0, -0.5, 0.0), glm::vec3(0.5, 0.0, 0.0), grey);
 
-    m_bboxMin = m_vertexTransfo * m_bboxMin;
-    m_bboxMax = m_vertexTransfo * m_bboxMax;
+    // only culled front faces are drawn, a convex mesh can take any triangle order
+    optimize(false);
+    // a mirroring transform would swap the transformed corners, the vertices don't
+    computeBounds();
 }
 
 Cube::~Cube()
@@ -29,18 +29,6 @@ Cube::~Cube()
 
 }
 
-/* -------------------------- Public methods -------------------------- */
-
-glm::vec3 Cube::bboxMin() const
-{
-    return m_bboxMin;
-}
-
-glm::vec3 Cube::bboxMax() const
-{
-    return m_bboxMax;
-}
-
 /* -------------------------- Private methods -------------------------- */
 
 void Cube::addFaces(const glm::vec3& center, const glm::vec3& up, const glm::vec3& right, const glm::vec3& color)
@@ -0,0 +1,113 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& fileName):
+    m_data(nullptr),
+    m_size(0),
+    m_file(INVALID_HANDLE_VALUE),
+    m_mapping(nullptr)
+{
+    m_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("failed to open file " + fileName + " !");
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_file, &fileSize)) {
+        CloseHandle(m_file);
+        throw std::runtime_error("failed to read the size of " + fileName + " !");
+    }
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+    // an empty file can't be mapped
+    if (m_size == 0) {
+        return;
+    }
+
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping != nullptr) {
+        m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (m_data == nullptr) {
+        if (m_mapping != nullptr) {
+            CloseHandle(m_mapping);
+        }
+        CloseHandle(m_file);
+        throw std::runtime_error("failed to map file " + fileName + " !");
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data != nullptr) {
+        UnmapViewOfFile(m_data);
+        CloseHandle(m_mapping);
+    }
+    CloseHandle(m_file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& fileName):
+    m_data(nullptr),
+    m_size(0),
+    m_file(-1)
+{
+    m_file = open(fileName.c_str(), O_RDONLY);
+    if (m_file < 0) {
+        throw std::runtime_error("failed to open file " + fileName + " !");
+    }
+    struct stat fileStat;
+    if (fstat(m_file, &fileStat) != 0) {
+        close(m_file);
+        throw std::runtime_error("failed to read the size of " + fileName + " !");
+    }
+    m_size = static_cast<size_t>(fileStat.st_size);
+    // an empty file can't be mapped
+    if (m_size == 0) {
+        return;
+    }
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+    if (data == MAP_FAILED) {
+        close(m_file);
+        throw std::runtime_error("failed to map file " + fileName + " !");
+    }
+    // read front to back by the loaders
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data != nullptr) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+    close(m_file);
+}
+
+#endif
+
+/* -------------------------- Public methods -------------------------- */
+
+const char* MappedFile::data() const
+{
+    return m_data;
+}
+
+size_t MappedFile::size() const
+{
+    return m_size;
+}
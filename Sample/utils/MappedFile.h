@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Read only view of a whole file mapped in memory, unmapped with the object
+class MappedFile
+{
+public:
+    MappedFile(const std::string& fileName);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+public:
+    const char* data() const;
+    size_t size() const;
+
+private:
+    const char* m_data;
+    size_t m_size;
+#ifdef _WIN32
+    void* m_file;
+    void* m_mapping;
+#else
+    int m_file;
+#endif
+};
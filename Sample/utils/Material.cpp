@@ -1,15 +1,26 @@
 #include "Material.h"
 
+#include <algorithm>
+
 
 std::mutex Material::materialIndexLock;
 std::atomic<MaterialID> Material::materialCounter;
 
 /* -------------------------- Constructors -------------------------- */
 
-Material::Material(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader):
+Material::Material(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader, MaterialPass pass):
+    m_pass(pass),
     m_device(device),
+    m_variant(0),
+    m_cullMode(VK_CULL_MODE_BACK_BIT),
+    m_frontFace(VK_FRONT_FACE_CLOCKWISE),
+    m_depthWrite(true),
+    m_pipelineLayout(VK_NULL_HANDLE),
     m_vertexShader(vertexShader),
-    m_fragmentShader(fragmentShader)
+    m_fragmentShader(fragmentShader),
+    m_textureIndex(0),
+    m_samplerIndex(0),
+    m_bufferIndex(0)
 {
     materialIndexLock.lock();
     m_materialId = materialCounter;
@@ -24,31 +35,15 @@ Material::~Material()
 
 /* -------------------------- Public methods -------------------------- */
 
-/*
-    Create binding for shader Uniforms such as:
-        - layout(set = 1, binding = n) uniform MyStruct { ... }
-        - the set = 0 is dedicated to the global matrix uniform buffer
-*/
-void Material::createDescriptorLayouts(RenderContext& renderContext)
-{
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(m_descriptorBindings.size());
-    layoutInfo.pBindings = m_descriptorBindings.data();
-    // needs VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME
-    //layoutInfo.pNext = m_bindingStrategies.size() > 0 ? m_bindingStrategies.data() : NULL;
-
-    if (vkCreateDescriptorSetLayout(renderContext.device(), &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create descriptor set layout!");
-    }
-}
-
 /*
     Create the graphic pipeline used by the material used during draw call:
         - vkCmdBindPipeline(m_commandBuffers, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    The volumetric and resolve passes have a single sample color target and no depth, their result is composited later
 */
-void Material::createPipeline(RenderContext& renderContext, VkRenderPass renderPass, VkVertexInputBindingDescription bindingDescription, std::array<VkVertexInputAttributeDescription, 3> vertexDescription, VkDescriptorSetLayout globalDescriptorLayout)
+void Material::createPipeline(RenderContext& renderContext, VkRenderPass renderPass, Mesh& mesh, VkPipelineLayout pipelineLayout)
 {
+    bool volumetric = m_pass != MaterialPass::Main;
+
     // Vertex Shader
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -63,9 +58,9 @@ void Material::createPipeline(RenderContext& renderContext, VkRenderPass renderP
     fragShaderStageInfo.module = m_fragmentShader;
     fragShaderStageInfo.pName = "main";
 
-    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
     /* --------------------------------- Shader Bindings --------------------------------- */
+    VkVertexInputBindingDescription bindingDescription = mesh.getBindingDescription();
+    std::vector<VkVertexInputAttributeDescription> vertexDescription = mesh.getAttributeDescriptions();
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     vertexInputInfo.vertexBindingDescriptionCount = 1;
@@ -79,24 +74,13 @@ void Material::createPipeline(RenderContext& renderContext, VkRenderPass renderP
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
     /* --------------------------------- Screen & Viewports --------------------------------- */
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)renderContext.width();
-    viewport.height = (float)renderContext.height();
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = renderContext.swapChain().dimension();
-
+    // Viewport and scissor are dynamic, set when recording the command buffers
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
+    viewportState.pViewports = nullptr;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+    viewportState.pScissors = nullptr;
 
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -104,8 +88,8 @@ void Material::createPipeline(RenderContext& renderContext, VkRenderPass renderP
     rasterizer.rasterizerDiscardEnable = VK_FALSE;
     rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
     rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    rasterizer.cullMode = m_cullMode;
+    rasterizer.frontFace = m_frontFace;
     rasterizer.depthBiasEnable = VK_FALSE;
     rasterizer.depthBiasConstantFactor = 0.0f; // Optional
     rasterizer.depthBiasClamp = 0.0f; // Optional
@@ -114,7 +98,7 @@ void Material::createPipeline(RenderContext& renderContext, VkRenderPass renderP
     VkPipelineMultisampleStateCreateInfo multisampling{};
     multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
     multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = renderContext.multiSamplingSamples();
+    multisampling.rasterizationSamples = volumetric ? VK_SAMPLE_COUNT_1_BIT : renderContext.multiSamplingSamples();
     multisampling.minSampleShading = 1.0f; // Optional
     multisampling.pSampleMask = nullptr; // Optional
     //multisampling.sampleShadingEnable = VK_TRUE; // enable sample shading in the pipeline
@@ -125,8 +109,8 @@ void Material::createPipeline(RenderContext& renderContext, VkRenderPass renderP
     /* --------------------------------- Pipeline States --------------------------------- */
     VkPipelineDepthStencilStateCreateInfo depthStencil{};
     depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthTestEnable = volumetric ? VK_FALSE : VK_TRUE;
+    depthStencil.depthWriteEnable = volumetric || !m_depthWrite ? VK_FALSE : VK_TRUE;
     depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
     depthStencil.depthBoundsTestEnable = VK_FALSE;
     depthStencil.minDepthBounds = 0.0f; // Optional
@@ -137,7 +121,8 @@ void Material::createPipeline(RenderContext& renderContext, VkRenderPass renderP
 
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
     colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_TRUE;
+    // the volumetric target keeps the raw fog color and entry distance
+    colorBlendAttachment.blendEnable = volumetric ? VK_FALSE : VK_TRUE;
     colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
     colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
     colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
@@ -158,7 +143,7 @@ void Material::createPipeline(RenderContext& renderContext, VkRenderPass renderP
 
     VkDynamicState dynamicStates[] = {
     VK_DYNAMIC_STATE_VIEWPORT,
-    VK_DYNAMIC_STATE_LINE_WIDTH
+    VK_DYNAMIC_STATE_SCISSOR
     };
     VkPipelineDynamicStateCreateInfo dynamicState{};
     dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -167,23 +152,32 @@ void Material::createPipeline(RenderContext& renderContext, VkRenderPass renderP
 
     /* --------------------------------- Shader Uniforms --------------------------------- */
 
-    VkDescriptorSetLayout descriptors[2] = { globalDescriptorLayout, m_descriptorSetLayout };
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 2;
-    pipelineLayoutInfo.pSetLayouts = descriptors;
-    pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-    pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-
-    if (vkCreatePipelineLayout(renderContext.device(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create pipeline layout!");
+    // Bindless layout shared by every material, resources are selected with the push constants
+    m_pipelineLayout = pipelineLayout;
+
+    /* --------------------------------- Specialization --------------------------------- */
+    // the create infos point into these arrays, they must not be resized afterwards
+    uint32_t variantCount = std::max<uint32_t>(1, static_cast<uint32_t>(m_variantData.size()));
+    std::vector<VkSpecializationInfo> specializationInfos(variantCount);
+    std::vector<std::array<VkPipelineShaderStageCreateInfo, 2>> shaderStages(variantCount);
+    std::vector<VkGraphicsPipelineCreateInfo> pipelineInfos(variantCount);
+
+    for (uint32_t variant = 0; variant < variantCount; variant++) {
+        shaderStages[variant] = { vertShaderStageInfo, fragShaderStageInfo };
+        if (!m_variantData.empty()) {
+            VkSpecializationInfo& specializationInfo = specializationInfos[variant];
+            specializationInfo.mapEntryCount = static_cast<uint32_t>(m_specializationEntries.size());
+            specializationInfo.pMapEntries = m_specializationEntries.data();
+            specializationInfo.dataSize = m_variantData[variant].size();
+            specializationInfo.pData = m_variantData[variant].data();
+            shaderStages[variant][1].pSpecializationInfo = &specializationInfo;
+        }
     }
 
     /* --------------------------------- Pipeline Creation --------------------------------- */
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
     pipelineInfo.pVertexInputState = &vertexInputInfo;
     pipelineInfo.pInputAssemblyState = &inputAssembly;
     pipelineInfo.pViewportState = &viewportState;
@@ -191,30 +185,37 @@ void Material::createPipeline(RenderContext& renderContext, VkRenderPass renderP
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr; // Optional
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = m_pipelineLayout;
     pipelineInfo.renderPass = renderPass;
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
     pipelineInfo.basePipelineIndex = -1; // Optional
 
-    if (vkCreateGraphicsPipelines(renderContext.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS) {
+    for (uint32_t variant = 0; variant < variantCount; variant++) {
+        pipelineInfos[variant] = pipelineInfo;
+        pipelineInfos[variant].pStages = shaderStages[variant].data();
+    }
+
+    m_pipelines.resize(variantCount, VK_NULL_HANDLE);
+    if (vkCreateGraphicsPipelines(renderContext.device(), renderContext.pipelineCache(), variantCount, pipelineInfos.data(), nullptr, m_pipelines.data()) != VK_SUCCESS) {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
+    m_variant = std::min(m_variant, variantCount - 1);
 }
 
 void Material::cleanUp(RenderContext& renderContext)
 {
     vkDestroyShaderModule(renderContext.device(), m_vertexShader, nullptr);
     vkDestroyShaderModule(renderContext.device(), m_fragmentShader, nullptr);
-
-    vkDestroyDescriptorSetLayout(renderContext.device(), m_descriptorSetLayout, nullptr);
 }
 
 void Material::destroyPipeline(RenderContext& renderContext)
 {
-    vkDestroyPipeline(renderContext.device(), m_pipeline, nullptr);
-    vkDestroyPipelineLayout(renderContext.device(), m_pipelineLayout, nullptr);
+    for (auto pipeline : m_pipelines) {
+        vkDestroyPipeline(renderContext.device(), pipeline, nullptr);
+    }
+    m_pipelines.clear();
 }
 
 MaterialID Material::materialId() const
@@ -222,9 +223,44 @@ MaterialID Material::materialId() const
     return m_materialId;
 }
 
+MaterialPass Material::pass() const
+{
+    return m_pass;
+}
+
 VkPipeline Material::pipeline() const
 {
-    return m_pipeline;
+    return m_pipelines[m_variant];
+}
+
+uint32_t Material::variantCount() const
+{
+    return std::max<uint32_t>(1, static_cast<uint32_t>(m_variantData.size()));
+}
+
+uint32_t Material::variant() const
+{
+    return m_variant;
+}
+
+bool Material::depthWrite() const
+{
+    return m_depthWrite;
+}
+
+VkCullModeFlags Material::cullMode() const
+{
+    return m_cullMode;
+}
+
+VkFrontFace Material::frontFace() const
+{
+    return m_frontFace;
+}
+
+void Material::setVariant(uint32_t variant)
+{
+    m_variant = std::min(variant, variantCount() - 1);
 }
 
 VkPipelineLayout Material::pipelineLayout() const
@@ -232,12 +268,30 @@ VkPipelineLayout Material::pipelineLayout() const
     return m_pipelineLayout;
 }
 
-VkDescriptorSetLayout Material::descriptorLayout() const
+DrawConstants Material::drawConstants(uint32_t drawObjectOffset) const
+{
+    // the arena is read as an array of vec4 by the shaders
+    return DrawConstants{ drawObjectOffset / 16, m_textureIndex, m_samplerIndex, m_bufferIndex };
+}
+
+/* -------------------------- Protected methods -------------------------- */
+
+void Material::setSpecializationEntries(const std::vector<VkSpecializationMapEntry>& entries)
+{
+    m_specializationEntries = entries;
+}
+
+void Material::setCullMode(VkCullModeFlags cullMode)
+{
+    m_cullMode = cullMode;
+}
+
+void Material::setFrontFace(VkFrontFace frontFace)
 {
-    return m_descriptorSetLayout;
+    m_frontFace = frontFace;
 }
 
-std::vector<VkDescriptorSetLayoutBinding>& Material::descriptorBindings()
+void Material::setDepthWrite(bool depthWrite)
 {
-    return m_descriptorBindings;
+    m_depthWrite = depthWrite;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <core/RenderContext.h>
+#include "Mesh.h"
 #include <array>
 #include <vector>
 #include <atomic>   
@@ -8,45 +9,99 @@
 
 using MaterialID = std::size_t;
 
+class DescriptorTable;
+
+// Render pass a material is drawn in, the volumetric and resolve passes render at a reduced resolution
+enum class MaterialPass {
+    Main,
+    Volumetric,
+    Resolve
+};
+
+// Push constants of every draw, indices inside the bindless arrays of the descriptor table
+struct DrawConstants {
+    // vec4 index inside the uniform arena, of the draw objects for the scene draws and of the dispatch data otherwise
+    uint32_t objectIndex;
+    uint32_t textureIndex;
+    uint32_t samplerIndex;
+    uint32_t bufferIndex;
+};
+
 class Material
 {
 public:
-    Material(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader);
+    Material(VkDevice device, VkShaderModule vertexShader, VkShaderModule fragmentShader, MaterialPass pass = MaterialPass::Main);
     virtual ~Material();
     
-    void createDescriptorLayouts(RenderContext& renderContext);
-    virtual void createDescriptorBuffer(RenderContext& renderContext, VkBuffer& buffer, VkDeviceMemory& memory) = 0;
-    virtual void updateDescriptorSet(RenderContext& renderContext, VkDescriptorSet descriptorSet, VkBuffer buffer) = 0;
+    // Add the textures and samplers of the material to the bindless arrays and keep their indices
+    virtual void registerResources(DescriptorTable& descriptorTable) = 0;
+    // Static name of the GPU scope around the draws of the material
+    virtual const char* name() const = 0;
 
-    // change to vector<VkVertexInputAttributeDescription>
-    void createPipeline(RenderContext& renderContext, VkRenderPass renderPass, VkVertexInputBindingDescription bindingDescription, 
-        std::array<VkVertexInputAttributeDescription, 3> vertexDescription, VkDescriptorSetLayout globalDescriptionLayout);
+    // One pipeline per variant, built in a single call, against the vertex layout of the mesh.
+    // Every mesh drawn with the material must share that layout, the position decode comes with each draw object
+    void createPipeline(RenderContext& renderContext, VkRenderPass renderPass, Mesh& mesh, VkPipelineLayout pipelineLayout);
 
     virtual void cleanUp(RenderContext& renderContext);
     void destroyPipeline(RenderContext& renderContext);
 
 public:
     MaterialID materialId() const;
+    MaterialPass pass() const;
+    // Pipeline of the active variant
     VkPipeline pipeline() const;
+    uint32_t variantCount() const;
+    uint32_t variant() const;
+    // depth writing materials are drawn before the blended ones in their pass
+    bool depthWrite() const;
+    // only the back facing clusters of a mesh culling its back faces can be skipped
+    VkCullModeFlags cullMode() const;
+    // the normal cones of the meshlets follow the counter clockwise winding of the loaded files
+    VkFrontFace frontFace() const;
+    // Every variant is built upfront, switching never compiles anything
+    void setVariant(uint32_t variant);
     VkPipelineLayout pipelineLayout() const;
-    VkDescriptorSetLayout descriptorLayout() const;
-    std::vector<VkDescriptorSetLayoutBinding>& descriptorBindings();
+    // Shared by the draws of a bucket, drawObjectOffset is the arena offset of the draw objects of the frame
+    DrawConstants drawConstants(uint32_t drawObjectOffset) const;
 
 public:
     static std::mutex materialIndexLock;
     static std::atomic<MaterialID> materialCounter;
 
+protected:
+    // Specialization constants of the fragment shader, the data of every variant follows the same entries
+    void setSpecializationEntries(const std::vector<VkSpecializationMapEntry>& entries);
+    void setCullMode(VkCullModeFlags cullMode);
+    // clockwise by default, the winding of the built in meshes
+    void setFrontFace(VkFrontFace frontFace);
+    // blended materials drawn back to front in the main pass don't write depth
+    void setDepthWrite(bool depthWrite);
+    template<typename T>
+    void addVariant(const T& constants)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&constants);
+        m_variantData.emplace_back(bytes, bytes + sizeof(T));
+    }
+
 protected:
     MaterialID m_materialId;
+    MaterialPass m_pass;
     VkDevice m_device;
-    VkPipeline m_pipeline;
+    // a single variant without specialization when none was added
+    std::vector<VkPipeline> m_pipelines;
+    std::vector<VkSpecializationMapEntry> m_specializationEntries;
+    std::vector<std::vector<uint8_t>> m_variantData;
+    uint32_t m_variant;
+    VkCullModeFlags m_cullMode;
+    VkFrontFace m_frontFace;
+    bool m_depthWrite;
+    // shared by every material, owned by the descriptor table
     VkPipelineLayout m_pipelineLayout;
 
     VkShaderModule m_vertexShader;
     VkShaderModule m_fragmentShader;
 
-    VkDescriptorSetLayout m_descriptorSetLayout;
-    std::vector<VkDescriptorSetLayoutBinding> m_descriptorBindings;
-    std::vector<VkDescriptorSetLayoutBindingFlagsCreateInfo> m_bindingStrategies;
-    std::vector<VkWriteDescriptorSet> m_descriptorWrites;
+    uint32_t m_textureIndex;
+    uint32_t m_samplerIndex;
+    uint32_t m_bufferIndex;
 };
\ No newline at end of file
@@ -18,9 +18,9 @@ VkDescriptorSetLayoutBinding MatrixBuffer::descriptorBinding()
 {
     VkDescriptorSetLayoutBinding descriptorBinding;
     descriptorBinding.binding = 0;
-    descriptorBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     descriptorBinding.descriptorCount = 1;
-    descriptorBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    descriptorBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
     descriptorBinding.pImmutableSamplers = nullptr; // Optional
     return descriptorBinding;
 }
@@ -11,6 +11,8 @@ public:
         alignas(16) glm::mat4 view;
         alignas(16) glm::mat4 proj;
         float time;
+        // proj * view * model of the previous frame, to reproject the fog history
+        alignas(16) glm::mat4 previousViewProj;
     };
 
 public:
@@ -1,8 +1,19 @@
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+
+#include <glm/gtc/packing.hpp>
+
+std::atomic<MeshID> Mesh::meshCounter;
 
 Mesh::Mesh():
-    m_vertexBuffer(VK_NULL_HANDLE),
-    m_indexBuffer(VK_NULL_HANDLE)
+    m_meshId(meshCounter++),
+    m_vertexLayout(VertexLayout::Full),
+    m_bboxMin(0.0f),
+    m_bboxMax(0.0f),
+    m_vertexOffset(0),
+    m_firstIndex(0)
 {
 
 }
@@ -14,10 +25,10 @@ Mesh::~Mesh()
 
 /* -------------------------- Public methods -------------------------- */
 
-void Mesh::createBuffers(const RenderContext& renderContext)
+void Mesh::createBuffers(GeometryArena& geometryArena)
 {
-    createVertexBuffer(renderContext);
-    createIndexBuffer(renderContext);
+    createVertexBuffer(geometryArena);
+    createIndexBuffer(geometryArena);
 }
 
 
@@ -26,15 +37,31 @@ VkVertexInputBindingDescription Mesh::getBindingDescription()
     VkVertexInputBindingDescription bindingDescription{};
 
     bindingDescription.binding = 0;
-    bindingDescription.stride = sizeof(VertexData);
+    bindingDescription.stride = vertexStride();
     bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
     return bindingDescription;
 }
 
-std::array<VkVertexInputAttributeDescription, 3> Mesh::getAttributeDescriptions()
+/*
+    Same locations for both layouts, the vertex shaders read vec3 / vec2 either way:
+        - 0: position, R16G16B16A16_UNORM when packed, decoded with positionDecode
+        - 1: color, left out of the packed layout when it is the same for every vertex
+        - 2: texture coordinate, R16G16_SFLOAT when packed
+*/
+std::vector<VkVertexInputAttributeDescription> Mesh::getAttributeDescriptions()
 {
-    std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+    if (m_vertexLayout == VertexLayout::Packed) {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+        attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, 0 });
+        attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SFLOAT, 8 });
+        if (!hasConstantColor()) {
+            attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R8G8B8A8_UNORM, 12 });
+        }
+        return attributeDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions(3);
     attributeDescriptions[0].binding = 0;
     attributeDescriptions[0].location = 0;
     attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
@@ -53,60 +80,146 @@ std::array<VkVertexInputAttributeDescription, 3> Mesh::getAttributeDescriptions(
     return attributeDescriptions;
 }
 
-void Mesh::cleanUp(const RenderContext& renderContext)
+void Mesh::setVertexLayout(VertexLayout vertexLayout)
+{
+    m_vertexLayout = vertexLayout;
+}
+
+VertexLayout Mesh::vertexLayout() const
 {
-    if (m_vertexBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(renderContext.device(), m_indexBuffer, nullptr);
-        vkFreeMemory(renderContext.device(), m_indexBufferMemory, nullptr);
-        vkDestroyBuffer(renderContext.device(), m_vertexBuffer, nullptr);
-        vkFreeMemory(renderContext.device(), m_vertexBufferMemory, nullptr);
+    return m_vertexLayout;
+}
+
+PositionDecode Mesh::positionDecode() const
+{
+    if (m_vertexLayout == VertexLayout::Packed) {
+        return { m_bboxMin, m_bboxMax - m_bboxMin };
     }
+    return { glm::vec3(0.0f), glm::vec3(1.0f) };
 }
 
 /* -------------------------- Protected methods -------------------------- */
 
-void Mesh::createVertexBuffer(const RenderContext& renderContext)
+void Mesh::createVertexBuffer(GeometryArena& geometryArena)
 {
-    VkDeviceSize bufferSize = sizeof(m_vertices[0]) * m_vertices.size();
+    if (m_vertexLayout == VertexLayout::Packed) {
+        std::vector<uint8_t> packedVertices = packVertices();
+        m_vertexOffset = geometryArena.addVertices(packedVertices.data(), packedVertices.size(), vertexStride());
+        return;
+    }
+    m_vertexOffset = geometryArena.addVertices(m_vertices.data(), sizeof(VertexData) * m_vertices.size(), vertexStride());
+}
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    renderContext.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+void Mesh::createIndexBuffer(GeometryArena& geometryArena)
+{
+    m_firstIndex = geometryArena.addIndices(m_indices.data(), m_indices.size());
+    geometryArena.addIndices(m_lodIndices.data(), m_lodIndices.size());
+}
+
+void Mesh::generateLods(uint32_t maxLodCount, float maxError)
+{
+    m_lodIndices.clear();
+    m_lods.clear();
 
-    void* data;
-    vkMapMemory(renderContext.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, m_vertices.data(), (size_t)bufferSize);
-    vkUnmapMemory(renderContext.device(), stagingBufferMemory);
+    std::vector<uint32_t> previous = m_indices;
+    float error = 0.0f;
+    for (uint32_t level = 1; level < maxLodCount; level++) {
+        float levelError = 0.0f;
+        std::vector<uint32_t> lodIndices = MeshSimplifier::simplify(m_vertices, previous, previous.size() / 6 * 3, maxError, levelError);
+        // not worth a level when the simplifier got stuck on the locked vertices
+        if (lodIndices.empty() || lodIndices.size() > previous.size() * 3 / 4) {
+            break;
+        }
+        error += levelError;
+
+        std::vector<uint32_t> clusters;
+        MeshOptimizer::optimizeVertexCache(lodIndices, m_vertices.size(), clusters);
+        m_lods.push_back({ static_cast<uint32_t>(m_indices.size() + m_lodIndices.size()), static_cast<uint32_t>(lodIndices.size()), error });
+        m_lodIndices.insert(m_lodIndices.end(), lodIndices.begin(), lodIndices.end());
+        previous.swap(lodIndices);
+    }
+}
 
-    renderContext.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_vertexBuffer, m_vertexBufferMemory);
-    renderContext.copyBuffer(stagingBuffer, m_vertexBuffer, bufferSize);
+void Mesh::buildMeshlets()
+{
+    MeshletBuilder::build(m_vertices, m_indices, m_meshlets);
+}
 
-    vkDestroyBuffer(renderContext.device(), stagingBuffer, nullptr);
-    vkFreeMemory(renderContext.device(), stagingBufferMemory, nullptr);
+uint32_t Mesh::vertexStride() const
+{
+    if (m_vertexLayout == VertexLayout::Packed) {
+        return hasConstantColor() ? 12 : 16;
+    }
+    return sizeof(VertexData);
 }
 
-void Mesh::createIndexBuffer(const RenderContext& renderContext)
+bool Mesh::hasConstantColor() const
 {
-    VkDeviceSize bufferSize = sizeof(m_indices[0]) * m_indices.size();
+    for (const auto& vertex : m_vertices) {
+        if (vertex.color != m_vertices[0].color) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    renderContext.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+// Positions rounded to the nearest of the 65536 steps across the bounds, a flat axis stays at 0
+std::vector<uint8_t> Mesh::packVertices() const
+{
+    uint32_t stride = vertexStride();
+    bool hasColor = stride > 12;
+    glm::vec3 extent = m_bboxMax - m_bboxMin;
+    glm::vec3 inverseExtent = glm::vec3(
+        extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+        extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+        extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
 
-    void* data;
-    vkMapMemory(renderContext.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, m_indices.data(), (size_t)bufferSize);
-    vkUnmapMemory(renderContext.device(), stagingBufferMemory);
+    std::vector<uint8_t> packedVertices(stride * m_vertices.size());
+    for (size_t i = 0; i < m_vertices.size(); i++) {
+        const VertexData& vertex = m_vertices[i];
+        uint8_t* packed = packedVertices.data() + stride * i;
+        uint64_t position = glm::packUnorm4x16(glm::vec4((vertex.pos - m_bboxMin) * inverseExtent, 0.0f));
+        uint32_t texCoord = glm::packHalf2x16(vertex.texCoord);
+        memcpy(packed, &position, sizeof(position));
+        memcpy(packed + 8, &texCoord, sizeof(texCoord));
+        if (hasColor) {
+            uint32_t color = glm::packUnorm4x8(glm::vec4(vertex.color, 1.0f));
+            memcpy(packed + 12, &color, sizeof(color));
+        }
+    }
+    return packedVertices;
+}
 
-    renderContext.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_indexBuffer, m_indexBufferMemory);
-    renderContext.copyBuffer(stagingBuffer, m_indexBuffer, bufferSize);
+void Mesh::computeBounds()
+{
+    if (m_vertices.empty()) {
+        return;
+    }
+    m_bboxMin = m_vertices[0].pos;
+    m_bboxMax = m_vertices[0].pos;
+    for (const auto& vertex : m_vertices) {
+        m_bboxMin = glm::min(m_bboxMin, vertex.pos);
+        m_bboxMax = glm::max(m_bboxMax, vertex.pos);
+    }
+}
 
-    vkDestroyBuffer(renderContext.device(), stagingBuffer, nullptr);
-    vkFreeMemory(renderContext.device(), stagingBufferMemory, nullptr);
+void Mesh::optimize(bool sortOverdraw)
+{
+    std::vector<uint32_t> clusters;
+    MeshOptimizer::optimizeVertexCache(m_indices, m_vertices.size(), clusters);
+    if (sortOverdraw) {
+        MeshOptimizer::optimizeOverdraw(m_indices, m_vertices, clusters);
+    }
+    MeshOptimizer::optimizeVertexFetch(m_vertices, m_indices);
 }
 
 /* -------------------------- Getter & Setters -------------------------- */
 
+MeshID Mesh::meshId() const
+{
+    return m_meshId;
+}
+
 const std::vector<VertexData>& Mesh::vertices() const
 {
     return m_vertices;
@@ -117,12 +230,35 @@ const std::vector<uint32_t>& Mesh::indices() const
     return m_indices;
 }
 
-VkBuffer Mesh::vertexBuffer() const
+int32_t Mesh::vertexOffset() const
 {
-    return m_vertexBuffer;
+    return m_vertexOffset;
 }
 
-VkBuffer Mesh::indexBuffer() const
+uint32_t Mesh::firstIndex() const
 {
-    return m_indexBuffer;
-}
\ No newline at end of file
+    return m_firstIndex;
+}
+
+glm::vec3 Mesh::bboxMin() const
+{
+    return m_bboxMin;
+}
+
+glm::vec3 Mesh::bboxMax() const
+{
+    return m_bboxMax;
+}
+
+std::vector<MeshLod> Mesh::lods() const
+{
+    std::vector<MeshLod> lods;
+    lods.push_back({ 0, static_cast<uint32_t>(m_indices.size()), 0.0f });
+    lods.insert(lods.end(), m_lods.begin(), m_lods.end());
+    return lods;
+}
+
+const std::vector<Meshlet>& Mesh::meshlets() const
+{
+    return m_meshlets;
+}
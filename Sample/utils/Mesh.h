@@ -1,9 +1,11 @@
 #pragma once
 
 #include <core/RenderContext.h>
+#include <core/GeometryArena.h>
 #include <glm/glm.hpp>
 #include <vector>
 #include <array>
+#include <atomic>
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
@@ -23,6 +25,43 @@ struct VertexData {
     }
 };
 
+using MeshID = std::size_t;
+
+// Layout of the vertex buffer, the cpu side keeps the VertexData
+enum class VertexLayout {
+    // 32 bytes: float position, color and texture coordinate
+    Full,
+    // 12 bytes: unorm16 position inside the mesh bounds and half float texture coordinate,
+    // plus a rgba8 color when the vertices don't all share the same one
+    Packed
+};
+
+// Packed positions go back to the mesh space as offset + position * scale, identity for the full layout
+struct PositionDecode {
+    glm::vec3 offset;
+    glm::vec3 scale;
+};
+
+// Range of a level of detail in the index buffer, every level draws from the same vertices
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // mesh space distance the surface may be moved away from the full detail one
+    float error;
+};
+
+// Run of triangles of the full detail level culled on its own by the gpu, same layout as Meshlet in cluster_cull.comp
+struct Meshlet {
+    // xyz: center of the bounding sphere, w: its radius
+    glm::vec4 sphere;
+    // xyz: axis of the normal cone, w: cutoff, 1 when the triangles face too many directions to be culled
+    glm::vec4 cone;
+    // xyz: apex of the normal cone
+    glm::vec4 apex;
+    // x: first index, y: index count
+    glm::uvec4 range;
+};
+
 namespace std {
     template<> struct hash<VertexData> {
         size_t operator()(VertexData const& vertex) const {
@@ -40,26 +79,58 @@ public:
     ~Mesh();
 
 public:
-    void createBuffers(const RenderContext& renderContext);
-    virtual void cleanUp(const RenderContext& renderContext);
+    // Adds the vertices and every level of detail to the arena, before its upload
+    void createBuffers(GeometryArena& geometryArena);
+    // Both follow the vertex layout
     virtual VkVertexInputBindingDescription getBindingDescription();
-    virtual std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
+    virtual std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+    // Before createBuffers, the pipelines are built against the layout of their mesh
+    void setVertexLayout(VertexLayout vertexLayout);
+    VertexLayout vertexLayout() const;
+    PositionDecode positionDecode() const;
 
+    MeshID meshId() const;
     const std::vector<VertexData>& vertices() const;
     const std::vector<uint32_t>& indices() const;
-    VkBuffer vertexBuffer() const;
-    VkBuffer indexBuffer() const;
+    // Range of the mesh in the geometry arena, the lods are relative to firstIndex
+    int32_t vertexOffset() const;
+    uint32_t firstIndex() const;
+    // Bounds of the vertices, tested by the gpu culling
+    glm::vec3 bboxMin() const;
+    glm::vec3 bboxMax() const;
+    // Full detail first, then every coarser level
+    std::vector<MeshLod> lods() const;
+    // Empty unless buildMeshlets was called, the ranges are relative to firstIndex
+    const std::vector<Meshlet>& meshlets() const;
 
 protected:
-    virtual void createVertexBuffer(const RenderContext& renderContext);
-    virtual void createIndexBuffer(const RenderContext& renderContext);
+    void computeBounds();
+    // Triangles in vertex cache order then vertices in first use order, the outer clusters first with sortOverdraw
+    void optimize(bool sortOverdraw);
+    // Each level halves the triangles of the previous one, the chain stops at maxLodCount or once the error grows past maxError
+    void generateLods(uint32_t maxLodCount, float maxError);
+    // Splits the full detail level in meshlets, keeps the triangle order
+    void buildMeshlets();
+    virtual void createVertexBuffer(GeometryArena& geometryArena);
+    virtual void createIndexBuffer(GeometryArena& geometryArena);
+    uint32_t vertexStride() const;
+    bool hasConstantColor() const;
+    std::vector<uint8_t> packVertices() const;
+
+public:
+    static std::atomic<MeshID> meshCounter;
 
 protected:
+    MeshID m_meshId;
     std::vector<VertexData> m_vertices;
     std::vector<uint32_t> m_indices;
-
-    VkBuffer m_vertexBuffer;
-    VkDeviceMemory m_vertexBufferMemory;
-    VkBuffer m_indexBuffer;
-    VkDeviceMemory m_indexBufferMemory;
+    // the coarser levels follow the full detail indices in the index buffer
+    std::vector<uint32_t> m_lodIndices;
+    std::vector<MeshLod> m_lods;
+    std::vector<Meshlet> m_meshlets;
+    VertexLayout m_vertexLayout;
+    glm::vec3 m_bboxMin;
+    glm::vec3 m_bboxMax;
+    int32_t m_vertexOffset;
+    uint32_t m_firstIndex;
 };
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+static const uint32_t cacheMagic = 0x4853454d; // "MESH"
+// 2: optimized vertex and index order, 3: levels of detail
+static const uint32_t cacheVersion = 3;
+
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t padding;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t lodCount;
+};
+
+static bool sourceStamp(const std::string& sourceName, uint64_t& size, int64_t& time)
+{
+    std::error_code error;
+    size = std::filesystem::file_size(sourceName, error);
+    if (error) {
+        return false;
+    }
+    time = static_cast<int64_t>(std::filesystem::last_write_time(sourceName, error).time_since_epoch().count());
+    return !error;
+}
+
+MeshCache::MeshCache()
+{
+
+}
+
+MeshCache::~MeshCache()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+std::string MeshCache::cacheName(const std::string& sourceName)
+{
+    return sourceName + ".meshcache";
+}
+
+bool MeshCache::load(const std::string& sourceName, std::vector<VertexData>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods)
+{
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    std::string fileName = cacheName(sourceName);
+    if (!sourceStamp(sourceName, sourceSize, sourceTime) || !std::filesystem::exists(fileName)) {
+        return false;
+    }
+
+    MappedFile file(fileName);
+    MeshCacheHeader header;
+    if (file.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != cacheMagic || header.version != cacheVersion || header.vertexSize != sizeof(VertexData)
+        || header.sourceSize != sourceSize || header.sourceTime != sourceTime) {
+        return false;
+    }
+    size_t vertexBytes = header.vertexCount * sizeof(VertexData);
+    size_t indexBytes = header.indexCount * sizeof(uint32_t);
+    size_t lodBytes = header.lodCount * sizeof(MeshLod);
+    if (file.size() != sizeof(header) + vertexBytes + indexBytes + lodBytes) {
+        return false;
+    }
+
+    // already in the buffer layout, one copy per array
+    const char* data = file.data() + sizeof(header);
+    vertices.resize(header.vertexCount);
+    indices.resize(header.indexCount);
+    lods.resize(header.lodCount);
+    memcpy(vertices.data(), data, vertexBytes);
+    memcpy(indices.data(), data + vertexBytes, indexBytes);
+    memcpy(lods.data(), data + vertexBytes + indexBytes, lodBytes);
+    return true;
+}
+
+bool MeshCache::save(const std::string& sourceName, const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices, const std::vector<MeshLod>& lods)
+{
+    MeshCacheHeader header{};
+    header.magic = cacheMagic;
+    header.version = cacheVersion;
+    header.vertexSize = sizeof(VertexData);
+    header.vertexCount = vertices.size();
+    header.indexCount = indices.size();
+    header.lodCount = lods.size();
+    if (!sourceStamp(sourceName, header.sourceSize, header.sourceTime)) {
+        return false;
+    }
+
+    std::ofstream file(cacheName(sourceName), std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(vertices.data()), sizeof(VertexData) * vertices.size());
+    file.write(reinterpret_cast<const char*>(indices.data()), sizeof(uint32_t) * indices.size());
+    file.write(reinterpret_cast<const char*>(lods.data()), sizeof(MeshLod) * lods.size());
+    return file.good();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <string>
+#include <vector>
+
+/*
+    Binary copy of a loaded mesh next to its source file: a header, the vertices and the indices
+    in the layout of the vertex and index buffers, then the ranges of the levels of detail. The cache is stale once the source
+    changes size or write time, or when the vertex layout changed.
+    The arrays are copied into the mesh rather than the staging buffer, the mesh keeps them for its bounds,
+    meshlets and packed layout and the geometry arena only stages once every mesh is added.
+*/
+class MeshCache
+{
+public:
+    MeshCache();
+    ~MeshCache();
+
+public:
+    static std::string cacheName(const std::string& sourceName);
+    // False when there is no valid cache for the source
+    // indices holds the full detail and the coarser levels one after the other
+    static bool load(const std::string& sourceName, std::vector<VertexData>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods);
+    // False when the cache could not be written, the mesh is simply parsed again next time
+    static bool save(const std::string& sourceName, const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices, const std::vector<MeshLod>& lods);
+};
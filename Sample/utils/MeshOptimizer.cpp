@@ -0,0 +1,186 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+MeshOptimizer::MeshOptimizer()
+{
+
+}
+
+MeshOptimizer::~MeshOptimizer()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+/*
+    Tipsify, Sander et al. 2007. Fans out the remaining triangles of one vertex at a time, the
+    next vertex is the one of the last triangles that is still in the cache and won't be pushed
+    out by its own remaining triangles. Without such a vertex the walk restarts from the most
+    recent vertex with triangles left, and starts a new cluster
+*/
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& clusters)
+{
+    size_t triangleCount = indices.size() / 3;
+    clusters.clear();
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // triangles around every vertex
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t index : indices) {
+        liveTriangles[index]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    std::partial_sum(liveTriangles.begin(), liveTriangles.end(), adjacencyOffsets.begin() + 1);
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    uint32_t timeStamp = cacheSize + 1;
+    size_t cursor = 0;
+
+    int64_t vertex = indices[0];
+    clusters.push_back(0);
+    while (vertex >= 0) {
+        candidates.clear();
+        for (uint32_t i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; i++) {
+            uint32_t triangle = adjacency[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t index = indices[triangle * 3 + corner];
+                result.push_back(index);
+                deadEnd.push_back(index);
+                candidates.push_back(index);
+                liveTriangles[index]--;
+                if (timeStamp - cacheTime[index] > cacheSize) {
+                    cacheTime[index] = timeStamp++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // best vertex of the fan still in the cache, the oldest one first
+        int64_t next = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t candidate : candidates) {
+            if (liveTriangles[candidate] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if (timeStamp - cacheTime[candidate] + 2 * liveTriangles[candidate] <= cacheSize) {
+                priority = timeStamp - cacheTime[candidate];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = candidate;
+            }
+        }
+        if (next >= 0) {
+            vertex = next;
+            continue;
+        }
+
+        // dead end, back to a recent vertex or to the next unfinished one
+        while (!deadEnd.empty() && next < 0) {
+            uint32_t candidate = deadEnd.back();
+            deadEnd.pop_back();
+            next = liveTriangles[candidate] > 0 ? static_cast<int64_t>(candidate) : -1;
+        }
+        while (next < 0 && cursor < vertexCount) {
+            next = liveTriangles[cursor] > 0 ? static_cast<int64_t>(cursor) : -1;
+            cursor++;
+        }
+        if (next >= 0) {
+            clusters.push_back(static_cast<uint32_t>(result.size() / 3));
+        }
+        vertex = next;
+    }
+    indices.swap(result);
+}
+
+/*
+    Clusters facing away from the mesh center are the outer surfaces, drawn first they hide the
+    inner ones. The key is dot(cluster center - mesh center, cluster normal), the largest first
+*/
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<VertexData>& vertices, const std::vector<uint32_t>& clusters)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (clusters.size() < 2) {
+        return;
+    }
+
+    // center of the mesh weighted by the triangle areas
+    std::vector<glm::vec3> centers(clusters.size(), glm::vec3(0.0f));
+    std::vector<glm::vec3> normals(clusters.size(), glm::vec3(0.0f));
+    std::vector<float> areas(clusters.size(), 0.0f);
+    glm::vec3 meshCenter(0.0f);
+    float meshArea = 0.0f;
+    for (size_t cluster = 0; cluster < clusters.size(); cluster++) {
+        size_t last = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+        for (size_t triangle = clusters[cluster]; triangle < last; triangle++) {
+            const glm::vec3& p0 = vertices[indices[triangle * 3]].pos;
+            const glm::vec3& p1 = vertices[indices[triangle * 3 + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[triangle * 3 + 2]].pos;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            centers[cluster] += area * (p0 + p1 + p2) / 3.0f;
+            normals[cluster] += normal;
+            areas[cluster] += area;
+        }
+        meshCenter += centers[cluster];
+        meshArea += areas[cluster];
+    }
+    meshCenter = meshArea > 0.0f ? meshCenter / meshArea : meshCenter;
+
+    std::vector<float> sortKeys(clusters.size());
+    for (size_t cluster = 0; cluster < clusters.size(); cluster++) {
+        glm::vec3 center = areas[cluster] > 0.0f ? centers[cluster] / areas[cluster] : meshCenter;
+        float normalLength = glm::length(normals[cluster]);
+        glm::vec3 normal = normalLength > 0.0f ? normals[cluster] / normalLength : glm::vec3(0.0f);
+        sortKeys[cluster] = glm::dot(center - meshCenter, normal);
+    }
+
+    std::vector<uint32_t> order(clusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (uint32_t cluster : order) {
+        size_t last = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+        result.insert(result.end(), indices.begin() + clusters[cluster] * 3, indices.begin() + last * 3);
+    }
+    indices.swap(result);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<VertexData>& vertices, std::vector<uint32_t>& indices)
+{
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(vertices.size(), unused);
+    std::vector<VertexData> result;
+    result.reserve(vertices.size());
+    for (uint32_t& index : indices) {
+        if (remap[index] == unused) {
+            remap[index] = static_cast<uint32_t>(result.size());
+            result.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(result);
+}
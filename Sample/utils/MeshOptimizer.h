@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <vector>
+
+/*
+    Index and vertex reordering run on the meshes once loaded:
+        - triangles ordered for the post transform vertex cache (Tipsify)
+        - triangle clusters sorted so the outer surfaces come first, less overdraw
+        - vertices in the order the indices first use them, for the vertex fetch
+    Every pass keeps the same triangles, only their order and the vertex numbering change.
+*/
+class MeshOptimizer
+{
+public:
+    // vertices in the simulated cache, a little under what current gpus keep
+    static constexpr uint32_t cacheSize = 16;
+
+public:
+    MeshOptimizer();
+    ~MeshOptimizer();
+
+public:
+    // clusters receives the first triangle of every run the cache order could not chain to the previous one
+    static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, std::vector<uint32_t>& clusters);
+    // Keeps the order inside each cluster, to call after optimizeVertexCache
+    static void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<VertexData>& vertices, const std::vector<uint32_t>& clusters);
+    // Unused vertices are dropped
+    static void optimizeVertexFetch(std::vector<VertexData>& vertices, std::vector<uint32_t>& indices);
+};
@@ -0,0 +1,253 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+// Symmetric 4x4 matrix of the squared distance to a set of planes
+struct Quadric {
+    std::array<double, 10> terms{};
+
+    void addPlane(const glm::dvec3& normal, double distance)
+    {
+        double plane[4] = { normal.x, normal.y, normal.z, distance };
+        size_t term = 0;
+        for (int row = 0; row < 4; row++) {
+            for (int column = row; column < 4; column++) {
+                terms[term++] += plane[row] * plane[column];
+            }
+        }
+    }
+
+    void add(const Quadric& other)
+    {
+        for (size_t term = 0; term < terms.size(); term++) {
+            terms[term] += other.terms[term];
+        }
+    }
+
+    double evaluate(const glm::vec3& position) const
+    {
+        double point[4] = { position.x, position.y, position.z, 1.0 };
+        double result = 0.0;
+        size_t term = 0;
+        for (int row = 0; row < 4; row++) {
+            for (int column = row; column < 4; column++) {
+                double weight = row == column ? 1.0 : 2.0;
+                result += weight * terms[term++] * point[row] * point[column];
+            }
+        }
+        return std::max(result, 0.0);
+    }
+};
+
+struct Collapse {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+};
+
+static glm::vec3 triangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+    return glm::cross(p1 - p0, p2 - p0);
+}
+
+// Vertices sharing a position, every one of them gets the index of the first
+static std::vector<uint32_t> positionIds(const std::vector<VertexData>& vertices)
+{
+    std::vector<uint32_t> order(vertices.size());
+    std::iota(order.begin(), order.end(), 0);
+    auto less = [&vertices](uint32_t a, uint32_t b) {
+        const glm::vec3& pa = vertices[a].pos;
+        const glm::vec3& pb = vertices[b].pos;
+        return pa.x != pb.x ? pa.x < pb.x : (pa.y != pb.y ? pa.y < pb.y : (pa.z != pb.z ? pa.z < pb.z : a < b));
+    };
+    std::sort(order.begin(), order.end(), less);
+
+    std::vector<uint32_t> ids(vertices.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        bool samePosition = i > 0 && vertices[order[i]].pos == vertices[order[i - 1]].pos;
+        ids[order[i]] = samePosition ? ids[order[i - 1]] : order[i];
+    }
+    return ids;
+}
+
+// Seams and open borders, an edge of the welded mesh used by a single triangle is a border
+static std::vector<bool> lockedVertices(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices)
+{
+    std::vector<uint32_t> ids = positionIds(vertices);
+    std::vector<bool> locked(vertices.size(), false);
+    for (size_t vertex = 0; vertex < vertices.size(); vertex++) {
+        if (ids[vertex] != vertex) {
+            locked[vertex] = true;
+            locked[ids[vertex]] = true;
+        }
+    }
+
+    std::vector<uint64_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (size_t corner = 0; corner < 3; corner++) {
+            uint64_t a = ids[indices[i + corner]];
+            uint64_t b = ids[indices[i + (corner + 1) % 3]];
+            edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    for (size_t i = 0; i < edges.size();) {
+        size_t last = i;
+        while (last < edges.size() && edges[last] == edges[i]) {
+            last++;
+        }
+        if (last - i == 1) {
+            locked[edges[i] >> 32] = true;
+            locked[edges[i] & 0xffffffffu] = true;
+        }
+        i = last;
+    }
+
+    // the border flag is on the welded vertex, copied back to every vertex of its position
+    for (size_t vertex = 0; vertex < vertices.size(); vertex++) {
+        locked[vertex] = locked[vertex] || locked[ids[vertex]];
+    }
+    return locked;
+}
+
+MeshSimplifier::MeshSimplifier()
+{
+
+}
+
+MeshSimplifier::~MeshSimplifier()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+/*
+    Runs in passes, each one sorts every possible collapse by its cost and applies the cheapest
+    ones whose triangles no other collapse of the pass touched. A collapse that would flip one of
+    the remaining triangles is skipped
+*/
+std::vector<uint32_t> MeshSimplifier::simplify(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices,
+    size_t targetIndexCount, float maxError, float& error)
+{
+    std::vector<uint32_t> result = indices;
+    std::vector<bool> locked = lockedVertices(vertices, indices);
+    double maxCost = static_cast<double>(maxError) * static_cast<double>(maxError);
+    double largestCost = 0.0;
+
+    std::vector<Quadric> quadrics(vertices.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const glm::vec3& p0 = vertices[indices[i]].pos;
+        glm::dvec3 normal = glm::dvec3(triangleNormal(p0, vertices[indices[i + 1]].pos, vertices[indices[i + 2]].pos));
+        double length = glm::length(normal);
+        if (length == 0.0) {
+            continue;
+        }
+        normal /= length;
+        for (size_t corner = 0; corner < 3; corner++) {
+            quadrics[indices[i + corner]].addPlane(normal, -glm::dot(normal, glm::dvec3(p0)));
+        }
+    }
+
+    std::vector<uint32_t> adjacencyOffsets(vertices.size() + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched(vertices.size());
+    std::vector<uint32_t> remap(vertices.size());
+
+    while (result.size() > targetIndexCount) {
+        // triangles around every vertex
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : result) {
+            adjacencyOffsets[index + 1]++;
+        }
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacency.resize(result.size());
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < result.size(); i++) {
+            adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (size_t corner = 0; corner < 3; corner++) {
+                uint32_t from = result[i + corner];
+                uint32_t to = result[i + (corner + 1) % 3];
+                if (!locked[from]) {
+                    collapses.push_back({ quadrics[from].evaluate(vertices[to].pos), from, to });
+                }
+                if (!locked[to]) {
+                    collapses.push_back({ quadrics[to].evaluate(vertices[from].pos), to, from });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+            return a.cost < b.cost;
+        });
+
+        // each collapse removes the two triangles of its edge
+        size_t removeGoal = (result.size() - targetIndexCount) / 3;
+        size_t removed = 0;
+        std::fill(touched.begin(), touched.end(), false);
+        std::iota(remap.begin(), remap.end(), 0);
+        for (const Collapse& collapse : collapses) {
+            if (collapse.cost > maxCost || removed >= removeGoal) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            bool flips = false;
+            for (uint32_t i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1] && !flips; i++) {
+                const uint32_t* triangle = &result[adjacency[i] * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    continue;
+                }
+                glm::vec3 before[3], after[3];
+                for (size_t corner = 0; corner < 3; corner++) {
+                    before[corner] = vertices[triangle[corner]].pos;
+                    after[corner] = triangle[corner] == collapse.from ? vertices[collapse.to].pos : before[corner];
+                }
+                flips = glm::dot(triangleNormal(before[0], before[1], before[2]), triangleNormal(after[0], after[1], after[2])) <= 0.0f;
+            }
+            if (flips) {
+                continue;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            largestCost = std::max(largestCost, collapse.cost);
+            removed += 2;
+            // the triangles of the collapse can't change again in this pass
+            for (uint32_t i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1]; i++) {
+                const uint32_t* triangle = &result[adjacency[i] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+            }
+        }
+        if (removed == 0) {
+            break;
+        }
+
+        // the collapsed triangles become degenerate and are dropped
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            uint32_t a = remap[result[i]];
+            uint32_t b = remap[result[i + 1]];
+            uint32_t c = remap[result[i + 2]];
+            if (a != b && b != c && a != c) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    error = static_cast<float>(std::sqrt(largestCost));
+    return result;
+}
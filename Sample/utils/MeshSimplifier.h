@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <vector>
+
+/*
+    Edge collapse simplification driven by quadric errors (Garland & Heckbert). A vertex is only
+    ever collapsed onto one of its neighbours, the simplified index buffers keep using the vertex
+    buffer of the full detail mesh.
+    Vertices on an open border or on an attribute seam (the same position with another texture
+    coordinate) are never moved, the LODs keep the silhouette and the uv layout of the mesh.
+*/
+class MeshSimplifier
+{
+public:
+    MeshSimplifier();
+    ~MeshSimplifier();
+
+public:
+    // Stops at targetIndexCount or when the next collapse would move the surface further than maxError,
+    // error receives the largest distance reached
+    static std::vector<uint32_t> simplify(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices,
+        size_t targetIndexCount, float maxError, float& error);
+};
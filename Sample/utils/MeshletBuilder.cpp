@@ -0,0 +1,118 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+// below this the cone is too wide to ever cull anything, cos(84 degrees)
+static const float minConeSpread = 0.1f;
+
+// Sphere around the bounds of the vertices, then the cone of the triangle normals
+static Meshlet meshletBounds(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount)
+{
+    Meshlet meshlet{};
+    meshlet.range = glm::uvec4(firstIndex, indexCount, 0, 0);
+
+    glm::vec3 bboxMin = vertices[indices[firstIndex]].pos;
+    glm::vec3 bboxMax = bboxMin;
+    for (uint32_t i = firstIndex; i < firstIndex + indexCount; i++) {
+        bboxMin = glm::min(bboxMin, vertices[indices[i]].pos);
+        bboxMax = glm::max(bboxMax, vertices[indices[i]].pos);
+    }
+    glm::vec3 center = 0.5f * (bboxMin + bboxMax);
+    float radius = 0.0f;
+    for (uint32_t i = firstIndex; i < firstIndex + indexCount; i++) {
+        radius = std::max(radius, glm::length(vertices[indices[i]].pos - center));
+    }
+    meshlet.sphere = glm::vec4(center, radius);
+
+    std::vector<glm::vec3> normals;
+    normals.reserve(indexCount / 3);
+    glm::vec3 axis(0.0f);
+    for (uint32_t i = firstIndex; i < firstIndex + indexCount; i += 3) {
+        const glm::vec3& p0 = vertices[indices[i]].pos;
+        glm::vec3 normal = glm::cross(vertices[indices[i + 1]].pos - p0, vertices[indices[i + 2]].pos - p0);
+        float area = glm::length(normal);
+        // degenerate triangles face nowhere
+        normals.push_back(area > 0.0f ? normal / area : glm::vec3(0.0f));
+        axis += normals.back();
+    }
+
+    // never culled unless every normal is close enough to the axis
+    meshlet.cone = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    meshlet.apex = glm::vec4(center, 0.0f);
+    float axisLength = glm::length(axis);
+    if (axisLength == 0.0f) {
+        return meshlet;
+    }
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& normal : normals) {
+        minDot = std::min(minDot, glm::dot(normal, axis));
+    }
+    if (minDot <= minConeSpread) {
+        return meshlet;
+    }
+
+    // apex moved back along the axis until it is behind the plane of every triangle,
+    // a camera in front of one of them is never inside the culled cone
+    float maxDistance = 0.0f;
+    for (size_t triangle = 0; triangle < normals.size(); triangle++) {
+        const glm::vec3& p0 = vertices[indices[firstIndex + triangle * 3]].pos;
+        float normalDot = glm::dot(normals[triangle], axis);
+        if (normalDot > 0.0f) {
+            maxDistance = std::max(maxDistance, glm::dot(center - p0, normals[triangle]) / normalDot);
+        }
+    }
+    meshlet.cone = glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+    meshlet.apex = glm::vec4(center - axis * maxDistance, 0.0f);
+    return meshlet;
+}
+
+MeshletBuilder::MeshletBuilder()
+{
+
+}
+
+MeshletBuilder::~MeshletBuilder()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+/*
+    A triangle joins the current meshlet while the vertex and triangle limits hold, otherwise
+    it starts the next one. The vertices already in the meshlet are tracked with a stamp per
+    vertex, no clear between two meshlets
+*/
+void MeshletBuilder::build(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices, std::vector<Meshlet>& meshlets)
+{
+    meshlets.clear();
+    std::vector<uint32_t> stamps(vertices.size(), 0);
+    uint32_t stamp = 1;
+    uint32_t firstIndex = 0;
+    uint32_t vertexCount = 0;
+
+    for (uint32_t i = 0; i < indices.size(); i += 3) {
+        uint32_t newVertices = 0;
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            newVertices += stamps[indices[i + corner]] != stamp ? 1 : 0;
+        }
+        // a triangle repeating one of its vertices counts it twice, only a bit conservative
+        if (vertexCount + newVertices > maxVertices || (i - firstIndex) / 3 == maxTriangles) {
+            meshlets.push_back(meshletBounds(vertices, indices, firstIndex, i - firstIndex));
+            firstIndex = i;
+            vertexCount = 0;
+            stamp++;
+            newVertices = 3;
+        }
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            stamps[indices[i + corner]] = stamp;
+        }
+        vertexCount += newVertices;
+    }
+    if (firstIndex < indices.size()) {
+        meshlets.push_back(meshletBounds(vertices, indices, firstIndex, static_cast<uint32_t>(indices.size()) - firstIndex));
+    }
+}
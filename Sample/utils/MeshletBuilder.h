@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <vector>
+
+/*
+    Partitions an index buffer in meshlets, small runs of neighbouring triangles the gpu culls
+    one by one. The triangles are taken in the order of the index buffer, a vertex cache
+    ordered mesh already keeps the triangles of a run close to each other.
+    Every meshlet gets a bounding sphere for the frustum test and a normal cone for the back
+    face test (Barczak, Optimizing Graphics Pipelines with Compute, 2016). The normals assume
+    counter clockwise front faces, the winding of the OBJ files.
+*/
+class MeshletBuilder
+{
+public:
+    // limits of a meshlet, the ones of the mesh shader path of most gpus
+    static constexpr uint32_t maxVertices = 64;
+    static constexpr uint32_t maxTriangles = 124;
+
+public:
+    MeshletBuilder();
+    ~MeshletBuilder();
+
+public:
+    // The meshlet ranges cover the index buffer from its start, one after the other
+    static void build(const std::vector<VertexData>& vertices, const std::vector<uint32_t>& indices, std::vector<Meshlet>& meshlets);
+};
@@ -0,0 +1,254 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+// chunks smaller than this are not worth a thread
+static const size_t minChunkSize = 1 << 20;
+// corner without texture coordinate
+static const int32_t noIndex = std::numeric_limits<int32_t>::min();
+
+// Flags of ObjCorner::relative
+static const uint32_t relativePosition = 1;
+static const uint32_t relativeTexCoord = 2;
+
+/*
+    Indices of a face corner. A chunk doesn't know how many positions the chunks before it
+    hold, a negative OBJ index is kept as an offset from the start of the chunk, possibly
+    negative, and flagged as relative until the chunks are merged
+*/
+struct ObjCorner {
+    int32_t position;
+    int32_t texCoord;
+    uint32_t relative;
+};
+
+struct ObjChunk {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    // three per triangle
+    std::vector<ObjCorner> corners;
+};
+
+static const char* skipSpaces(const char* it, const char* end)
+{
+    while (it < end && (*it == ' ' || *it == '\t')) {
+        it++;
+    }
+    return it;
+}
+
+static bool isLineEnd(const char* it, const char* end)
+{
+    return it >= end || *it == '\r' || *it == '#';
+}
+
+static const char* parseFloat(const char* it, const char* end, float& value)
+{
+    it = skipSpaces(it, end);
+    // from_chars doesn't take a leading plus sign
+    if (it < end && *it == '+') {
+        it++;
+    }
+    auto result = std::from_chars(it, end, value);
+    if (result.ec != std::errc()) {
+        throw std::runtime_error("failed to parse obj number!");
+    }
+    return result.ptr;
+}
+
+static const char* parseIndex(const char* it, const char* end, size_t localCount, int32_t& index, bool& relative)
+{
+    int32_t value = 0;
+    auto result = std::from_chars(it, end, value);
+    if (result.ec != std::errc() || value == 0) {
+        throw std::runtime_error("failed to parse obj face!");
+    }
+    relative = value < 0;
+    index = relative ? static_cast<int32_t>(localCount) + value : value - 1;
+    return result.ptr;
+}
+
+// v, v/vt, v/vt/vn or v//vn
+static const char* parseCorner(const char* it, const char* end, const ObjChunk& chunk, ObjCorner& corner)
+{
+    bool relative = false;
+    it = parseIndex(it, end, chunk.positions.size(), corner.position, relative);
+    corner.relative = relative ? relativePosition : 0;
+    corner.texCoord = noIndex;
+    if (it < end && *it == '/') {
+        it++;
+        if (it < end && *it != '/') {
+            it = parseIndex(it, end, chunk.texCoords.size(), corner.texCoord, relative);
+            corner.relative |= relative ? relativeTexCoord : 0;
+        }
+        // the normal is not used
+        if (it < end && *it == '/') {
+            it++;
+            while (it < end && (*it == '-' || (*it >= '0' && *it <= '9'))) {
+                it++;
+            }
+        }
+    }
+    return it;
+}
+
+static void parseChunk(const char* begin, const char* end, ObjChunk& chunk)
+{
+    const char* line = begin;
+    while (line < end) {
+        const char* lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+        lineEnd = lineEnd != nullptr ? lineEnd : end;
+        const char* it = skipSpaces(line, lineEnd);
+
+        if (lineEnd - it > 2 && it[0] == 'v' && (it[1] == ' ' || it[1] == '\t')) {
+            glm::vec3 position;
+            it = parseFloat(it + 2, lineEnd, position.x);
+            it = parseFloat(it, lineEnd, position.y);
+            parseFloat(it, lineEnd, position.z);
+            chunk.positions.push_back(position);
+        }
+        else if (lineEnd - it > 3 && it[0] == 'v' && it[1] == 't' && (it[2] == ' ' || it[2] == '\t')) {
+            // the second coordinate is optional
+            glm::vec2 texCoord(0.0f);
+            it = parseFloat(it + 3, lineEnd, texCoord.x);
+            it = skipSpaces(it, lineEnd);
+            if (!isLineEnd(it, lineEnd)) {
+                parseFloat(it, lineEnd, texCoord.y);
+            }
+            chunk.texCoords.push_back(texCoord);
+        }
+        else if (lineEnd - it > 2 && it[0] == 'f' && (it[1] == ' ' || it[1] == '\t')) {
+            // triangle fan around the first corner
+            ObjCorner first{}, previous{}, corner{};
+            uint32_t cornerCount = 0;
+            it = skipSpaces(it + 2, lineEnd);
+            while (!isLineEnd(it, lineEnd)) {
+                it = parseCorner(it, lineEnd, chunk, corner);
+                if (cornerCount >= 2) {
+                    chunk.corners.push_back(first);
+                    chunk.corners.push_back(previous);
+                    chunk.corners.push_back(corner);
+                }
+                first = cornerCount == 0 ? corner : first;
+                previous = corner;
+                cornerCount++;
+                it = skipSpaces(it, lineEnd);
+            }
+        }
+        line = lineEnd + 1;
+    }
+}
+
+static int32_t resolveIndex(int32_t index, bool relative, size_t chunkBase)
+{
+    return relative ? static_cast<int32_t>(chunkBase) + index : index;
+}
+
+// finalizer of splitmix64, spreads the two packed indices over every bit
+static uint64_t hashCorner(uint64_t key)
+{
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+    return key ^ (key >> 31);
+}
+
+ObjLoader::ObjLoader()
+{
+
+}
+
+ObjLoader::~ObjLoader()
+{
+
+}
+
+/* -------------------------- Public methods -------------------------- */
+
+void ObjLoader::load(const std::string& fileName, std::vector<VertexData>& vertices, std::vector<uint32_t>& indices)
+{
+    MappedFile file(fileName);
+    const char* data = file.data();
+    const char* end = data + file.size();
+
+    // ------------------- Parse
+
+    // chunks end after a line break, no line is split between two of them
+    size_t workerCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), std::max<size_t>(1, file.size() / minChunkSize));
+    std::vector<const char*> bounds(workerCount + 1, end);
+    bounds[0] = data;
+    for (size_t worker = 1; worker < workerCount; worker++) {
+        const char* split = std::max(bounds[worker - 1], data + file.size() * worker / workerCount);
+        const char* lineEnd = static_cast<const char*>(memchr(split, '\n', end - split));
+        bounds[worker] = lineEnd != nullptr ? lineEnd + 1 : end;
+    }
+
+    std::vector<ObjChunk> chunks(workerCount);
+    std::vector<std::future<void>> workers;
+    for (size_t worker = 1; worker < workerCount; worker++) {
+        workers.push_back(std::async(std::launch::async, parseChunk, bounds[worker], bounds[worker + 1], std::ref(chunks[worker])));
+    }
+    parseChunk(bounds[0], bounds[1], chunks[0]);
+    // rethrow the first failure
+    for (auto& worker : workers) {
+        worker.get();
+    }
+
+    // ------------------- Merge
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<ObjCorner> corners;
+    for (const ObjChunk& chunk : chunks) {
+        size_t positionBase = positions.size();
+        size_t texCoordBase = texCoords.size();
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+        for (const ObjCorner& corner : chunk.corners) {
+            corners.push_back({ resolveIndex(corner.position, (corner.relative & relativePosition) != 0, positionBase),
+                resolveIndex(corner.texCoord, (corner.relative & relativeTexCoord) != 0, texCoordBase), 0 });
+        }
+    }
+
+    // ------------------- Weld
+
+    // power of two at least twice the corner count, the table stays at most half full
+    size_t capacity = 16;
+    while (capacity < corners.size() * 2) {
+        capacity <<= 1;
+    }
+    const uint64_t emptyKey = std::numeric_limits<uint64_t>::max();
+    std::vector<uint64_t> keys(capacity, emptyKey);
+    std::vector<uint32_t> values(capacity);
+
+    vertices.clear();
+    indices.clear();
+    indices.reserve(corners.size());
+    for (const ObjCorner& corner : corners) {
+        bool hasTexCoord = corner.texCoord != noIndex;
+        if (corner.position < 0 || static_cast<size_t>(corner.position) >= positions.size()
+            || (hasTexCoord && (corner.texCoord < 0 || static_cast<size_t>(corner.texCoord) >= texCoords.size()))) {
+            throw std::runtime_error("failed to load " + fileName + ", face index out of range!");
+        }
+
+        uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(corner.position)) << 32) | static_cast<uint32_t>(corner.texCoord);
+        size_t slot = hashCorner(key) & (capacity - 1);
+        while (keys[slot] != emptyKey && keys[slot] != key) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+
+        if (keys[slot] == emptyKey) {
+            keys[slot] = key;
+            values[slot] = static_cast<uint32_t>(vertices.size());
+            glm::vec2 texCoord = hasTexCoord ? texCoords[corner.texCoord] : glm::vec2(0.0f, 1.0f);
+            vertices.emplace_back(positions[corner.position], glm::vec3(1.0f), glm::vec2(texCoord.x, 1.0f - texCoord.y));
+        }
+        indices.push_back(values[slot]);
+    }
+}
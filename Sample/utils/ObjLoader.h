@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <string>
+#include <vector>
+
+/*
+    Wavefront OBJ reader for big files. The file is mapped and split in line aligned chunks
+    parsed on worker threads, the corners are then welded through an open addressing table
+    keyed on their position and texture coordinate indices.
+    Only the positions and texture coordinates are read, polygons are split in triangle fans.
+*/
+class ObjLoader
+{
+public:
+    ObjLoader();
+    ~ObjLoader();
+
+public:
+    static void load(const std::string& fileName, std::vector<VertexData>& vertices, std::vector<uint32_t>& indices);
+};
@@ -13,6 +13,8 @@ Quad::Quad()
     m_indices = {
         0, 1, 2, 2, 3, 0
     };
+    optimize(false);
+    computeBounds();
 }
 
 Quad::~Quad()
@@ -1,7 +1,7 @@
 #include "SkinMesh.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
+#include "ObjLoader.h"
+#include "MeshCache.h"
 
 SkinMesh::SkinMesh():
     Mesh()
@@ -16,45 +16,37 @@ SkinMesh::~SkinMesh()
 
 /* -------------------------- Public methods -------------------------- */
 
+// The binary cache next to the file skips the parsing, the optimization and the simplification once the mesh has been loaded.
+// The meshlets follow the cache ordered triangles, the gpu culls them one by one
 void SkinMesh::load(const std::string& fileName)
 {
     m_vertices.clear();
     m_indices.clear();
-
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
-
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, fileName.c_str())) {
-        throw std::runtime_error(warn + err);
+    m_lodIndices.clear();
+    m_lods.clear();
+    m_meshlets.clear();
+
+    std::vector<uint32_t> indices;
+    std::vector<MeshLod> cachedLods;
+    if (MeshCache::load(fileName, m_vertices, indices, cachedLods) && !cachedLods.empty()) {
+        // the full detail level starts the index buffer
+        m_indices.assign(indices.begin(), indices.begin() + cachedLods[0].indexCount);
+        m_lodIndices.assign(indices.begin() + cachedLods[0].indexCount, indices.end());
+        m_lods.assign(cachedLods.begin() + 1, cachedLods.end());
+        computeBounds();
+        // a single pass over the indices, not worth a place in the cache
+        buildMeshlets();
+        return;
     }
 
-    std::unordered_map<VertexData, uint32_t> uniqueVertices{};
-
-    for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            VertexData vertex{};
-
-            vertex.pos = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2]
-            };
-
-            vertex.texCoord = {
-                attrib.texcoords[2 * index.texcoord_index + 0],
-                1.0 - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
+    ObjLoader::load(fileName, m_vertices, m_indices);
+    optimize(true);
+    computeBounds();
+    // each level may move the surface by 2% of the mesh size
+    generateLods(lodCount, 0.02f * glm::length(m_bboxMax - m_bboxMin));
+    buildMeshlets();
 
-            vertex.color = { 1.0f, 1.0f, 1.0f };
-
-            if (uniqueVertices.count(vertex) == 0) {
-                uniqueVertices[vertex] = static_cast<uint32_t>(m_vertices.size());
-                m_vertices.push_back(vertex);
-            }
-
-            m_indices.push_back(uniqueVertices[vertex]);
-        }
-    }
-}
\ No newline at end of file
+    indices = m_indices;
+    indices.insert(indices.end(), m_lodIndices.begin(), m_lodIndices.end());
+    MeshCache::save(fileName, m_vertices, indices, lods());
+}
@@ -8,6 +8,9 @@
 
 class SkinMesh : public Mesh
 {
+public:
+    static constexpr uint32_t lodCount = 4;
+
 public:
     SkinMesh();
     ~SkinMesh();
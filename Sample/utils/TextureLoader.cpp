@@ -1,5 +1,6 @@
 #include "TextureLoader.h"
 #include <core/VkInitializer.h>
+#include <core/RenderGraph.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -13,6 +14,7 @@
 #include <noise/CloudGenerator.h>
 #include <noise/WorleyNoise3D.h>
 #include <noise/WorleyNoise2D.h>
+#include <noise/BlueNoise2D.h>
 
 #include <glm/gtx/string_cast.hpp>
 
@@ -179,6 +181,48 @@ ImageView TextureLoader::loadWorleyNoiseTexture(const VkExtent2D& dimension, con
     return ImageView(m_renderContext->device(), imageInfo, VK_IMAGE_VIEW_TYPE_2D);
 }
 
+ImageView TextureLoader::loadBlueNoiseTexture(uint32_t size)
+{
+    Image imageInfo;
+    std::vector<unsigned char> noiseDatas;
+    VkDeviceSize imageSize = size * size;
+    imageInfo.Vkformat = VK_FORMAT_R8_UNORM;
+    imageInfo.mipLevels = 1;
+    imageInfo.aspectFlag = VK_IMAGE_ASPECT_COLOR_BIT;
+
+    BlueNoise2D blueNoiseGenerator = BlueNoise2D(size);
+    noiseDatas.resize(imageSize);
+    for (uint32_t j = 0; j < size; j++) {
+        for (uint32_t i = 0; i < size; i++) {
+            float noiseValue = blueNoiseGenerator.evaluate(glm::ivec2(i, j)) * 256.0f;
+            noiseDatas[j * size + i] = static_cast<unsigned char>(std::min(noiseValue, 255.0f));
+        }
+    }
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    m_renderContext->createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+    void* data;
+    vkMapMemory(m_renderContext->device(), stagingBufferMemory, 0, imageSize, 0, &data);
+    memcpy(data, noiseDatas.data(), static_cast<size_t>(imageSize));
+    vkUnmapMemory(m_renderContext->device(), stagingBufferMemory);
+
+    vk_initializer::createImage(m_renderContext->device(), m_renderContext->physicalDevice(), size, size, imageInfo.mipLevels, VK_SAMPLE_COUNT_1_BIT, imageInfo.Vkformat, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        imageInfo.Vkimage, imageInfo.Vkmemory);
+
+    VkCommandBuffer copyCmd = m_renderContext->beginSingleTimeCommands();
+    setImageLayout(copyCmd, imageInfo, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    copyBufferToImage(copyCmd, stagingBuffer, imageInfo.Vkimage, size, size);
+    setImageLayout(copyCmd, imageInfo, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    m_renderContext->endSingleTimeCommands(copyCmd);
+
+    vkDestroyBuffer(m_renderContext->device(), stagingBuffer, nullptr);
+    vkFreeMemory(m_renderContext->device(), stagingBufferMemory, nullptr);
+
+    return ImageView(m_renderContext->device(), imageInfo, VK_IMAGE_VIEW_TYPE_2D);
+}
+
 ImageView TextureLoader::load3DCloudTexture(const VkExtent3D& dimension, VkImageAspectFlags aspect, float noiseScale, float randomSeed)
 {
     ImageView result;
@@ -399,8 +443,7 @@ void TextureLoader::generateMipmaps(VkCommandBuffer commandBuffer, Image& image,
         1, &barrier);
 }
 
-void TextureLoader::setImageLayout(VkCommandBuffer commandBuffer, Image& image, VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
-    VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask)
+void TextureLoader::setImageLayout(VkCommandBuffer commandBuffer, Image& image, VkImageLayout oldImageLayout, VkImageLayout newImageLayout)
 {
     // The sub resource range describes the regions of the image we will be transitioned
     VkImageSubresourceRange subresourceRange = {};
@@ -419,106 +462,23 @@ void TextureLoader::setImageLayout(VkCommandBuffer commandBuffer, Image& image,
     imageMemoryBarrier.image = image.Vkimage;
     imageMemoryBarrier.subresourceRange = subresourceRange;
 
-    // Source layouts (old)
-    // Source access mask controls actions that have to be finished on the old layout
-    // before it will be transitioned to the new layout
-    switch (oldImageLayout)
-    {
-    case VK_IMAGE_LAYOUT_UNDEFINED:
-        // Image layout is undefined (or does not matter)
-        // Only valid as initial layout
-        // No flags required, listed only for completeness
-        imageMemoryBarrier.srcAccessMask = 0;
-        break;
-
-    case VK_IMAGE_LAYOUT_PREINITIALIZED:
-        // Image is preinitialized
-        // Only valid as initial layout for linear images, preserves memory contents
-        // Make sure host writes have been finished
-        imageMemoryBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT;
-        break;
-
-    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-        // Image is a color attachment
-        // Make sure any writes to the color buffer have been finished
-        imageMemoryBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-        break;
-
-    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
-        // Image is a depth/stencil attachment
-        // Make sure any writes to the depth/stencil buffer have been finished
-        imageMemoryBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-        break;
-
-    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
-        // Image is a transfer source
-        // Make sure any reads from the image have been finished
-        imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        break;
-
-    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-        // Image is a transfer destination
-        // Make sure any writes to the image have been finished
-        imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        break;
-
-    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
-        // Image is read by a shader
-        // Make sure any shader reads from the image have been finished
-        imageMemoryBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        break;
-    default:
-        // Other source layouts aren't handled (yet)
-        break;
-    }
-
-    // Target layouts (new)
-    // Destination access mask controls the dependency for the new image layout
-    switch (newImageLayout)
-    {
-    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
-        // Image will be used as a transfer destination
-        // Make sure any writes to the image have been finished
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        break;
-
-    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
-        // Image will be used as a transfer source
-        // Make sure any reads from the image have been finished
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        break;
-
-    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
-        // Image will be used as a color attachment
-        // Make sure any writes to the color buffer have been finished
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-        break;
-
-    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
-        // Image layout will be used as a depth/stencil attachment
-        // Make sure any writes to depth/stencil buffer have been finished
-        imageMemoryBarrier.dstAccessMask = imageMemoryBarrier.dstAccessMask | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-        break;
-
-    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
-        // Image will be read in a shader (sampler, input attachment)
-        // Make sure any writes to the image have been finished
-        if (imageMemoryBarrier.srcAccessMask == 0)
-        {
-            imageMemoryBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
-        }
-        imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        break;
-    default:
-        // Other source layouts aren't handled (yet)
-        break;
+    // Wait only for the stages touching the old layout and block only the ones using the new layout,
+    // instead of draining the whole pipeline with ALL_COMMANDS
+    ResourceAccess src = render_graph::accessForLayout(oldImageLayout);
+    ResourceAccess dst = render_graph::accessForLayout(newImageLayout);
+    if (oldImageLayout == VK_IMAGE_LAYOUT_UNDEFINED && newImageLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+        // Image written by the host or a copy without a transfer layout
+        src.stageMask = VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        src.accessMask = VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
     }
+    imageMemoryBarrier.srcAccessMask = src.accessMask;
+    imageMemoryBarrier.dstAccessMask = dst.accessMask;
 
     // Put barrier inside setup command buffer
     vkCmdPipelineBarrier(
         commandBuffer,
-        srcStageMask,
-        dstStageMask,
+        src.stageMask,
+        dst.stageMask,
         0,
         0, nullptr,
         0, nullptr,